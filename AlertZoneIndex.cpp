@@ -0,0 +1,70 @@
+// AlertZoneIndex.cpp（警戒区像素索引）
+#include "AlertZoneIndex.h"
+#include <algorithm>
+
+AlertZoneIndex::AlertZoneIndex(cv::Point center, int outer_radius_pixels, cv::Size image_size)
+    : center_(center), outer_radius_(std::max(0, outer_radius_pixels)) {
+    const int r = outer_radius_;
+    std::vector<std::pair<int, cv::Point>> candidates;
+    candidates.reserve((2 * r + 1) * (2 * r + 1));
+
+    for (int dy = -r; dy <= r; ++dy) {
+        for (int dx = -r; dx <= r; ++dx) {
+            int squared_distance = dx * dx + dy * dy;
+            cv::Point p(center.x + dx, center.y + dy);
+            if (squared_distance > r * r || p.x < 0 || p.y < 0 || p.x >= image_size.width || p.y >= image_size.height) {
+                continue;
+            }
+            candidates.push_back(std::make_pair(squared_distance, p));
+        }
+    }
+
+    // 同距离的像素按行列顺序排列，保证打捞顺序确定
+    std::sort(candidates.begin(), candidates.end(),
+        [](const std::pair<int, cv::Point>& a, const std::pair<int, cv::Point>& b) {
+            if (a.first != b.first) return a.first < b.first;
+            if (a.second.y != b.second.y) return a.second.y < b.second.y;
+            return a.second.x < b.second.x;
+        });
+
+    points_.reserve(candidates.size());
+    ring_end_.assign(r + 1, 0);
+    size_t index = 0;
+    for (int ring = 0; ring <= r; ++ring) {
+        while (index < candidates.size() && candidates[index].first <= ring * ring) {
+            points_.push_back(candidates[index].second);
+            ++index;
+        }
+        ring_end_[ring] = index;
+    }
+}
+
+size_t AlertZoneIndex::endOfRing(int radius_pixels) const {
+    if (radius_pixels < 0) {
+        return 0;
+    }
+    return ring_end_[std::min(radius_pixels, outer_radius_)];
+}
+
+int AlertZoneIndex::salvageNearestFirst(CompactMask& mask, int max_pixels) const {
+    int removed = 0;
+    for (size_t i = 0; i < points_.size() && removed < max_pixels; ++i) {
+        if (mask.test(points_[i].x, points_[i].y)) {
+            mask.reset(points_[i].x, points_[i].y);
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+int AlertZoneIndex::clearWithin(CompactMask& mask, int radius_pixels) const {
+    return (int)mask.clearCircle(center_, std::min(radius_pixels, outer_radius_));
+}
+
+bool AlertZoneIndex::anyWithin(const CompactMask& mask, int radius_pixels) const {
+    return mask.anyInCircle(center_, std::min(radius_pixels, outer_radius_));
+}
+
+int AlertZoneIndex::countInAnnulus(const CompactMask& mask, int inner_radius_pixels, int outer_radius_pixels) const {
+    return (int)mask.countInAnnulus(center_, std::min(inner_radius_pixels, outer_radius_), std::min(outer_radius_pixels, outer_radius_));
+}
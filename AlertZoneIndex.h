@@ -0,0 +1,40 @@
+// AlertZoneIndex.h
+#ifndef ALERT_ZONE_INDEX_H
+#define ALERT_ZONE_INDEX_H
+
+#include "CompactMask.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// 水源地警戒区的预计算像素索引
+// 中心与半径固定，构造时列出外圈半径内的全部像素（已裁剪到影像范围），
+// 按到中心的平方距离升序排列并按整数半径分环；打捞、警戒检查与血条计数
+// 只访问警戒区内的像素，且天然按由近及远的顺序遍历，无需排序和全图扫描
+class AlertZoneIndex {
+public:
+    AlertZoneIndex(cv::Point center, int outer_radius_pixels, cv::Size image_size);
+
+    // 掩膜为位压缩格式：打捞按索引由近及远逐点清除，其余查询按行 popcount，不逐像素访问
+    // 由近及远清除至多 max_pixels 个藻华像素，返回实际清除数量
+    int salvageNearestFirst(CompactMask& mask, int max_pixels) const;
+    // 清除 radius_pixels 内的全部藻华像素，返回清除数量
+    int clearWithin(CompactMask& mask, int radius_pixels) const;
+    // radius_pixels 内是否存在藻华像素
+    bool anyWithin(const CompactMask& mask, int radius_pixels) const;
+    // 满足 inner_radius < 距离 <= outer_radius 的藻华像素数量
+    int countInAnnulus(const CompactMask& mask, int inner_radius_pixels, int outer_radius_pixels) const;
+
+    cv::Point center() const { return center_; }
+    int outerRadius() const { return outer_radius_; }
+
+private:
+    // 距离 <= radius_pixels 的像素在 points_ 中的结束位置
+    size_t endOfRing(int radius_pixels) const;
+
+    cv::Point center_;
+    int outer_radius_;
+    std::vector<cv::Point> points_;     // 绝对坐标，按平方距离升序
+    std::vector<size_t> ring_end_;      // ring_end_[r]：距离 <= r 的像素个数
+};
+
+#endif
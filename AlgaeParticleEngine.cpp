@@ -0,0 +1,315 @@
+// AlgaeParticleEngine.cpp（持久化粒子的拉格朗日平流）
+
+#include "AlgaeParticleEngine.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+
+AlgaeParticleEngine::AlgaeParticleEngine(const cv::Mat& velocity_field_mps, float spatial_resolution)
+    : velocity_field_mps_(velocity_field_mps),
+      size_(velocity_field_mps.size()),
+      time_seconds_(0.0),
+      pixels_per_meter_(1.0f / spatial_resolution),
+      max_speed_pixels_(0.0f),
+      perturbation_cos_(1.0f),
+      perturbation_sin_(0.0f),
+      parallel_(true) {
+    CV_Assert(velocity_field_mps.type() == CV_32FC2);
+
+    float max_speed_sq = 0.0f;
+    for (int y = 0; y < velocity_field_mps.rows; ++y) {
+        const cv::Vec2f* row = velocity_field_mps.ptr<cv::Vec2f>(y);
+        for (int x = 0; x < velocity_field_mps.cols; ++x) {
+            max_speed_sq = std::max(max_speed_sq, row[x][0] * row[x][0] + row[x][1] * row[x][1]);
+        }
+    }
+    max_speed_pixels_ = std::sqrt(max_speed_sq) * pixels_per_meter_;
+}
+
+AlgaeParticleEngine::AlgaeParticleEngine(std::shared_ptr<VelocityProvider> velocity, float spatial_resolution)
+    : velocity_(velocity),
+      size_(velocity->size()),
+      time_seconds_(0.0),
+      pixels_per_meter_(1.0f / spatial_resolution),
+      max_speed_pixels_(0.0f),
+      perturbation_cos_(1.0f),
+      perturbation_sin_(0.0f),
+      parallel_(true) {}
+
+void AlgaeParticleEngine::seedFromMask(const cv::Mat& algae_mask) {
+    x_.clear();
+    y_.clear();
+    weight_.clear();
+
+    for (int y = 0; y < algae_mask.rows; ++y) {
+        const uchar* row = algae_mask.ptr<uchar>(y);
+        for (int x = 0; x < algae_mask.cols; ++x) {
+            if (row[x]) {
+                x_.push_back((float)x);
+                y_.push_back((float)y);
+                weight_.push_back(1.0f);
+            }
+        }
+    }
+}
+
+void AlgaeParticleEngine::seedFromMask(const CompactMask& algae_mask) {
+    size_t count = algae_mask.count();
+    x_.clear();
+    y_.clear();
+    weight_.assign(count, 1.0f);
+    x_.reserve(count);
+    y_.reserve(count);
+
+    algae_mask.forEachSet([this](int x, int y) {
+        x_.push_back((float)x);
+        y_.push_back((float)y);
+    });
+}
+
+cv::Vec2f AlgaeParticleEngine::sampleVelocity(float x, float y) const {
+    return sampleVelocity(x, y, time_seconds_);
+}
+
+cv::Vec2f AlgaeParticleEngine::sampleVelocity(float x, float y, double seconds) const {
+    if (velocity_) {
+        cv::Vec2f v = velocity_->sample(x, y, seconds) * pixels_per_meter_;
+        return cv::Vec2f(perturbation_cos_ * v[0] - perturbation_sin_ * v[1],
+            perturbation_sin_ * v[0] + perturbation_cos_ * v[1]);
+    }
+
+    const int cols = velocity_field_mps_.cols;
+    const int rows = velocity_field_mps_.rows;
+
+    x = std::max(0.0f, std::min((float)(cols - 1), x));
+    y = std::max(0.0f, std::min((float)(rows - 1), y));
+
+    int x0 = (int)x;
+    int y0 = (int)y;
+    int x1 = std::min(x0 + 1, cols - 1);
+    int y1 = std::min(y0 + 1, rows - 1);
+    float fx = x - x0;
+    float fy = y - y0;
+
+    const cv::Vec2f* row0 = velocity_field_mps_.ptr<cv::Vec2f>(y0);
+    const cv::Vec2f* row1 = velocity_field_mps_.ptr<cv::Vec2f>(y1);
+
+    cv::Vec2f top = row0[x0] * (1.0f - fx) + row0[x1] * fx;
+    cv::Vec2f bottom = row1[x0] * (1.0f - fx) + row1[x1] * fx;
+    cv::Vec2f v = (top * (1.0f - fy) + bottom * fy) * pixels_per_meter_;
+    return cv::Vec2f(perturbation_cos_ * v[0] - perturbation_sin_ * v[1],
+        perturbation_sin_ * v[0] + perturbation_cos_ * v[1]);
+}
+
+void AlgaeParticleEngine::setVelocityPerturbation(float scale, float rotation_radians) {
+    perturbation_cos_ = scale * std::cos(rotation_radians);
+    perturbation_sin_ = scale * std::sin(rotation_radians);
+}
+
+int AlgaeParticleEngine::suggestSubsteps(float seconds, float max_pixels_per_substep) const {
+    float max_speed_pixels = max_speed_pixels_;
+    if (velocity_) {
+        // 时变流场只统计本次推进会用到的关键帧
+        velocity_->prepare(time_seconds_, time_seconds_ + seconds);
+        max_speed_pixels = velocity_->maxSpeed() * pixels_per_meter_;
+    }
+    float max_displacement = max_speed_pixels * std::fabs(seconds);
+    return std::max(1, (int)std::ceil(max_displacement / max_pixels_per_substep));
+}
+
+void AlgaeParticleEngine::integrateParticle(float& x, float& y, float dt, Integrator integrator) const {
+    integrateParticle(x, y, time_seconds_, dt, integrator);
+}
+
+void AlgaeParticleEngine::integrateParticle(float& x, float& y, double seconds, float dt, Integrator integrator) const {
+    const double mid_seconds = seconds + 0.5 * dt;
+    cv::Vec2f k1 = sampleVelocity(x, y, seconds);
+    if (integrator == Integrator::Euler) {
+        x += k1[0] * dt;
+        y += k1[1] * dt;
+    }
+    else if (integrator == Integrator::RK2) {
+        cv::Vec2f k2 = sampleVelocity(x + 0.5f * dt * k1[0], y + 0.5f * dt * k1[1], mid_seconds);
+        x += k2[0] * dt;
+        y += k2[1] * dt;
+    }
+    else {
+        cv::Vec2f k2 = sampleVelocity(x + 0.5f * dt * k1[0], y + 0.5f * dt * k1[1], mid_seconds);
+        cv::Vec2f k3 = sampleVelocity(x + 0.5f * dt * k2[0], y + 0.5f * dt * k2[1], mid_seconds);
+        cv::Vec2f k4 = sampleVelocity(x + dt * k3[0], y + dt * k3[1], seconds + dt);
+        x += dt / 6.0f * (k1[0] + 2.0f * k2[0] + 2.0f * k3[0] + k4[0]);
+        y += dt / 6.0f * (k1[1] + 2.0f * k2[1] + 2.0f * k3[1] + k4[1]);
+    }
+
+    // 与原模型一致，粒子停留在影像边界上
+    x = std::max(0.0f, std::min((float)(size_.width - 1), x));
+    y = std::max(0.0f, std::min((float)(size_.height - 1), y));
+}
+
+void AlgaeParticleEngine::step(float seconds, int substeps, Integrator integrator) {
+    ALGAE_TRACE_SCOPE("particle_step");
+    ALGAE_TRACE_ANNOTATE("particles", x_.size());
+    substeps = std::max(1, substeps);
+    if (velocity_) {
+        stepTimeVarying(seconds, substeps, integrator);
+        return;
+    }
+    const float dt = seconds / substeps;
+
+    auto advance = [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            float x = x_[i];
+            float y = y_[i];
+            for (int s = 0; s < substeps; ++s) {
+                integrateParticle(x, y, dt, integrator);
+            }
+            x_[i] = x;
+            y_[i] = y;
+        }
+    };
+
+    // 粒子之间相互独立，按粒子区间并行
+    if (parallel_) {
+        cv::parallel_for_(cv::Range(0, (int)x_.size()), advance);
+    }
+    else {
+        advance(cv::Range(0, (int)x_.size()));
+    }
+    time_seconds_ += seconds;
+}
+
+void AlgaeParticleEngine::stepTimeVarying(float seconds, int substeps, Integrator integrator) {
+    const float dt = seconds / substeps;
+    for (int s = 0; s < substeps; ++s) {
+        const double substep_start = time_seconds_ + (double)s * dt;
+        // 子步窗口内通常只涉及前后两幅关键帧，其余关键帧在此解除映射
+        velocity_->prepare(substep_start, substep_start + dt);
+
+        auto advance = [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; ++i) {
+                integrateParticle(x_[i], y_[i], substep_start, dt, integrator);
+            }
+        };
+        if (parallel_) {
+            cv::parallel_for_(cv::Range(0, (int)x_.size()), advance);
+        }
+        else {
+            advance(cv::Range(0, (int)x_.size()));
+        }
+    }
+    time_seconds_ += seconds;
+}
+
+void AlgaeParticleEngine::step(float seconds, int substeps, Integrator integrator, float diffusion_m2_per_s, std::mt19937_64& rng) {
+    substeps = std::max(1, substeps);
+    const float dt = seconds / substeps;
+    // 随机游走步长标准差 sqrt(2·D·dt)，换算为像素
+    const float sigma_pixels = std::sqrt(2.0f * std::max(0.0f, diffusion_m2_per_s) * std::fabs(dt)) * pixels_per_meter_;
+    const float max_x = (float)(size_.width - 1);
+    const float max_y = (float)(size_.height - 1);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    if (velocity_) {
+        // 随机数须按粒子顺序抽取，无法逐子步切换关键帧，整个推进窗口一次映射
+        velocity_->prepare(time_seconds_, time_seconds_ + seconds);
+    }
+
+    // 随机数按粒子顺序依次抽取，同一种子的结果可复现
+    for (size_t i = 0; i < x_.size(); ++i) {
+        float x = x_[i];
+        float y = y_[i];
+        for (int s = 0; s < substeps; ++s) {
+            integrateParticle(x, y, time_seconds_ + (double)s * dt, dt, integrator);
+            if (sigma_pixels > 0.0f) {
+                x = std::max(0.0f, std::min(max_x, x + sigma_pixels * noise(rng)));
+                y = std::max(0.0f, std::min(max_y, y + sigma_pixels * noise(rng)));
+            }
+        }
+        x_[i] = x;
+        y_[i] = y;
+    }
+    time_seconds_ += seconds;
+}
+
+cv::Mat AlgaeParticleEngine::rasterize() const {
+    cv::Mat mask = cv::Mat::zeros(size_, CV_8U);
+    for (size_t i = 0; i < x_.size(); ++i) {
+        mask.at<uchar>(cvRound(y_[i]), cvRound(x_[i])) = 255;
+    }
+    return mask;
+}
+
+CompactMask AlgaeParticleEngine::rasterizeCompact() const {
+    CompactMask mask;
+    rasterizeCompact(mask);
+    return mask;
+}
+
+void AlgaeParticleEngine::rasterizeCompact(CompactMask& mask) const {
+    mask.create(size_);
+    mask.clear();
+    for (size_t i = 0; i < x_.size(); ++i) {
+        mask.set(cvRound(x_[i]), cvRound(y_[i]));
+    }
+}
+
+void AlgaeParticleEngine::rasterizeSparse(SparseTileMask& mask) const {
+    if (mask.size() != size_) {
+        mask = SparseTileMask(size_);
+    }
+    mask.clear();
+    for (size_t i = 0; i < x_.size(); ++i) {
+        mask.set(cvRound(x_[i]), cvRound(y_[i]));
+    }
+}
+
+cv::Mat AlgaeParticleEngine::rasterizeDensity() const {
+    cv::Mat density = cv::Mat::zeros(size_, CV_32F);
+    for (size_t i = 0; i < x_.size(); ++i) {
+        density.at<float>(cvRound(y_[i]), cvRound(x_[i])) += weight_[i];
+    }
+    return density;
+}
+
+void AlgaeParticleEngine::removeOutsideMask(const cv::Mat& mask) {
+    size_t kept = 0;
+    for (size_t i = 0; i < x_.size(); ++i) {
+        if (mask.at<uchar>(cvRound(y_[i]), cvRound(x_[i])) == 0) {
+            continue;
+        }
+        x_[kept] = x_[i];
+        y_[kept] = y_[i];
+        weight_[kept] = weight_[i];
+        ++kept;
+    }
+    x_.resize(kept);
+    y_.resize(kept);
+    weight_.resize(kept);
+}
+
+void AlgaeParticleEngine::removeOutsideMask(const CompactMask& mask) {
+    size_t kept = 0;
+    for (size_t i = 0; i < x_.size(); ++i) {
+        if (!mask.test(cvRound(x_[i]), cvRound(y_[i]))) {
+            continue;
+        }
+        x_[kept] = x_[i];
+        y_[kept] = y_[i];
+        weight_[kept] = weight_[i];
+        ++kept;
+    }
+    x_.resize(kept);
+    y_.resize(kept);
+    weight_.resize(kept);
+}
+
+size_t AlgaeParticleEngine::particleCount() const {
+    return x_.size();
+}
+
+double AlgaeParticleEngine::totalWeight() const {
+    double total = 0.0;
+    for (float w : weight_) {
+        total += w;
+    }
+    return total;
+}
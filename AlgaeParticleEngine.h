@@ -0,0 +1,89 @@
+// AlgaeParticleEngine.h
+#ifndef ALGAE_PARTICLE_ENGINE_H
+#define ALGAE_PARTICLE_ENGINE_H
+
+#include "CompactMask.h"
+#include "SparseTileMask.h"
+#include "VelocityProvider.h"
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <random>
+#include <vector>
+
+// 粒子位置的时间积分方法
+enum class Integrator {
+    Euler,
+    RK2,
+    RK4
+};
+
+// 持久化的拉格朗日粒子引擎
+// 粒子以结构体数组 (x, y, weight) 的形式跨时间步保存，不会因落入同一像素而合并；
+// 速度只在粒子所在位置双线性采样，掩膜在需要时才栅格化
+class AlgaeParticleEngine {
+public:
+    AlgaeParticleEngine(const cv::Mat& velocity_field_mps, float spatial_resolution = 50.0f);
+    // 随时间变化的流场：速度按粒子位置与当前模拟时刻向 velocity 请求，每个子步前先声明时间窗口
+    AlgaeParticleEngine(std::shared_ptr<VelocityProvider> velocity, float spatial_resolution = 50.0f);
+
+    // 每个藻华像素生成一个权重为1的粒子，清空已有粒子
+    void seedFromMask(const cv::Mat& algae_mask);
+    void seedFromMask(const CompactMask& algae_mask);
+    // 推进 seconds 秒，拆成 substeps 个子步积分
+    void step(float seconds, int substeps = 1, Integrator integrator = Integrator::RK2);
+    // 随机推进：每个子步积分后叠加随机游走扩散，diffusion_m2_per_s 为扩散系数（米²/秒）
+    void step(float seconds, int substeps, Integrator integrator, float diffusion_m2_per_s, std::mt19937_64& rng);
+    // 集合预报成员的流速扰动：采样到的流速整体缩放 scale 倍并旋转 rotation_radians
+    void setVelocityPerturbation(float scale, float rotation_radians);
+    // 关闭后 step 不再按粒子并行，供已在线程池中运行的调用方使用
+    void setParallel(bool parallel) { parallel_ = parallel; }
+    // 模拟时刻（秒，相对预报起点），每次 step 后前进相应秒数
+    double time() const { return time_seconds_; }
+    void setTime(double seconds) { time_seconds_ = seconds; }
+    // 按子步位移不超过 max_pixels_per_substep 个像素估计所需子步数
+    int suggestSubsteps(float seconds, float max_pixels_per_substep = 1.0f) const;
+
+    cv::Mat rasterize() const;          // CV_8U，有粒子的像素为255
+    CompactMask rasterizeCompact() const;  // 位压缩掩膜，有粒子的像素置位
+    void rasterizeCompact(CompactMask& mask) const;  // 同上，尺寸不变时复用 mask 的缓冲区
+    // 栅格化到稀疏瓦片掩膜，复用 mask 已有的瓦片内存，只分配有粒子的瓦片
+    void rasterizeSparse(SparseTileMask& mask) const;
+    cv::Mat rasterizeDensity() const;   // CV_32F，每个像素内的粒子权重之和
+    // 删除落在 mask 为0像素上的粒子，用于打捞后与掩膜同步
+    void removeOutsideMask(const cv::Mat& mask);
+    void removeOutsideMask(const CompactMask& mask);
+
+    size_t particleCount() const;
+    double totalWeight() const;
+    // 双线性采样当前时刻的流速，返回 像素/秒
+    cv::Vec2f sampleVelocity(float x, float y) const;
+
+    // 单个点从当前时刻积分 dt 秒（dt 为负时沿流场逆向追踪），结果限制在影像范围内；
+    // 时变流场须已 prepare 覆盖该时间窗口
+    void integrateParticle(float& x, float& y, float dt, Integrator integrator) const;
+
+    const std::vector<float>& xs() const { return x_; }
+    const std::vector<float>& ys() const { return y_; }
+    const std::vector<float>& weights() const { return weight_; }
+
+private:
+    cv::Vec2f sampleVelocity(float x, float y, double seconds) const;
+    void integrateParticle(float& x, float& y, double seconds, float dt, Integrator integrator) const;
+    // 时变流场按子步推进：每个子步先 prepare 该子步的时间窗口，再并行推进全部粒子
+    void stepTimeVarying(float seconds, int substeps, Integrator integrator);
+
+    cv::Mat velocity_field_mps_;                    // 定常流场，使用 velocity_ 时为空
+    std::shared_ptr<VelocityProvider> velocity_;    // 时变流场
+    cv::Size size_;
+    double time_seconds_;
+    float pixels_per_meter_;
+    float max_speed_pixels_;
+    float perturbation_cos_;    // 含缩放的旋转矩阵系数
+    float perturbation_sin_;
+    bool parallel_;
+    std::vector<float> x_;
+    std::vector<float> y_;
+    std::vector<float> weight_;
+};
+
+#endif
@@ -1,177 +1,271 @@
 // AlgaeSalvageSim.cpp（加分项实现）
 #include "AlgaeSalvageSim.h"
-#include "AlgaeSimulator.h"
+#include "AlgaeParticleEngine.h"
+#include "AlertZoneIndex.h"
 #include "ImageProcessor.h" 
+#include "FrameWriter.h"
+#include "ForecastSeriesWriter.h"
+#include "SimulationWorkspace.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 #include <iostream>
 #include <algorithm> 
 #include <cmath>   
 
 
-static bool is_pixel_in_circle(cv::Point p, cv::Point center, int radius_pixels) {
-    return cv::norm(p - center) <= radius_pixels;
-}
-
-static std::vector<cv::Point> get_algae_pixels_in_circle(const cv::Mat& mask, cv::Point center, int radius_pixels) {
-    std::vector<cv::Point> algae_pixels_in_zone;
-    std::vector<cv::Point> all_algae_pixels;
-    cv::findNonZero(mask, all_algae_pixels);
-
-    for (const auto& p : all_algae_pixels) {
-        if (is_pixel_in_circle(p, center, radius_pixels)) { 
-            algae_pixels_in_zone.push_back(p);
-        }
-    }
-    return algae_pixels_in_zone;
-}
-
-static void salvage_algae_pixels(cv::Mat& mask, cv::Point intake_center, int second_alert_radius_pixels, int total_pixels_to_remove_this_step) {
-    std::vector<cv::Point> algae_in_second_zone;
-    std::vector<cv::Point> all_algae_pixels_current;
-    cv::findNonZero(mask, all_algae_pixels_current);
-
-    for (const auto& p : all_algae_pixels_current) {
-        if (is_pixel_in_circle(p, intake_center, second_alert_radius_pixels)) {
-            algae_in_second_zone.push_back(p);
-        }
-    }
-
-    if (algae_in_second_zone.empty()) {
-        return;
-    }
-
-    std::sort(algae_in_second_zone.begin(), algae_in_second_zone.end(),
-        [&](const cv::Point& a, const cv::Point& b) {
-            return cv::norm(a - intake_center) < cv::norm(b - intake_center);
-        });
-
-    int num_to_remove = std::min((int)algae_in_second_zone.size(), total_pixels_to_remove_this_step);
-    for (int i = 0; i < num_to_remove; ++i) {
-        mask.at<uchar>(algae_in_second_zone[i].y, algae_in_second_zone[i].x) = 0;
-    }
-}
-
-
-void runAlgaeSalvageSimulation(
+SalvageScenario makeSalvageScenario(
     const cv::Mat& initial_algae_mask_t1,
     const cv::Mat& velocity_field_mps,
     const cv::Mat& colormap_t1,
-    float spatial_resolution_meters
+    float spatial_resolution_meters,
+    cv::Point intake_center
 ) {
-    std::cout << "\n--- 正在启动藻华打捞模拟 ---" << std::endl;
-
-    cv::Point taihu_intake_coord = cv::Point(758, 498);
-
     const float FIRST_ALERT_RADIUS_METERS = 500.0f;
     const float SECOND_ALERT_RADIUS_METERS = 1000.0f;
-
-    const int first_alert_radius_pixels = static_cast<int>(FIRST_ALERT_RADIUS_METERS / spatial_resolution_meters);
-    const int second_alert_radius_pixels = static_cast<int>(SECOND_ALERT_RADIUS_METERS / spatial_resolution_meters);
-
-    const int PIXELS_CLEANED_PER_BOAT_PER_TIMESTEP = 30;
-    const float SIM_TIME_STEP_MINUTES = 20.0f;
     const float TOTAL_SIMULATION_HOURS = 6.0f;
-    const int num_sim_steps = static_cast<int>(TOTAL_SIMULATION_HOURS * 60 / SIM_TIME_STEP_MINUTES);
-
-    AlgaeSimulator simulator;
 
-    int min_boats_needed = 0;
-    for (int num_boats = 1; ; ++num_boats) {
-        std::cout << "\n--- 尝试使用 " << num_boats << " 艘打捞船进行模拟 ---" << std::endl;
-        int current_health = 100;
-        bool mission_failed = false;
-
-        cv::Mat current_algae_mask = initial_algae_mask_t1.clone();
-
-        std::vector<cv::Point> initial_algae_in_second_zone = get_algae_pixels_in_circle(current_algae_mask, taihu_intake_coord, second_alert_radius_pixels);
-        for (const auto& p : initial_algae_in_second_zone) {
-            current_algae_mask.at<uchar>(p.y, p.x) = 0;
-        }
-        std::cout << "11:13 初始清理完成。当前血条: " << current_health << std::endl;
+    SalvageScenario scenario;
+    scenario.velocity_field_mps = velocity_field_mps;
+    scenario.colormap = colormap_t1;
+    scenario.intake_center = intake_center;
+    scenario.first_alert_radius_pixels = static_cast<int>(FIRST_ALERT_RADIUS_METERS / spatial_resolution_meters);
+    scenario.second_alert_radius_pixels = static_cast<int>(SECOND_ALERT_RADIUS_METERS / spatial_resolution_meters);
+    scenario.spatial_resolution_meters = spatial_resolution_meters;
+    scenario.pixels_cleaned_per_boat_per_step = 30;
+    scenario.step_minutes = 20.0f;
+    scenario.num_steps = static_cast<int>(TOTAL_SIMULATION_HOURS * 60 / scenario.step_minutes);
+
+    // 中心与半径固定，警戒区索引只构建一次
+    scenario.zone_index = std::make_shared<AlertZoneIndex>(intake_center, scenario.second_alert_radius_pixels, initial_algae_mask_t1.size());
+
+    // 11:13 初始清理：二级警戒圈内的藻华全部清除，与船只数量无关，只做一次
+    scenario.initial_algae_mask = CompactMask::fromMat(initial_algae_mask_t1);
+    scenario.zone_index->clearWithin(scenario.initial_algae_mask, scenario.second_alert_radius_pixels);
+    return scenario;
+}
 
-        cv::Mat simulation_display_base = colormap_t1.clone();
+SalvageOutcome simulateSalvage(const SalvageScenario& scenario, int num_boats, FrameSink* frame_sink,
+    ForecastSeriesWriter* series_writer) {
+    ALGAE_TRACE_SCOPE("simulate_salvage");
+    ALGAE_TRACE_ANNOTATE("boats", num_boats);
+    SalvageOutcome outcome;
+    outcome.num_boats = num_boats;
+    outcome.success = false;
+    outcome.failure_minutes = -1.0f;
+    outcome.buffer_reallocations = 0;
+    outcome.steady_state_allocations = 0;
+    outcome.health_trajectory.reserve(scenario.num_steps + 1);
+
+    const cv::Point taihu_intake_coord = scenario.intake_center;
+    const int first_alert_radius_pixels = scenario.first_alert_radius_pixels;
+    const int second_alert_radius_pixels = scenario.second_alert_radius_pixels;
+    const bool render = frame_sink != nullptr;
+    const AlertZoneIndex& zone_index = *scenario.zone_index;
+
+    AlgaeParticleEngine particle_engine(scenario.velocity_field_mps, scenario.spatial_resolution_meters);
+    const float step_seconds = scenario.step_minutes * 60.0f;
+    const int substeps = particle_engine.suggestSubsteps(step_seconds);
+
+    int current_health = 100;
+    bool mission_failed = false;
+    bool user_aborted = false;
+
+    // 打捞循环全程使用位压缩掩膜，只有渲染时才展开为彩色帧；掩膜与画面缓冲区跨步复用
+    SimulationWorkspace workspace;
+    CompactMask& current_algae_mask = workspace.compactMask(scenario.initial_algae_mask.size());
+    current_algae_mask = scenario.initial_algae_mask;
+    particle_engine.seedFromMask(current_algae_mask);
+
+    FrameRenderer* renderer = nullptr;
+    const std::string window_title = cv::format("Algae Salvage Simulation (Boats: %d)", num_boats);
+    bool pause_at_end = false;
+    double sim_scale_factor = 0.7;
+    if (render) {
+        // 底图与警戒圈只在显示分辨率上缩放一次，之后每步只重绘藻华有变化的瓦片
+        cv::Mat simulation_display_base = scenario.colormap.clone();
         cv::circle(simulation_display_base, taihu_intake_coord, first_alert_radius_pixels, cv::Scalar(0, 0, 255), 2);
         cv::circle(simulation_display_base, taihu_intake_coord, second_alert_radius_pixels, cv::Scalar(0, 255, 255), 2);
         cv::circle(simulation_display_base, taihu_intake_coord, 3, cv::Scalar(255, 0, 0), -1);
+        renderer = &workspace.renderer(simulation_display_base, sim_scale_factor);
+        std::cout << "11:13 初始清理完成。当前血条: " << current_health << std::endl;
+    }
 
-        double sim_scale_factor = 0.7;
-
-        for (int i = 0; i <= num_sim_steps; ++i) {
-            float current_sim_minutes = i * SIM_TIME_STEP_MINUTES;
+    for (int i = 0; i <= scenario.num_steps; ++i) {
+        float current_sim_minutes = i * scenario.step_minutes;
+        ALGAE_TRACE_SCOPE("salvage_step");
 
-            if (i > 0) {
-                cv::Mat predicted_mask_for_step = simulator.predictAlgaePosition(
-                    current_algae_mask,
-                    velocity_field_mps,
-                    SIM_TIME_STEP_MINUTES / 60.0f,
-                    spatial_resolution_meters
-                );
-                current_algae_mask = predicted_mask_for_step;
-            }
+        if (i > 0) {
+            particle_engine.step(step_seconds, substeps, Integrator::RK2);
+            particle_engine.rasterizeCompact(current_algae_mask);
+        }
 
-            int total_pixels_to_clean_this_step = num_boats * PIXELS_CLEANED_PER_BOAT_PER_TIMESTEP;
-            salvage_algae_pixels(current_algae_mask, taihu_intake_coord, second_alert_radius_pixels, total_pixels_to_clean_this_step);
+        int total_pixels_to_clean_this_step = num_boats * scenario.pixels_cleaned_per_boat_per_step;
+        zone_index.salvageNearestFirst(current_algae_mask, total_pixels_to_clean_this_step);
+        // 被打捞像素上的粒子一并移除
+        particle_engine.removeOutsideMask(current_algae_mask);
 
-            std::vector<cv::Point> algae_in_first_zone = get_algae_pixels_in_circle(current_algae_mask, taihu_intake_coord, first_alert_radius_pixels);
-            if (!algae_in_first_zone.empty()) {
-                current_health = 0;
-                mission_failed = true;
+        if (zone_index.anyWithin(current_algae_mask, first_alert_radius_pixels)) {
+            current_health = 0;
+            mission_failed = true;
+            if (render) {
                 std::cout << cv::format("预警: 藻华在 11:13 + %.1f 分钟 处进入一级警戒圈，血条清零！", current_sim_minutes) << std::endl;
             }
-            else {
-                std::vector<cv::Point> algae_in_second_and_outside_first;
-                std::vector<cv::Point> all_algae_pixels_current_after_salvage;
-                cv::findNonZero(current_algae_mask, all_algae_pixels_current_after_salvage);
-
-                for (const auto& p : all_algae_pixels_current_after_salvage) {
-                    if (is_pixel_in_circle(p, taihu_intake_coord, second_alert_radius_pixels) &&
-                        !is_pixel_in_circle(p, taihu_intake_coord, first_alert_radius_pixels)) {
-                        algae_in_second_and_outside_first.push_back(p);
-                    }
-                }
-                current_health -= algae_in_second_and_outside_first.size();
-            }
+        }
+        else {
+            current_health -= zone_index.countInAnnulus(current_algae_mask, first_alert_radius_pixels, second_alert_radius_pixels);
+        }
 
-            if (current_health < 0) {
-                current_health = 0;
+        if (current_health < 0) {
+            current_health = 0;
+        }
+        outcome.health_trajectory.push_back(current_health);
+        if (series_writer != nullptr) {
+            current_algae_mask.toMat(workspace.denseMask());
+            series_writer->writeStep("salvage_mask", current_sim_minutes, workspace.denseMask());
+        }
+
+        bool keep_running = true;
+        if (render) {
+            renderer->update(current_algae_mask);
+            renderer->drawText(cv::format("Time: 11:13 + %.0f min", current_sim_minutes), cv::Point(30, 30),
+                0.8, cv::Scalar(255, 255, 255), 2);
+            renderer->drawText(cv::format("Boats: %d", num_boats), cv::Point(30, 60),
+                0.8, cv::Scalar(255, 255, 255), 2);
+            renderer->drawText(cv::format("Health: %d", current_health), cv::Point(30, 90),
+                0.8, (current_health > 20 ? cv::Scalar(0, 255, 0) : cv::Scalar(0, 0, 255)), 2);
+
+            keep_running = frame_sink->submit(window_title, renderer->frame());
+        }
+        workspace.endStep();
+
+        if (current_health <= 0) {
+            mission_failed = true;
+            outcome.failure_minutes = current_sim_minutes;
+            if (render) {
+                std::cout << cv::format("使用 %d 艘船在 11:13 + %.0f 分钟 时血条耗尽，任务失败。", num_boats, current_sim_minutes) << std::endl;
+                pause_at_end = true;
             }
+            break;
+        }
+        if (!keep_running) {
+            user_aborted = true;
+            std::cout << "用户提前退出模拟。" << std::endl;
+            break;
+        }
+    }
 
-            cv::Mat frame = createColorMapFromMask(current_algae_mask, simulation_display_base);
-            cv::putText(frame, cv::format("Time: 11:13 + %.0f min", current_sim_minutes), cv::Point(30, 30),
-                cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 255, 255), 2);
-            cv::putText(frame, cv::format("Boats: %d", num_boats), cv::Point(30, 60),
-                cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(255, 255, 255), 2);
-            cv::putText(frame, cv::format("Health: %d", current_health), cv::Point(30, 90),
-                cv::FONT_HERSHEY_SIMPLEX, 0.8, (current_health > 20 ? cv::Scalar(0, 255, 0) : cv::Scalar(0, 0, 255)), 2);
+    if (render) {
+        frame_sink->endStream(window_title, pause_at_end);
+    }
 
-            cv::Mat frame_display;
-            cv::resize(frame, frame_display, cv::Size(), sim_scale_factor, sim_scale_factor, cv::INTER_AREA);
+    outcome.success = !mission_failed && !user_aborted && current_health > 0;
+    outcome.buffer_reallocations = workspace.bufferReallocations();
+    outcome.steady_state_allocations = workspace.steadyStateAllocations();
+    return outcome;
+}
 
-            cv::imshow(cv::format("Algae Salvage Simulation (Boats: %d)", num_boats), frame_display);
+FleetSearchResult findMinimumFleet(const SalvageScenario& scenario, size_t num_threads) {
+    ALGAE_TRACE_SCOPE("find_minimum_fleet");
+    ThreadPool pool(num_threads);
+    const int batch_size = static_cast<int>(pool.size());
 
-            if (current_health <= 0) {
-                mission_failed = true;
-                std::cout << cv::format("使用 %d 艘船在 11:13 + %.0f 分钟 时血条耗尽，任务失败。", num_boats, current_sim_minutes) << std::endl;
-                cv::waitKey(0);
-                break;
+    // 船队足以每步清空整个二级警戒圈时，藻华无法进入警戒圈，必然成功；以此为搜索上界，搜索总有解
+    const double zone_area = CV_PI * (scenario.second_alert_radius_pixels + 1) * (scenario.second_alert_radius_pixels + 1);
+    const int max_useful_boats = std::max(1, static_cast<int>(std::ceil(zone_area / scenario.pixels_cleaned_per_boat_per_step)));
+
+    FleetSearchResult result;
+
+    // 并行评估一批候选规模，返回时已记录到 result.evaluated
+    auto evaluate_batch = [&](const std::vector<int>& candidates) {
+        std::vector<std::future<SalvageOutcome>> pending;
+        for (int num_boats : candidates) {
+            pending.push_back(pool.submit([&scenario, num_boats] {
+                return simulateSalvage(scenario, num_boats);
+            }));
+        }
+        for (auto& future : pending) {
+            SalvageOutcome outcome = future.get();
+            std::cout << cv::format("  %d 艘船: %s", outcome.num_boats, outcome.success ? "成功" : "失败");
+            if (!outcome.success) {
+                std::cout << cv::format(" (11:13 + %.0f 分钟)", outcome.failure_minutes);
             }
-            if (cv::waitKey(100) == 27) {
-                mission_failed = true;
-                std::cout << "用户提前退出模拟。" << std::endl;
-                break;
+            std::cout << std::endl;
+            result.evaluated.push_back(outcome);
+        }
+    };
+
+    // 已知 lo 艘船失败（0 视为失败）、hi 艘船成功
+    int lo = 0;
+    int hi = max_useful_boats;
+    auto update_bounds = [&]() {
+        for (const auto& outcome : result.evaluated) {
+            if (outcome.success && outcome.num_boats < hi) hi = outcome.num_boats;
+        }
+        for (const auto& outcome : result.evaluated) {
+            if (!outcome.success && outcome.num_boats > lo && outcome.num_boats < hi) lo = outcome.num_boats;
+        }
+    };
+
+    // 指数探测：每批并行评估 batch_size 个依次翻倍的规模，直到出现成功的规模或探测到上界
+    int next_probe = 1;
+    while (next_probe < hi) {
+        std::vector<int> candidates;
+        for (int k = 0; k < batch_size && next_probe < hi; ++k) {
+            candidates.push_back(next_probe);
+            next_probe = std::min(next_probe * 2, hi);
+        }
+        std::cout << "指数探测 " << candidates.size() << " 个候选规模..." << std::endl;
+        evaluate_batch(candidates);
+        update_bounds();
+    }
+
+    // 多路二分：每轮把 (lo, hi) 均分为 batch_size + 1 段，并行评估分点
+    while (hi - lo > 1) {
+        std::vector<int> candidates;
+        int gap = hi - lo;
+        int count = std::min(batch_size, gap - 1);
+        for (int k = 1; k <= count; ++k) {
+            int candidate = lo + static_cast<int>(static_cast<long long>(gap) * k / (count + 1));
+            if (candidate > lo && candidate < hi && (candidates.empty() || candidate != candidates.back())) {
+                candidates.push_back(candidate);
             }
         }
+        std::cout << "二分搜索区间 (" << lo << ", " << hi << ")..." << std::endl;
+        evaluate_batch(candidates);
+        update_bounds();
+    }
 
-        cv::destroyAllWindows();
+    std::sort(result.evaluated.begin(), result.evaluated.end(),
+        [](const SalvageOutcome& a, const SalvageOutcome& b) { return a.num_boats < b.num_boats; });
+    result.min_boats = hi;
+    return result;
+}
 
-        if (!mission_failed && current_health > 0) {
-            min_boats_needed = num_boats;
-            std::cout << "\n--- 任务成功！在 11:13-17:13 时间范围内，最少需要 " << min_boats_needed << " 艘打捞船保持血条大于0。---" << std::endl;
-            break;
-        }
-        else {
-            std::cout << "使用 " << num_boats << " 艘打捞船任务失败，尝试增加船只数量..." << std::endl;
+void runAlgaeSalvageSimulation(
+    const cv::Mat& initial_algae_mask_t1,
+    const cv::Mat& velocity_field_mps,
+    const cv::Mat& colormap_t1,
+    float spatial_resolution_meters,
+    FrameSink& frame_sink,
+    ForecastSeriesWriter* series_writer
+) {
+    std::cout << "\n--- 正在启动藻华打捞模拟 ---" << std::endl;
+
+    SalvageScenario scenario = makeSalvageScenario(initial_algae_mask_t1, velocity_field_mps, colormap_t1, spatial_resolution_meters);
+    FleetSearchResult search = findMinimumFleet(scenario);
+
+    std::cout << "\n已评估的船队规模及血条变化:" << std::endl;
+    for (const auto& outcome : search.evaluated) {
+        std::cout << cv::format("  %3d 艘船 %s 血条:", outcome.num_boats, outcome.success ? "成功" : "失败");
+        for (int health : outcome.health_trajectory) {
+            std::cout << " " << health;
         }
+        std::cout << std::endl;
     }
 
+    std::cout << "\n--- 任务成功！在 11:13-17:13 时间范围内，最少需要 " << search.min_boats << " 艘打捞船保持血条大于0。---" << std::endl;
+    // 搜索与渲染解耦：只回放最小船队的过程
+    simulateSalvage(scenario, search.min_boats, &frame_sink, series_writer);
+
     std::cout << "\n--- 藻华打捞模拟结束 ---" << std::endl;
-}
\ No newline at end of file
+}
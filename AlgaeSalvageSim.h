@@ -2,17 +2,73 @@
 #ifndef ALGAE_SALVAGE_SIM_H
 #define ALGAE_SALVAGE_SIM_H
 
+#include "CompactMask.h"
 #include <opencv2/opencv.hpp> 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 class AlgaeSimulator;
+class FrameSink;
+class AlertZoneIndex;
+class ForecastSeriesWriter;
+
+// 打捞模拟的固定场景，各候选船队规模共享且只读
+struct SalvageScenario {
+    CompactMask initial_algae_mask; // 已完成二级警戒圈内的初始清理（位压缩，各候选规模共享）
+    cv::Mat velocity_field_mps;
+    cv::Mat colormap;               // 仅渲染时使用
+    cv::Point intake_center;
+    int first_alert_radius_pixels;
+    int second_alert_radius_pixels;
+    float spatial_resolution_meters;
+    int pixels_cleaned_per_boat_per_step;
+    float step_minutes;
+    int num_steps;
+    std::shared_ptr<const AlertZoneIndex> zone_index;  // 二级警戒半径内按距离排序的像素索引
+};
+
+// 单个船队规模的模拟结果
+struct SalvageOutcome {
+    int num_boats;
+    bool success;
+    float failure_minutes;              // 失败时刻（相对 11:13），成功时为 -1
+    std::vector<int> health_trajectory; // 每个时间步结束后的血条
+    size_t buffer_reallocations;        // 首步之后工作区缓冲区的重新分配次数，应为0（不含各步内部的临时分配）
+    uint64_t steady_state_allocations;  // 首步之后打捞循环线程上的 operator new 次数，只在跟踪构建中统计
+};
+
+// 最小船队搜索结果，evaluated 按船只数量升序排列
+struct FleetSearchResult {
+    int min_boats;                      // 保持血条大于0的最少船只数（清空整个二级警戒圈的船队必然成功，总有解）
+    std::vector<SalvageOutcome> evaluated;
+};
+
+SalvageScenario makeSalvageScenario(
+    const cv::Mat& initial_algae_mask_t1,
+    const cv::Mat& velocity_field_mps,
+    const cv::Mat& colormap_t1,
+    float spatial_resolution_meters,
+    cv::Point intake_center = cv::Point(758, 498)
+);
+
+// 模拟 num_boats 艘船的6小时打捞过程；frame_sink 为空时不渲染
+// 返回的 bool 为 false 表示用户在渲染时提前退出
+// series_writer 非空时每步的藻华掩膜写入 salvage_mask 时间序列
+SalvageOutcome simulateSalvage(const SalvageScenario& scenario, int num_boats, FrameSink* frame_sink = nullptr,
+    ForecastSeriesWriter* series_writer = nullptr);
+
+// 成功与否对船只数量单调：先指数探测再二分，每轮候选规模在线程池上并行评估
+FleetSearchResult findMinimumFleet(const SalvageScenario& scenario, size_t num_threads = 0);
 
 void runAlgaeSalvageSimulation(
     const cv::Mat& initial_algae_mask_t1,
     const cv::Mat& velocity_field_mps,   
     const cv::Mat& colormap_t1,           
-    float spatial_resolution_meters      
+    float spatial_resolution_meters,
+    FrameSink& frame_sink,
+    ForecastSeriesWriter* series_writer = nullptr
 );
 
-#endif 
\ No newline at end of file
+#endif 
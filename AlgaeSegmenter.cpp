@@ -0,0 +1,245 @@
+// AlgaeSegmenter.cpp（分块大津法藻华分割）
+#include "AlgaeSegmenter.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+
+// NDVI 的取值范围
+static const float NDVI_MIN = -1.0f;
+static const float NDVI_MAX = 1.0f;
+static const int MIN_TILE_SIZE = 16;
+
+AlgaeSegmenter::AlgaeSegmenter(const SegmentationOptions& options)
+    : options_(options), tiles_x_(1), tiles_y_(1), global_threshold_(options.fixed_threshold), adaptive_tiles_(0) {
+    options_.histogram_bins = std::max(2, options_.histogram_bins);
+    options_.tile_size = std::max(MIN_TILE_SIZE, options_.tile_size);
+}
+
+cv::Mat AlgaeSegmenter::segment(const cv::Mat& ndvi, const cv::Mat& valid_mask) {
+    cv::Mat mask;
+    segment(ndvi, valid_mask, mask);
+    return mask;
+}
+
+void AlgaeSegmenter::segment(const cv::Mat& ndvi, const cv::Mat& valid_mask, cv::Mat& mask) {
+    if (ndvi.empty() || ndvi.type() != CV_32F ||
+        (!valid_mask.empty() && (valid_mask.size() != ndvi.size() || valid_mask.type() != CV_8U))) {
+        std::cerr << "错误：藻华分割的输入无效。需要单通道浮点型NDVI及同尺寸的CV_8U有效掩膜。" << std::endl;
+        mask.release();
+        return;
+    }
+
+    ALGAE_TRACE_SCOPE("segment_algae");
+    ALGAE_TRACE_ANNOTATE("pixels", (double)ndvi.total());
+    mask.create(ndvi.size(), CV_8U);
+    tiles_x_ = tiles_y_ = 1;
+    adaptive_tiles_ = 0;
+    global_threshold_ = options_.fixed_threshold;
+
+    if (options_.mode == ThresholdMode::Fixed) {
+        tile_thresholds_ = cv::Mat(1, 1, CV_32F, cv::Scalar(global_threshold_));
+        thresholdUniform(ndvi, valid_mask, global_threshold_, mask);
+        return;
+    }
+
+    const bool tiled = options_.mode == ThresholdMode::TileOtsu;
+    buildHistograms(ndvi, valid_mask, tiled ? options_.tile_size : 0);
+
+    const int bins = options_.histogram_bins;
+    const int tile_count = tiles_x_ * tiles_y_;
+    std::vector<uint32_t> global_histogram(bins, 0);
+    for (int t = 0; t < tile_count; ++t) {
+        const uint32_t* histogram = &histograms_[(size_t)t * bins];
+        for (int i = 0; i < bins; ++i) {
+            global_histogram[i] += histogram[i];
+        }
+    }
+    OtsuResult global = otsu(global_histogram.data());
+    if (global.separable) {
+        global_threshold_ = global.threshold;
+    }
+
+    tile_thresholds_.create(tiles_y_, tiles_x_, CV_32F);
+    if (!tiled) {
+        tile_thresholds_.setTo(cv::Scalar(global_threshold_));
+        thresholdUniform(ndvi, valid_mask, global_threshold_, mask);
+        return;
+    }
+
+    for (int t = 0; t < tile_count; ++t) {
+        OtsuResult local = otsu(&histograms_[(size_t)t * bins]);
+        tile_thresholds_.at<float>(t / tiles_x_, t % tiles_x_) = local.separable ? local.threshold : global_threshold_;
+        if (local.separable) {
+            ++adaptive_tiles_;
+        }
+    }
+    ALGAE_TRACE_ANNOTATE("adaptive_tiles", adaptive_tiles_);
+    thresholdInterpolated(ndvi, valid_mask, mask);
+}
+
+void AlgaeSegmenter::buildHistograms(const cv::Mat& ndvi, const cv::Mat& valid_mask, int tile) {
+    const int bins = options_.histogram_bins;
+    const int tile_width = tile > 0 ? tile : ndvi.cols;
+    const int tile_height = tile > 0 ? tile : ndvi.rows;
+    tiles_x_ = (ndvi.cols + tile_width - 1) / tile_width;
+    tiles_y_ = (ndvi.rows + tile_height - 1) / tile_height;
+    histograms_.assign((size_t)tiles_x_ * tiles_y_ * bins, 0);
+    const float scale = bins / (NDVI_MAX - NDVI_MIN);
+    const float max_bin = (float)(bins - 1);
+
+    // 瓦片之间互不重叠，各自写入自己的直方图，无需同步；
+    // 不分块时按行带并行，各行带先累加到局部直方图再合并
+    auto accumulate = [&](const cv::Rect& region, uint32_t* histogram) {
+        for (int y = region.y; y < region.y + region.height; ++y) {
+            const float* n = ndvi.ptr<float>(y);
+            const uchar* valid = valid_mask.empty() ? NULL : valid_mask.ptr<uchar>(y);
+            for (int x = region.x; x < region.x + region.width; ++x) {
+                const float v = n[x];
+                // NaN（无数据像素 0/0）不参与统计
+                if (v != v || (valid && !valid[x])) continue;
+                const float position = std::max(0.0f, std::min(max_bin, (v - NDVI_MIN) * scale));
+                ++histogram[(int)position];
+            }
+        }
+    };
+
+    if (tile > 0) {
+        cv::parallel_for_(cv::Range(0, tiles_x_ * tiles_y_), [&](const cv::Range& range) {
+            for (int t = range.start; t < range.end; ++t) {
+                const int tx = t % tiles_x_;
+                const int ty = t / tiles_x_;
+                cv::Rect region(tx * tile_width, ty * tile_height, tile_width, tile_height);
+                accumulate(region & cv::Rect(0, 0, ndvi.cols, ndvi.rows), &histograms_[(size_t)t * bins]);
+            }
+        });
+        return;
+    }
+
+    std::mutex merge_mutex;
+    cv::parallel_for_(cv::Range(0, ndvi.rows), [&](const cv::Range& range) {
+        std::vector<uint32_t> local(bins, 0);
+        accumulate(cv::Rect(0, range.start, ndvi.cols, range.end - range.start), local.data());
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        for (int i = 0; i < bins; ++i) {
+            histograms_[i] += local[i];
+        }
+    });
+}
+
+AlgaeSegmenter::OtsuResult AlgaeSegmenter::otsu(const uint32_t* histogram) const {
+    const int bins = options_.histogram_bins;
+    const double bin_width = (NDVI_MAX - NDVI_MIN) / bins;
+    double total = 0.0, sum = 0.0;
+    for (int i = 0; i < bins; ++i) {
+        total += histogram[i];
+        sum += (double)i * histogram[i];
+    }
+    OtsuResult result = { global_threshold_, false };
+    if (total < options_.min_tile_samples) {
+        return result;
+    }
+
+    const double mean = sum / total;
+    double total_variance = 0.0;
+    for (int i = 0; i < bins; ++i) {
+        total_variance += histogram[i] * (i - mean) * (i - mean);
+    }
+    total_variance /= total;
+    if (total_variance <= 0.0) {
+        return result;
+    }
+
+    // 以格为单位搜索类间方差最大的分割点
+    double weight_below = 0.0, sum_below = 0.0;
+    double best_between = -1.0, best_separation = 0.0;
+    int best_bin = 0;
+    for (int k = 0; k < bins - 1; ++k) {
+        weight_below += histogram[k];
+        sum_below += (double)k * histogram[k];
+        if (weight_below == 0.0) continue;
+        const double weight_above = total - weight_below;
+        if (weight_above == 0.0) break;
+
+        const double mean_below = sum_below / weight_below;
+        const double mean_above = (sum - sum_below) / weight_above;
+        const double between = weight_below * weight_above * (mean_above - mean_below) * (mean_above - mean_below) / (total * total);
+        if (between > best_between) {
+            best_between = between;
+            best_bin = k;
+            best_separation = (mean_above - mean_below) * bin_width;
+        }
+    }
+
+    result.threshold = (float)(NDVI_MIN + (best_bin + 1) * bin_width);
+    result.separable = best_between / total_variance >= options_.min_effectiveness &&
+        best_separation >= options_.min_class_separation;
+    return result;
+}
+
+void AlgaeSegmenter::thresholdUniform(const cv::Mat& ndvi, const cv::Mat& valid_mask, float threshold, cv::Mat& mask) const {
+    cv::parallel_for_(cv::Range(0, ndvi.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float* n = ndvi.ptr<float>(y);
+            const uchar* valid = valid_mask.empty() ? NULL : valid_mask.ptr<uchar>(y);
+            uchar* m = mask.ptr<uchar>(y);
+            for (int x = 0; x < ndvi.cols; ++x) {
+                m[x] = (n[x] > threshold && (!valid || valid[x])) ? 255 : 0;
+            }
+        }
+    });
+}
+
+void AlgaeSegmenter::thresholdInterpolated(const cv::Mat& ndvi, const cv::Mat& valid_mask, cv::Mat& mask) const {
+    const float tile = (float)options_.tile_size;
+
+    // 像素到瓦片中心网格的坐标：落在首个中心之前或末个中心之后时取端点瓦片的阈值
+    auto locate = [&](int pixel, int tiles, int& index, float& fraction) {
+        float grid = (pixel + 0.5f) / tile - 0.5f;
+        index = (int)std::floor(grid);
+        fraction = grid - index;
+        if (index < 0) {
+            index = 0;
+            fraction = 0.0f;
+        }
+        else if (index >= tiles - 1) {
+            index = tiles - 1;
+            fraction = 0.0f;
+        }
+    };
+
+    // 列方向的插值位置与权重对所有行相同，预先算好
+    std::vector<int> column_tile(ndvi.cols);
+    std::vector<float> column_fraction(ndvi.cols);
+    for (int x = 0; x < ndvi.cols; ++x) {
+        locate(x, tiles_x_, column_tile[x], column_fraction[x]);
+    }
+
+    cv::parallel_for_(cv::Range(0, ndvi.rows), [&](const cv::Range& range) {
+        // 末尾多放一个与最后一列瓦片相同的值，插值时不必判断右边界
+        std::vector<float> row_thresholds(tiles_x_ + 1);
+        for (int y = range.start; y < range.end; ++y) {
+            int ty0;
+            float fy;
+            locate(y, tiles_y_, ty0, fy);
+            const int ty1 = std::min(ty0 + 1, tiles_y_ - 1);
+            const float* top = tile_thresholds_.ptr<float>(ty0);
+            const float* bottom = tile_thresholds_.ptr<float>(ty1);
+            for (int tx = 0; tx < tiles_x_; ++tx) {
+                row_thresholds[tx] = top[tx] * (1.0f - fy) + bottom[tx] * fy;
+            }
+            row_thresholds[tiles_x_] = row_thresholds[tiles_x_ - 1];
+
+            const float* n = ndvi.ptr<float>(y);
+            const uchar* valid = valid_mask.empty() ? NULL : valid_mask.ptr<uchar>(y);
+            uchar* m = mask.ptr<uchar>(y);
+            for (int x = 0; x < ndvi.cols; ++x) {
+                const int tx = column_tile[x];
+                const float fx = column_fraction[x];
+                const float threshold = row_thresholds[tx] * (1.0f - fx) + row_thresholds[tx + 1] * fx;
+                m[x] = (n[x] > threshold && (!valid || valid[x])) ? 255 : 0;
+            }
+        }
+    });
+}
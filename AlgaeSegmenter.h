@@ -0,0 +1,68 @@
+// AlgaeSegmenter.h
+#ifndef ALGAE_SEGMENTER_H
+#define ALGAE_SEGMENTER_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+// 藻华掩膜的阈值方式
+enum class ThresholdMode {
+    Fixed,          // 全图固定阈值（原先的 NDVI > 0）
+    GlobalOtsu,     // 全图大津法
+    TileOtsu        // 分块大津法，阈值在瓦片中心之间双线性插值
+};
+
+struct SegmentationOptions {
+    ThresholdMode mode = ThresholdMode::TileOtsu;
+    float fixed_threshold = 0.0f;           // Fixed 模式的阈值，也是全图直方图不可分时的回退值
+    int tile_size = 256;                    // 分块大津法的瓦片边长（像素）
+    int histogram_bins = 256;               // NDVI [-1, 1] 等分的直方图格数
+    int min_tile_samples = 1024;            // 有效像素少于此数的瓦片不单独定阈值
+    // 可分性判据：类间方差占总方差的比例（单峰高斯约为0.64）与两类 NDVI 均值之差，
+    // 任一不满足时视为单峰，瓦片回退到全图阈值，全图回退到 fixed_threshold
+    float min_effectiveness = 0.75f;
+    float min_class_separation = 0.15f;
+};
+
+// 分块大津法藻华分割
+// 第一遍按瓦片并行统计 NDVI 直方图（全图直方图由瓦片直方图相加得到，不再单独遍历），
+// 各瓦片求大津阈值；第二遍按行并行，用相邻四个瓦片中心的阈值双线性插值得到逐像素阈值并输出掩膜。
+// 雾霾与太阳耀斑使局部 NDVI 整体偏移时，局部阈值随之移动，不会把整片水面误判为藻华
+class AlgaeSegmenter {
+public:
+    explicit AlgaeSegmenter(const SegmentationOptions& options = SegmentationOptions());
+
+    // 返回 CV_8U 掩膜，NDVI 高于所在位置阈值处为255；valid_mask 非空时其为0的像素不参与统计且输出为0
+    cv::Mat segment(const cv::Mat& ndvi, const cv::Mat& valid_mask = cv::Mat());
+    // 同上，结果写入 mask，尺寸与类型不变时复用其缓冲区
+    void segment(const cv::Mat& ndvi, const cv::Mat& valid_mask, cv::Mat& mask);
+
+    // 最近一次 segment 的全图阈值与各瓦片阈值（CV_32F，瓦片行 × 瓦片列）
+    float globalThreshold() const { return global_threshold_; }
+    const cv::Mat& tileThresholds() const { return tile_thresholds_; }
+    // 采用自身大津阈值（未回退到全图阈值）的瓦片数
+    int adaptiveTileCount() const { return adaptive_tiles_; }
+
+private:
+    struct OtsuResult {
+        float threshold;
+        bool separable;
+    };
+
+    // 统计每个瓦片的直方图，tile 为0时整幅作为一个瓦片
+    void buildHistograms(const cv::Mat& ndvi, const cv::Mat& valid_mask, int tile);
+    OtsuResult otsu(const uint32_t* histogram) const;
+    void thresholdUniform(const cv::Mat& ndvi, const cv::Mat& valid_mask, float threshold, cv::Mat& mask) const;
+    void thresholdInterpolated(const cv::Mat& ndvi, const cv::Mat& valid_mask, cv::Mat& mask) const;
+
+    SegmentationOptions options_;
+    int tiles_x_;
+    int tiles_y_;
+    std::vector<uint32_t> histograms_;      // 瓦片直方图依次存放
+    cv::Mat tile_thresholds_;
+    float global_threshold_;
+    int adaptive_tiles_;
+};
+
+#endif
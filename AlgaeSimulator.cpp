@@ -1,7 +1,61 @@
 // AlgaeSimulator.cpp（利用漂移矢量，驱动藻华像素漂移）
 
 #include "AlgaeSimulator.h"
-#include <vector>
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 对每个置位像素按 velocity_at(x, y) 给出的流速平移，落点（限制在影像内）交给 emit(x, y)；
+// 流速逐点换算为像素位移，不再生成整幅位移场
+template <typename Mask, typename Velocity, typename Emit>
+void advectSetPixels(
+    const Mask& initial_algae_mask,
+    Velocity&& velocity_at,
+    float hours_ahead,
+    float spatial_resolution,
+    Emit&& emit
+) {
+    ALGAE_TRACE_SCOPE("predict_algae_position");
+    const float pixels_per_mps = hours_ahead * 3600.0f / spatial_resolution;
+    const int rows = initial_algae_mask.rows();
+    const int cols = initial_algae_mask.cols();
+    ALGAE_TRACE_ANNOTATE("particles", initial_algae_mask.count());
+
+    initial_algae_mask.forEachSet([&](int x, int y) {
+        const cv::Vec2f velocity = velocity_at(x, y);
+
+        float new_x = x + velocity[0] * pixels_per_mps;
+        float new_y = y + velocity[1] * pixels_per_mps;
+
+        int final_x = std::max(0, std::min(cols - 1, static_cast<int>(std::round(new_x))));
+        int final_y = std::max(0, std::min(rows - 1, static_cast<int>(std::round(new_y))));
+
+        emit(final_x, final_y);
+    });
+}
+
+// 定常流场：直接读取像素处的流速
+struct FieldVelocity {
+    const cv::Mat& field;
+    cv::Vec2f operator()(int x, int y) const { return field.at<cv::Vec2f>(y, x); }
+};
+
+// 时变流场：在预报区间的中点时刻求值
+struct ProviderVelocity {
+    const VelocityProvider& velocity;
+    double seconds;
+
+    static ProviderVelocity prepare(VelocityProvider& velocity, double start_seconds, float hours_ahead) {
+        const double mid_seconds = start_seconds + hours_ahead * 1800.0;
+        velocity.prepare(mid_seconds, mid_seconds);
+        return ProviderVelocity{ velocity, mid_seconds };
+    }
+    cv::Vec2f operator()(int x, int y) const { return velocity.sample((float)x, (float)y, seconds); }
+};
+
+}
 
 AlgaeSimulator::AlgaeSimulator() {}
 
@@ -11,28 +65,91 @@ cv::Mat AlgaeSimulator::predictAlgaePosition(
     float hours_ahead,
     float spatial_resolution
 ) const {
-    float time_in_seconds = hours_ahead * 3600.0f;
-    cv::Mat displacement_field_pixels = velocity_field_mps * (time_in_seconds / spatial_resolution);
+    return predictAlgaePosition(CompactMask::fromMat(initial_algae_mask), velocity_field_mps, hours_ahead, spatial_resolution).toMat();
+}
 
-    cv::Mat predicted_mask = cv::Mat::zeros(initial_algae_mask.size(), CV_8U);
-
-    std::vector<cv::Point> algae_locations;
-    cv::findNonZero(initial_algae_mask, algae_locations);
+CompactMask AlgaeSimulator::predictAlgaePosition(
+    const CompactMask& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    float hours_ahead,
+    float spatial_resolution
+) const {
+    CompactMask predicted_mask;
+    predictAlgaePosition(initial_algae_mask, velocity_field_mps, hours_ahead, spatial_resolution, predicted_mask);
+    return predicted_mask;
+}
 
-    int rows = predicted_mask.rows;
-    int cols = predicted_mask.cols;
+SparseTileMask AlgaeSimulator::predictAlgaePosition(
+    const SparseTileMask& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    float hours_ahead,
+    float spatial_resolution
+) const {
+    SparseTileMask predicted_mask;
+    predictAlgaePosition(initial_algae_mask, velocity_field_mps, hours_ahead, spatial_resolution, predicted_mask);
+    return predicted_mask;
+}
 
-    for (const cv::Point& start_pos : algae_locations) {
-        const cv::Vec2f& displacement = displacement_field_pixels.at<cv::Vec2f>(start_pos.y, start_pos.x);
+void AlgaeSimulator::predictAlgaePosition(
+    const CompactMask& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    float hours_ahead,
+    float spatial_resolution,
+    CompactMask& predicted_mask
+) const {
+    CV_Assert(&predicted_mask != &initial_algae_mask);
+    predicted_mask.create(initial_algae_mask.size());
+    predicted_mask.clear();
+    advectSetPixels(initial_algae_mask, FieldVelocity{ velocity_field_mps }, hours_ahead, spatial_resolution,
+        [&predicted_mask](int x, int y) { predicted_mask.set(x, y); });
+}
 
-        float new_x = start_pos.x + displacement[0];
-        float new_y = start_pos.y + displacement[1];
+void AlgaeSimulator::predictAlgaePosition(
+    const SparseTileMask& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    float hours_ahead,
+    float spatial_resolution,
+    SparseTileMask& predicted_mask
+) const {
+    CV_Assert(&predicted_mask != &initial_algae_mask);
+    if (predicted_mask.size() != initial_algae_mask.size()) {
+        predicted_mask = SparseTileMask(initial_algae_mask.size());
+    }
+    predicted_mask.clear();
+    advectSetPixels(initial_algae_mask, FieldVelocity{ velocity_field_mps }, hours_ahead, spatial_resolution,
+        [&predicted_mask](int x, int y) { predicted_mask.set(x, y); });
+}
 
-        int final_x = std::max(0, std::min(cols - 1, static_cast<int>(round(new_x))));
-        int final_y = std::max(0, std::min(rows - 1, static_cast<int>(round(new_y))));
+void AlgaeSimulator::predictAlgaePosition(
+    const CompactMask& initial_algae_mask,
+    VelocityProvider& velocity,
+    double start_seconds,
+    float hours_ahead,
+    float spatial_resolution,
+    CompactMask& predicted_mask
+) const {
+    CV_Assert(&predicted_mask != &initial_algae_mask);
+    CV_Assert(velocity.size() == initial_algae_mask.size());
+    predicted_mask.create(initial_algae_mask.size());
+    predicted_mask.clear();
+    advectSetPixels(initial_algae_mask, ProviderVelocity::prepare(velocity, start_seconds, hours_ahead),
+        hours_ahead, spatial_resolution, [&predicted_mask](int x, int y) { predicted_mask.set(x, y); });
+}
 
-        predicted_mask.at<uchar>(final_y, final_x) = 255;
+void AlgaeSimulator::predictAlgaePosition(
+    const SparseTileMask& initial_algae_mask,
+    VelocityProvider& velocity,
+    double start_seconds,
+    float hours_ahead,
+    float spatial_resolution,
+    SparseTileMask& predicted_mask
+) const {
+    CV_Assert(&predicted_mask != &initial_algae_mask);
+    CV_Assert(velocity.size() == initial_algae_mask.size());
+    if (predicted_mask.size() != initial_algae_mask.size()) {
+        predicted_mask = SparseTileMask(initial_algae_mask.size());
     }
-
-    return predicted_mask;
-}
\ No newline at end of file
+    predicted_mask.clear();
+    advectSetPixels(initial_algae_mask, ProviderVelocity::prepare(velocity, start_seconds, hours_ahead),
+        hours_ahead, spatial_resolution, [&predicted_mask](int x, int y) { predicted_mask.set(x, y); });
+}
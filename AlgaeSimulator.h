@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include "CompactMask.h"
+#include "SparseTileMask.h"
+#include "VelocityProvider.h"
 #include <opencv2/opencv.hpp>
 
 class AlgaeSimulator {
@@ -13,4 +16,53 @@ public:
         float hours_ahead,
         float spatial_resolution = 50.0f
     ) const;
+    // 位压缩掩膜版本：直接按置位像素推演，不生成坐标列表
+    CompactMask predictAlgaePosition(
+        const CompactMask& initial_algae_mask,
+        const cv::Mat& velocity_field_mps,
+        float hours_ahead,
+        float spatial_resolution = 50.0f
+    ) const;
+    // 稀疏瓦片版本：只访问含藻华的瓦片，结果只为落点所在瓦片分配内存
+    SparseTileMask predictAlgaePosition(
+        const SparseTileMask& initial_algae_mask,
+        const cv::Mat& velocity_field_mps,
+        float hours_ahead,
+        float spatial_resolution = 50.0f
+    ) const;
+
+    // 输出参数版本：结果写入 predicted_mask 并复用其缓冲区，逐步调用时不再分配
+    void predictAlgaePosition(
+        const CompactMask& initial_algae_mask,
+        const cv::Mat& velocity_field_mps,
+        float hours_ahead,
+        float spatial_resolution,
+        CompactMask& predicted_mask
+    ) const;
+    void predictAlgaePosition(
+        const SparseTileMask& initial_algae_mask,
+        const cv::Mat& velocity_field_mps,
+        float hours_ahead,
+        float spatial_resolution,
+        SparseTileMask& predicted_mask
+    ) const;
+
+    // 时变流场版本：每个像素按预报区间中点时刻（start_seconds + hours_ahead / 2）的流速一次平移，
+    // 流速只在置位像素处求值
+    void predictAlgaePosition(
+        const CompactMask& initial_algae_mask,
+        VelocityProvider& velocity,
+        double start_seconds,
+        float hours_ahead,
+        float spatial_resolution,
+        CompactMask& predicted_mask
+    ) const;
+    void predictAlgaePosition(
+        const SparseTileMask& initial_algae_mask,
+        VelocityProvider& velocity,
+        double start_seconds,
+        float hours_ahead,
+        float spatial_resolution,
+        SparseTileMask& predicted_mask
+    ) const;
 };
\ No newline at end of file
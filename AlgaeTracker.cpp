@@ -1,6 +1,10 @@
 // AlgaeTracker.cpp（提取藻华漂移矢量）
 
 #include "AlgaeTracker.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 #include <vector>
 
 AlgaeTracker::AlgaeTracker() {}
@@ -22,6 +26,26 @@ cv::Mat formatImageForFlow(const cv::Mat& ndvi_image) {
 }
 
 
+// 光流的Y分量取反，直接在原数据上修改
+static void flipFlowYInPlace(cv::Mat& flow) {
+    for (int y = 0; y < flow.rows; ++y) {
+        cv::Vec2f* row = flow.ptr<cv::Vec2f>(y);
+        for (int x = 0; x < flow.cols; ++x) {
+            row[x][1] = -row[x][1];
+        }
+    }
+}
+
+static void computeDenseFlow(const cv::Mat& prev, const cv::Mat& curr, cv::Mat& flow, FlowBackend backend) {
+    if (backend == FlowBackend::DIS) {
+        cv::Ptr<cv::DISOpticalFlow> dis = cv::DISOpticalFlow::create(cv::DISOpticalFlow::PRESET_MEDIUM);
+        dis->calc(prev, curr, flow);
+    }
+    else {
+        cv::calcOpticalFlowFarneback(prev, curr, flow, 0.5, 5, 80, 10, 7, 1.5, cv::OPTFLOW_FARNEBACK_GAUSSIAN);
+    }
+}
+
 cv::Mat AlgaeTracker::calculateOpticalFlow(const cv::Mat& ndvi_t0, const cv::Mat& ndvi_t1) {
     if (ndvi_t0.empty() || ndvi_t1.empty()) {
         return cv::Mat();
@@ -30,17 +54,189 @@ cv::Mat AlgaeTracker::calculateOpticalFlow(const cv::Mat& ndvi_t0, const cv::Mat
     cv::Mat prev = formatImageForFlow(ndvi_t0);
     cv::Mat curr = formatImageForFlow(ndvi_t1);
 
+    ALGAE_TRACE_SCOPE("optical_flow");
+    ALGAE_TRACE_ANNOTATE("pixels", prev.total());
     cv::Mat flow;
-    cv::calcOpticalFlowFarneback(prev, curr, flow, 0.5, 5, 80, 10, 7, 1.5, cv::OPTFLOW_FARNEBACK_GAUSSIAN);
+    computeDenseFlow(prev, curr, flow, FlowBackend::Farneback);
+    flipFlowYInPlace(flow);
+
+    return flow;
+}
+
+cv::Mat AlgaeTracker::calculateOpticalFlow(const cv::Mat& ndvi_t0, const cv::Mat& ndvi_t1, const cv::Mat& roi_mask, const FlowOptions& options) {
+    if (ndvi_t0.empty() || ndvi_t1.empty()) {
+        return cv::Mat();
+    }
+
+    cv::Mat prev = formatImageForFlow(ndvi_t0);
+    cv::Mat curr = formatImageForFlow(ndvi_t1);
+
+    ALGAE_TRACE_SCOPE("optical_flow");
+    ALGAE_TRACE_ANNOTATE("pixels", prev.total());
+    if (!options.tiled || roi_mask.empty()) {
+        cv::Mat flow;
+        computeDenseFlow(prev, curr, flow, options.backend);
+        flipFlowYInPlace(flow);
+        return flow;
+    }
+
+    // 只保留与掩膜重叠的瓦片
+    const cv::Rect image_rect(0, 0, prev.cols, prev.rows);
+    const int tile_size = std::max(16, options.tile_size);
+    const int padding = std::max(1, options.tile_padding);
+    std::vector<cv::Rect> active_tiles;
+    for (int y = 0; y < prev.rows; y += tile_size) {
+        for (int x = 0; x < prev.cols; x += tile_size) {
+            cv::Rect tile = cv::Rect(x, y, tile_size, tile_size) & image_rect;
+            if (cv::countNonZero(roi_mask(tile)) > 0) {
+                active_tiles.push_back(tile);
+            }
+        }
+    }
+
+    cv::Mat weighted_flow = cv::Mat::zeros(prev.size(), CV_32FC2);
+    cv::Mat weight_sum = cv::Mat::zeros(prev.size(), CV_32F);
+    std::mutex accumulate_mutex;
+
+    // 各瓦片在扩展后的区域上独立计算光流，再以羽化权重累加，接缝处平滑过渡
+    cv::parallel_for_(cv::Range(0, (int)active_tiles.size()), [&](const cv::Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            const cv::Rect& tile = active_tiles[t];
+            cv::Rect padded(tile.x - padding, tile.y - padding, tile.width + 2 * padding, tile.height + 2 * padding);
+            padded &= image_rect;
+            ALGAE_TRACE_SCOPE("optical_flow_tile");
+            ALGAE_TRACE_ANNOTATE("pixels", padded.area());
+
+            cv::Mat tile_flow;
+            computeDenseFlow(prev(padded).clone(), curr(padded).clone(), tile_flow, options.backend);
+
+            // 权重在扩展区域边缘为0附近，向内线性增加到1
+            cv::Mat weight(padded.size(), CV_32F);
+            for (int y = 0; y < padded.height; ++y) {
+                float wy = std::min(1.0f, (std::min(y, padded.height - 1 - y) + 1.0f) / padding);
+                float* weight_row = weight.ptr<float>(y);
+                for (int x = 0; x < padded.width; ++x) {
+                    float wx = std::min(1.0f, (std::min(x, padded.width - 1 - x) + 1.0f) / padding);
+                    weight_row[x] = wx * wy;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(accumulate_mutex);
+            for (int y = 0; y < padded.height; ++y) {
+                const cv::Vec2f* flow_row = tile_flow.ptr<cv::Vec2f>(y);
+                const float* weight_row = weight.ptr<float>(y);
+                cv::Vec2f* acc_row = weighted_flow.ptr<cv::Vec2f>(padded.y + y) + padded.x;
+                float* sum_row = weight_sum.ptr<float>(padded.y + y) + padded.x;
+                for (int x = 0; x < padded.width; ++x) {
+                    acc_row[x] += flow_row[x] * weight_row[x];
+                    sum_row[x] += weight_row[x];
+                }
+            }
+        }
+    });
+
+    // 归一化并在同一遍中完成Y分量取反
+    for (int y = 0; y < weighted_flow.rows; ++y) {
+        cv::Vec2f* flow_row = weighted_flow.ptr<cv::Vec2f>(y);
+        const float* sum_row = weight_sum.ptr<float>(y);
+        for (int x = 0; x < weighted_flow.cols; ++x) {
+            if (sum_row[x] > 0) {
+                flow_row[x] = cv::Vec2f(flow_row[x][0] / sum_row[x], -flow_row[x][1] / sum_row[x]);
+            }
+        }
+    }
+
+    return weighted_flow;
+}
+
+cv::Mat AlgaeTracker::refineOpticalFlow(const cv::Mat& ndvi_t0, const cv::Mat& ndvi_t1, const cv::Mat& initial_flow) {
+    if (ndvi_t0.empty() || ndvi_t1.empty()) {
+        return cv::Mat();
+    }
+    if (initial_flow.empty() || initial_flow.size() != ndvi_t0.size() || initial_flow.type() != CV_32FC2) {
+        return calculateOpticalFlow(ndvi_t0, ndvi_t1);
+    }
 
-    std::vector<cv::Mat> flow_channels;
-    cv::split(flow, flow_channels);
-    flow_channels[1] = -flow_channels[1];
-    cv::merge(flow_channels, flow);
+    ALGAE_TRACE_SCOPE("optical_flow_refine");
+    ALGAE_TRACE_ANNOTATE("pixels", ndvi_t0.total());
+    cv::Mat prev = formatImageForFlow(ndvi_t0);
+    cv::Mat curr = formatImageForFlow(ndvi_t1);
 
+    // 初值须还原为影像坐标（Y分量取反前），细化后再统一取反
+    cv::Mat flow = initial_flow.clone();
+    flipFlowYInPlace(flow);
+    cv::calcOpticalFlowFarneback(prev, curr, flow, 0.5, 2, 80, 10, 7, 1.5,
+        cv::OPTFLOW_FARNEBACK_GAUSSIAN | cv::OPTFLOW_USE_INITIAL_FLOW);
+    flipFlowYInPlace(flow);
     return flow;
 }
 
+cv::Mat AlgaeTracker::upsampleFlow(const cv::Mat& coarse_flow, cv::Size full_size) {
+    if (coarse_flow.empty()) {
+        return cv::Mat();
+    }
+    cv::Mat flow;
+    cv::resize(coarse_flow, flow, full_size, 0, 0, cv::INTER_LINEAR);
+    const float scale_x = (float)full_size.width / coarse_flow.cols;
+    const float scale_y = (float)full_size.height / coarse_flow.rows;
+    cv::parallel_for_(cv::Range(0, flow.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            cv::Vec2f* row = flow.ptr<cv::Vec2f>(y);
+            for (int x = 0; x < flow.cols; ++x) {
+                row[x][0] *= scale_x;
+                row[x][1] *= scale_y;
+            }
+        }
+    });
+    return flow;
+}
+
+FlowAccuracyReport AlgaeTracker::compareWithReference(const cv::Mat& ndvi_t0, const cv::Mat& ndvi_t1, const cv::Mat& roi_mask, const FlowOptions& candidate) {
+    FlowAccuracyReport report = {};
+
+    int64 start = cv::getTickCount();
+    cv::Mat reference = calculateOpticalFlow(ndvi_t0, ndvi_t1);
+    report.reference_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+    start = cv::getTickCount();
+    cv::Mat flow = calculateOpticalFlow(ndvi_t0, ndvi_t1, roi_mask, candidate);
+    report.candidate_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+    if (reference.empty() || flow.empty()) {
+        return report;
+    }
+
+    // 只在掩膜内统计端点误差
+    std::vector<float> errors;
+    double squared_sum = 0.0, sum = 0.0;
+    for (int y = 0; y < reference.rows; ++y) {
+        const cv::Vec2f* ref_row = reference.ptr<cv::Vec2f>(y);
+        const cv::Vec2f* flow_row = flow.ptr<cv::Vec2f>(y);
+        const uchar* mask_row = roi_mask.empty() ? NULL : roi_mask.ptr<uchar>(y);
+        for (int x = 0; x < reference.cols; ++x) {
+            if (mask_row && !mask_row[x]) continue;
+            float dx = flow_row[x][0] - ref_row[x][0];
+            float dy = flow_row[x][1] - ref_row[x][1];
+            float error = std::sqrt(dx * dx + dy * dy);
+            errors.push_back(error);
+            sum += error;
+            squared_sum += (double)error * error;
+        }
+    }
+
+    report.evaluated_pixels = (int)errors.size();
+    if (errors.empty()) {
+        return report;
+    }
+    report.mean_endpoint_error = sum / errors.size();
+    report.rms_endpoint_error = std::sqrt(squared_sum / errors.size());
+    report.max_endpoint_error = *std::max_element(errors.begin(), errors.end());
+    size_t p95_index = std::min(errors.size() - 1, (size_t)(errors.size() * 0.95));
+    std::nth_element(errors.begin(), errors.begin() + p95_index, errors.end());
+    report.p95_endpoint_error = errors[p95_index];
+    return report;
+}
+
 cv::Mat AlgaeTracker::filterFlowByMask(const cv::Mat& flow_field, const cv::Mat& algae_mask) {
     if (flow_field.empty() || algae_mask.empty()) {
         return cv::Mat();
@@ -52,6 +248,48 @@ cv::Mat AlgaeTracker::filterFlowByMask(const cv::Mat& flow_field, const cv::Mat&
     return filtered_flow;
 }
 
+cv::Mat AlgaeTracker::extendFlowBeyondMask(const cv::Mat& filtered_flow, const cv::Mat& algae_mask,
+    const cv::Mat& data_mask, float sigma_pixels) {
+    if (filtered_flow.empty() || algae_mask.empty()) {
+        return cv::Mat();
+    }
+    CV_Assert(filtered_flow.type() == CV_32FC2 && algae_mask.size() == filtered_flow.size());
+
+    cv::Mat masked_flow = cv::Mat::zeros(filtered_flow.size(), CV_32FC2);
+    filtered_flow.copyTo(masked_flow, algae_mask);
+    cv::Mat weight = cv::Mat::zeros(filtered_flow.size(), CV_32F);
+    weight.setTo(1.0f, algae_mask);
+
+    // 延拓场很平滑，在缩小的网格上做归一化卷积：面积平均缩小保持“加权和/权重和”的比值
+    const int factor = std::max(1, (int)(sigma_pixels / 4.0f));
+    cv::Size coarse_size((filtered_flow.cols + factor - 1) / factor, (filtered_flow.rows + factor - 1) / factor);
+    cv::Mat coarse_flow, coarse_weight;
+    cv::resize(masked_flow, coarse_flow, coarse_size, 0, 0, cv::INTER_AREA);
+    cv::resize(weight, coarse_weight, coarse_size, 0, 0, cv::INTER_AREA);
+    const double coarse_sigma = std::max(1.0, (double)sigma_pixels / factor);
+    cv::GaussianBlur(coarse_flow, coarse_flow, cv::Size(), coarse_sigma, coarse_sigma, cv::BORDER_CONSTANT);
+    cv::GaussianBlur(coarse_weight, coarse_weight, cv::Size(), coarse_sigma, coarse_sigma, cv::BORDER_CONSTANT);
+
+    // 权重很小（远离藻华）处以平均漂移补足
+    const cv::Vec2f drift = calculateAverageDrift(masked_flow, algae_mask);
+    const float prior_weight = 1e-3f;
+    for (int y = 0; y < coarse_size.height; ++y) {
+        cv::Vec2f* flow_row = coarse_flow.ptr<cv::Vec2f>(y);
+        const float* weight_row = coarse_weight.ptr<float>(y);
+        for (int x = 0; x < coarse_size.width; ++x) {
+            flow_row[x] = (flow_row[x] + drift * prior_weight) / (weight_row[x] + prior_weight);
+        }
+    }
+
+    cv::Mat extended_flow;
+    cv::resize(coarse_flow, extended_flow, filtered_flow.size(), 0, 0, cv::INTER_LINEAR);
+    masked_flow.copyTo(extended_flow, algae_mask);
+    if (!data_mask.empty()) {
+        extended_flow.setTo(cv::Scalar::all(0), data_mask == 0);
+    }
+    return extended_flow;
+}
+
 cv::Vec2f AlgaeTracker::calculateAverageDrift(const cv::Mat& filtered_flow, const cv::Mat& algae_mask) {
     if (filtered_flow.empty() || algae_mask.empty()) {
         return cv::Vec2f(0, 0);
@@ -71,17 +309,22 @@ cv::Mat AlgaeTracker::visualizeFlow(const cv::Mat& image_to_draw_on, const cv::M
         image_to_draw_on.copyTo(display_image);
     }
 
-    for (int y = 0; y < display_image.rows; y += step) {
-        for (int x = 0; x < display_image.cols; x += step) {
+    drawFlowArrows(display_image, flow_to_visualize, step);
+    return display_image;
+}
+
+void AlgaeTracker::drawFlowArrows(cv::Mat& canvas, const cv::Mat& flow_to_visualize, int step, float gain, double scale,
+    const cv::Scalar& color) {
+    for (int y = 0; y < flow_to_visualize.rows; y += step) {
+        for (int x = 0; x < flow_to_visualize.cols; x += step) {
             const cv::Point2f& flow_at_point = flow_to_visualize.at<cv::Point2f>(y, x);
 
             if (cv::norm(flow_at_point) < 0.1) continue;
 
-            cv::Point start_point(x, y);
-            cv::Point end_point(cvRound(x + flow_at_point.x * 10), cvRound(y + flow_at_point.y * 10));
+            cv::Point start_point(cvRound(x * scale), cvRound(y * scale));
+            cv::Point end_point(cvRound((x + flow_at_point.x * gain) * scale), cvRound((y + flow_at_point.y * gain) * scale));
 
-            cv::arrowedLine(display_image, start_point, end_point, cv::Scalar(0, 0, 255), 1, cv::LINE_AA);
+            cv::arrowedLine(canvas, start_point, end_point, color, 1, cv::LINE_AA);
         }
     }
-    return display_image;
 }
\ No newline at end of file
@@ -4,11 +4,51 @@
 
 #include <opencv2/opencv.hpp>
 
+// 稠密光流后端
+enum class FlowBackend {
+    Farneback,  // 原有参数的 Farneback
+    DIS         // DIS 光流，速度快、精度略低
+};
+
+struct FlowOptions {
+    FlowBackend backend = FlowBackend::Farneback;
+    bool tiled = false;         // 只在与掩膜重叠的瓦片上并行计算
+    int tile_size = 512;
+    int tile_padding = 128;     // 瓦片每侧的扩展宽度，也是接缝处的羽化融合宽度
+};
+
+// 候选光流相对全图 Farneback 的端点误差（像素）与耗时
+struct FlowAccuracyReport {
+    double reference_ms;
+    double candidate_ms;
+    double mean_endpoint_error;
+    double rms_endpoint_error;
+    double p95_endpoint_error;
+    double max_endpoint_error;
+    int evaluated_pixels;
+};
+
 class AlgaeTracker {
 public:
     AlgaeTracker();
     cv::Mat calculateOpticalFlow(const cv::Mat& ndvi_t0, const cv::Mat& ndvi_t1);
+    // roi_mask 为藻华/有效数据掩膜，分块模式下只计算与其重叠的瓦片，其余位置流速为0
+    cv::Mat calculateOpticalFlow(const cv::Mat& ndvi_t0, const cv::Mat& ndvi_t1, const cv::Mat& roi_mask, const FlowOptions& options);
+    // 以 initial_flow（与本类输出约定相同，通常为粗分辨率结果经 upsampleFlow 放大）为初值细化，
+    // 初值已包含大尺度位移，金字塔层数相应减少
+    cv::Mat refineOpticalFlow(const cv::Mat& ndvi_t0, const cv::Mat& ndvi_t1, const cv::Mat& initial_flow);
+    // 双线性放大光流场，位移按两个方向的缩放比例同步放大
+    static cv::Mat upsampleFlow(const cv::Mat& coarse_flow, cv::Size full_size);
+    FlowAccuracyReport compareWithReference(const cv::Mat& ndvi_t0, const cv::Mat& ndvi_t1, const cv::Mat& roi_mask, const FlowOptions& candidate);
     cv::Mat filterFlowByMask(const cv::Mat& flow_field, const cv::Mat& algae_mask);
+    // 把掩膜内的流场向外延拓（归一化卷积，远处趋于平均漂移），藻华移出原位置后仍有流速可循；
+    // 掩膜内保持原值，data_mask 非空时其外（无数据处）流速为0
+    cv::Mat extendFlowBeyondMask(const cv::Mat& filtered_flow, const cv::Mat& algae_mask,
+        const cv::Mat& data_mask = cv::Mat(), float sigma_pixels = 25.0f);
     cv::Vec2f calculateAverageDrift(const cv::Mat& filtered_flow, const cv::Mat& algae_mask);
     cv::Mat visualizeFlow(const cv::Mat& image_to_draw_on, const cv::Mat& flow_to_visualize, int step = 30);
-};
\ No newline at end of file
+    // 每隔 step 个像素画一个位移箭头（长度放大 gain 倍，位移过小的点跳过）；
+    // 箭头坐标乘以 scale 后画到 canvas 上，canvas 可以是缩小后的显示图或单通道覆盖度图
+    static void drawFlowArrows(cv::Mat& canvas, const cv::Mat& flow_to_visualize, int step, float gain = 10.0f,
+        double scale = 1.0, const cv::Scalar& color = cv::Scalar(0, 0, 255));
+};
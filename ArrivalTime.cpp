@@ -0,0 +1,150 @@
+// ArrivalTime.cpp（逆向轨迹求藻华到达时间）
+#include "ArrivalTime.h"
+#include <algorithm>
+#include <cmath>
+
+ArrivalTimeEstimator::ArrivalTimeEstimator(
+    const cv::Mat& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    float spatial_resolution_meters,
+    const ArrivalOptions& options
+)
+    : engine_(velocity_field_mps, spatial_resolution_meters),
+      algae_mask_(initial_algae_mask),
+      region_count_(0),
+      options_(options) {
+    CV_Assert(initial_algae_mask.type() == CV_8U && initial_algae_mask.size() == velocity_field_mps.size());
+    region_count_ = cv::connectedComponents(initial_algae_mask, region_labels_, 8, CV_32S) - 1;
+
+    const float horizon_seconds = options_.horizon_hours * 3600.0f;
+    substeps_ = engine_.suggestSubsteps(horizon_seconds, options_.max_pixels_per_substep);
+    substep_seconds_ = horizon_seconds / substeps_;
+}
+
+bool ArrivalTimeEstimator::insideAlgae(float x, float y) const {
+    // 与栅格化一致，按最近像素判断
+    return algae_mask_.at<uchar>(cvRound(y), cvRound(x)) != 0;
+}
+
+ArrivalEstimate ArrivalTimeEstimator::query(const cv::Point2f& point) const {
+    ArrivalEstimate estimate = { false, -1.0f, cv::Point2f(-1.0f, -1.0f), 0 };
+    if (point.x < 0 || point.y < 0 || point.x > algae_mask_.cols - 1 || point.y > algae_mask_.rows - 1) {
+        return estimate;
+    }
+
+    bool stalled = false;
+    estimate = trace(point, stalled);
+    if (estimate.reached || !stalled) {
+        return estimate;
+    }
+
+    // 查询点本身流速为零只说明这一条轨迹停住；正向推演中落入该像素任意位置的粒子都算到达，
+    // 因此改从像素内的四个子采样点追踪，取最早到达者
+    const float offsets[4][2] = { { -0.25f, -0.25f }, { 0.25f, -0.25f }, { -0.25f, 0.25f }, { 0.25f, 0.25f } };
+    for (const auto& offset : offsets) {
+        cv::Point2f sample(std::min(std::max(point.x + offset[0], 0.0f), (float)(algae_mask_.cols - 1)),
+            std::min(std::max(point.y + offset[1], 0.0f), (float)(algae_mask_.rows - 1)));
+        ArrivalEstimate candidate = trace(sample, stalled);
+        if (candidate.reached && (!estimate.reached || candidate.arrival_hours < estimate.arrival_hours)) {
+            estimate = candidate;
+        }
+    }
+    return estimate;
+}
+
+ArrivalEstimate ArrivalTimeEstimator::trace(const cv::Point2f& start, bool& stalled) const {
+    ArrivalEstimate estimate = { false, -1.0f, cv::Point2f(-1.0f, -1.0f), 0 };
+    stalled = false;
+    float x = start.x;
+    float y = start.y;
+    float elapsed = 0.0f;
+    bool hit = insideAlgae(x, y);
+    for (int s = 0; s < substeps_ && !hit; ++s) {
+        float prev_x = x;
+        float prev_y = y;
+        engine_.integrateParticle(x, y, -substep_seconds_, options_.integrator);
+        if (!insideAlgae(x, y)) {
+            // 恒定流场中停滞的轨迹不会再移动，这条轨迹到此为止
+            if (x == prev_x && y == prev_y) {
+                stalled = true;
+                break;
+            }
+            elapsed += substep_seconds_;
+            continue;
+        }
+
+        // 在本子步内二分，找到首次进入藻华的时刻
+        float lo = 0.0f;
+        float hi = substep_seconds_;
+        float hit_x = x;
+        float hit_y = y;
+        for (int it = 0; it < options_.refine_iterations; ++it) {
+            float mid = 0.5f * (lo + hi);
+            float mx = prev_x;
+            float my = prev_y;
+            engine_.integrateParticle(mx, my, -mid, options_.integrator);
+            if (insideAlgae(mx, my)) {
+                hi = mid;
+                hit_x = mx;
+                hit_y = my;
+            }
+            else {
+                lo = mid;
+            }
+        }
+        x = hit_x;
+        y = hit_y;
+        elapsed += hi;
+        hit = true;
+    }
+
+    if (hit) {
+        estimate.reached = true;
+        estimate.arrival_hours = elapsed / 3600.0f;
+        estimate.source = cv::Point2f(x, y);
+        estimate.source_region = region_labels_.at<int>(cvRound(y), cvRound(x));
+    }
+    return estimate;
+}
+
+std::vector<ArrivalEstimate> ArrivalTimeEstimator::query(const std::vector<cv::Point2f>& points) const {
+    std::vector<ArrivalEstimate> estimates(points.size());
+    cv::parallel_for_(cv::Range(0, (int)points.size()), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            estimates[i] = query(points[i]);
+        }
+    });
+    return estimates;
+}
+
+std::vector<ArrivalEstimate> ArrivalTimeEstimator::query(const std::vector<Location>& locations) const {
+    std::vector<cv::Point2f> points;
+    points.reserve(locations.size());
+    for (const auto& location : locations) {
+        points.push_back(cv::Point2f((float)location.coordinate.x, (float)location.coordinate.y));
+    }
+    return query(points);
+}
+
+cv::Mat ArrivalTimeEstimator::arrivalTimeMap(int stride) const {
+    stride = std::max(1, stride);
+    cv::Mat arrival_map(algae_mask_.size(), CV_32F, cv::Scalar(-1.0f));
+
+    // 按采样行并行，每个采样点的结果填满其 stride×stride 的块
+    const int sample_rows = (algae_mask_.rows + stride - 1) / stride;
+    cv::parallel_for_(cv::Range(0, sample_rows), [&](const cv::Range& range) {
+        for (int sy = range.start; sy < range.end; ++sy) {
+            int y0 = sy * stride;
+            int y1 = std::min(y0 + stride, algae_mask_.rows);
+            for (int x0 = 0; x0 < algae_mask_.cols; x0 += stride) {
+                int x1 = std::min(x0 + stride, algae_mask_.cols);
+                cv::Point2f center(0.5f * (x0 + x1 - 1), 0.5f * (y0 + y1 - 1));
+                ArrivalEstimate estimate = query(center);
+                if (estimate.reached) {
+                    arrival_map(cv::Range(y0, y1), cv::Range(x0, x1)).setTo(estimate.arrival_hours);
+                }
+            }
+        }
+    });
+    return arrival_map;
+}
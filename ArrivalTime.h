@@ -0,0 +1,62 @@
+// ArrivalTime.h
+#ifndef ARRIVAL_TIME_H
+#define ARRIVAL_TIME_H
+
+#include "AlgaeParticleEngine.h"
+#include "Locations.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+struct ArrivalOptions {
+    float horizon_hours = 8.0f;             // 逆向追踪的最长时间
+    float max_pixels_per_substep = 0.5f;    // 子步位移上限，决定时间分辨率
+    int refine_iterations = 6;              // 进入藻华的子步内二分细化次数
+    Integrator integrator = Integrator::RK2;
+};
+
+// 单个监测点的查询结果
+struct ArrivalEstimate {
+    bool reached;               // 预报时段内是否有藻华到达
+    float arrival_hours;        // 到达时间（小时），未到达时为 -1
+    cv::Point2f source;         // 到达的藻华在初始时刻的位置
+    int source_region;          // 来源藻华斑块的连通域编号（从1开始），未到达时为 0
+};
+
+// 到达时间估计：流场恒定时，t 小时后到达某点的藻华就是从该点沿流场逆向追踪 t 小时处的藻华，
+// 因此每个监测点只需一条逆向轨迹，不必反复推演整幅掩膜。
+// 进入藻华的子步内再做二分，时间精度远高于逐步推演的步长
+class ArrivalTimeEstimator {
+public:
+    ArrivalTimeEstimator(
+        const cv::Mat& initial_algae_mask,
+        const cv::Mat& velocity_field_mps,
+        float spatial_resolution_meters,
+        const ArrivalOptions& options = ArrivalOptions()
+    );
+
+    ArrivalEstimate query(const cv::Point2f& point) const;
+    // 批量查询，各点的逆向轨迹并行追踪
+    std::vector<ArrivalEstimate> query(const std::vector<cv::Point2f>& points) const;
+    std::vector<ArrivalEstimate> query(const std::vector<Location>& locations) const;
+
+    // 逐像素到达时间图（CV_32F，小时，未到达为 -1），每 stride×stride 个像素追踪一条轨迹
+    cv::Mat arrivalTimeMap(int stride = 1) const;
+
+    const cv::Mat& regionLabels() const { return region_labels_; }
+    int regionCount() const { return region_count_; }
+
+private:
+    bool insideAlgae(float x, float y) const;
+    // 从 start 逆向追踪一条轨迹；轨迹停滞（流速为零或被边界截住）时置 stalled 并提前结束
+    ArrivalEstimate trace(const cv::Point2f& start, bool& stalled) const;
+
+    AlgaeParticleEngine engine_;
+    cv::Mat algae_mask_;
+    cv::Mat region_labels_;     // CV_32S，藻华连通域编号
+    int region_count_;
+    ArrivalOptions options_;
+    int substeps_;
+    float substep_seconds_;
+};
+
+#endif
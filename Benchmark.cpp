@@ -0,0 +1,536 @@
+// Benchmark.cpp（各阶段性能对比）
+#include "Benchmark.h"
+#include "ImageProcessor.h"
+#include "AlgaeSegmenter.h"
+#include "AlgaeTracker.h"
+#include "AlgaeSimulator.h"
+#include "AlgaeParticleEngine.h"
+#include "ArrivalTime.h"
+#include "ConcentrationAdvector.h"
+#include "AlgaeSalvageSim.h"
+#include "FrameRenderer.h"
+#include "SimulationWorkspace.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <opencv2/core/utils/filesystem.hpp>
+#include "gdal_priv.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static double elapsedMilliseconds(int64 start_ticks) {
+    return (cv::getTickCount() - start_ticks) * 1000.0 / cv::getTickFrequency();
+}
+
+// NaN 视为相等，返回两幅NDVI的最大绝对差
+static double maxNDVIDifference(const cv::Mat& a, const cv::Mat& b) {
+    double max_diff = 0.0;
+    for (int y = 0; y < a.rows; ++y) {
+        const float* pa = a.ptr<float>(y);
+        const float* pb = b.ptr<float>(y);
+        for (int x = 0; x < a.cols; ++x) {
+            if (std::isnan(pa[x]) && std::isnan(pb[x])) continue;
+            double diff = std::fabs((double)pa[x] - pb[x]);
+            if (!(diff <= max_diff)) max_diff = diff;
+        }
+    }
+    return max_diff;
+}
+
+void runSceneKernelBenchmark(ImageProcessor& processor, int repeats) {
+    if (!processor.isLoaded()) {
+        std::cerr << "错误：基准测试需要已加载的图像。" << std::endl;
+        return;
+    }
+    repeats = std::max(1, repeats);
+    cv::Size scene_size = processor.size();
+    double megapixels = scene_size.area() / 1e6;
+
+    std::cout << "\n--- 场景内核基准测试 (" << scene_size.width << "x" << scene_size.height
+        << ", 重复 " << repeats << " 次) ---" << std::endl;
+
+    double best_separate_ms = 0.0, best_fused_ms = 0.0;
+    cv::Mat ndvi, algae_mask, data_mask, colormap;
+    SceneProducts fused;
+
+    for (int i = 0; i < repeats; ++i) {
+        int64 start = cv::getTickCount();
+        ndvi = processor.calculateNDVI();
+        algae_mask = processor.extractAlgaeMask(ndvi);
+        data_mask = processor.createDataMask();
+        colormap = processor.createNDVIColorMap(ndvi);
+        double separate_ms = elapsedMilliseconds(start);
+
+        start = cv::getTickCount();
+        fused = processor.processScene();
+        double fused_ms = elapsedMilliseconds(start);
+
+        if (i == 0 || separate_ms < best_separate_ms) best_separate_ms = separate_ms;
+        if (i == 0 || fused_ms < best_fused_ms) best_fused_ms = fused_ms;
+    }
+
+    if (ndvi.empty() || fused.ndvi.empty()) {
+        std::cerr << "错误：基准测试中场景处理失败。" << std::endl;
+        return;
+    }
+
+    cv::Mat color_diff;
+    cv::absdiff(colormap, fused.colormap, color_diff);
+    double max_color_diff = 0.0;
+    cv::minMaxLoc(color_diff.reshape(1), NULL, &max_color_diff);
+
+    std::cout << cv::format("四函数路径: %.1f ms (%.1f Mpixel/s)", best_separate_ms, megapixels * 1000.0 / best_separate_ms) << std::endl;
+    std::cout << cv::format("融合内核:   %.1f ms (%.1f Mpixel/s), 加速比 %.2fx", best_fused_ms, megapixels * 1000.0 / best_fused_ms,
+        best_separate_ms / best_fused_ms) << std::endl;
+    std::cout << "NDVI 最大差值: " << maxNDVIDifference(ndvi, fused.ndvi)
+        << ", 藻华掩膜不一致像素: " << cv::countNonZero(algae_mask != fused.algae_mask)
+        << ", 数据掩膜不一致像素: " << cv::countNonZero(data_mask != fused.data_mask)
+        << ", 伪彩色最大通道差 (查找表量化): " << max_color_diff << std::endl;
+}
+
+// ---------------------------------------------------------------------------
+// 合成场景基准测试
+// ---------------------------------------------------------------------------
+
+// Linux 下写 /proc/self/clear_refs 可以清零峰值驻留内存，使每个阶段单独统计；
+// 其他平台无法清零，记录的是进程启动以来的峰值
+static bool resetPeakRss() {
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    if (!clear_refs.is_open()) return false;
+    clear_refs << "5";
+    return (bool)clear_refs;
+#else
+    return false;
+#endif
+}
+
+static double peakRssMegabytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+    }
+    return 0.0;
+#else
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::atof(line.c_str() + 6) / 1024.0;
+        }
+    }
+#endif
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+namespace {
+
+struct StageRecord {
+    std::string scene;
+    std::string stage;
+    int repeats;
+    double best_ms;
+    double mean_ms;
+    double peak_rss_mb;
+    std::vector<std::pair<std::string, double>> metrics;
+};
+
+}
+
+// 重复执行 body，记录最佳与平均耗时以及该阶段的峰值内存
+template <typename Body>
+static StageRecord measureStage(const std::string& scene, const std::string& stage, int repeats, Body body) {
+    StageRecord record;
+    record.scene = scene;
+    record.stage = stage;
+    record.repeats = std::max(1, repeats);
+    resetPeakRss();
+    double total_ms = 0.0;
+    for (int i = 0; i < record.repeats; ++i) {
+        int64 start = cv::getTickCount();
+        body();
+        double ms = elapsedMilliseconds(start);
+        total_ms += ms;
+        if (i == 0 || ms < record.best_ms) record.best_ms = ms;
+    }
+    record.mean_ms = total_ms / record.repeats;
+    record.peak_rss_mb = peakRssMegabytes();
+    return record;
+}
+
+static double perSecond(double amount, double ms) {
+    return ms > 0.0 ? amount * 1000.0 / ms : 0.0;
+}
+
+// 光流与真实流场在藻华像素上的平均端点误差（像素）
+static double meanEndpointError(const cv::Mat& flow, const cv::Mat& truth_pixels, const cv::Mat& mask) {
+    double total = 0.0;
+    int count = 0;
+    for (int y = 0; y < flow.rows; ++y) {
+        const cv::Vec2f* f = flow.ptr<cv::Vec2f>(y);
+        const cv::Vec2f* t = truth_pixels.ptr<cv::Vec2f>(y);
+        const uchar* m = mask.ptr<uchar>(y);
+        for (int x = 0; x < flow.cols; ++x) {
+            if (!m[x]) continue;
+            float dx = f[x][0] - t[x][0];
+            float dy = f[x][1] - t[x][1];
+            total += std::sqrt(dx * dx + dy * dy);
+            ++count;
+        }
+    }
+    return count > 0 ? total / count : 0.0;
+}
+
+// 两幅二值掩膜的交并比
+static double maskIoU(const cv::Mat& a, const cv::Mat& b) {
+    double intersection = cv::countNonZero(a & b);
+    double union_pixels = cv::countNonZero(a | b);
+    return union_pixels > 0 ? intersection / union_pixels : 1.0;
+}
+
+// 粒子相对播种位置的平均位移（像素），粒子按播种顺序一一对应
+static double meanParticleDisplacement(const AlgaeParticleEngine& engine, const std::vector<float>& x0, const std::vector<float>& y0) {
+    const size_t count = std::min(engine.xs().size(), x0.size());
+    double total = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        float dx = engine.xs()[i] - x0[i];
+        float dy = engine.ys()[i] - y0[i];
+        total += std::sqrt(dx * dx + dy * dy);
+    }
+    return count > 0 ? total / count : 0.0;
+}
+
+static void writeJsonNumber(std::ostream& out, double value) {
+    if (std::isfinite(value)) out << value;
+    else out << "null";
+}
+
+static bool writeBenchmarkJson(const std::string& path, const BenchmarkSuiteOptions& options,
+    bool rss_resettable, const std::vector<StageRecord>& records) {
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string::npos) {
+        cv::utils::fs::createDirectories(path.substr(0, slash));
+    }
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "错误：无法写入基准测试结果: " << path << std::endl;
+        return false;
+    }
+
+    out.precision(6);
+    out << "{\n";
+    out << "  \"timestamp\": " << (long long)std::time(NULL) << ",\n";
+    out << "  \"threads\": " << cv::getNumThreads() << ",\n";
+    out << "  \"repeats\": " << options.repeats << ",\n";
+    out << "  \"peak_rss_per_stage\": " << (rss_resettable ? "true" : "false") << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const StageRecord& r = records[i];
+        out << "    {\"scene\": \"" << r.scene << "\", \"stage\": \"" << r.stage << "\", \"repeats\": " << r.repeats
+            << ", \"best_ms\": ";
+        writeJsonNumber(out, r.best_ms);
+        out << ", \"mean_ms\": ";
+        writeJsonNumber(out, r.mean_ms);
+        out << ", \"peak_rss_mb\": ";
+        writeJsonNumber(out, r.peak_rss_mb);
+        for (const auto& metric : r.metrics) {
+            out << ", \"" << metric.first << "\": ";
+            writeJsonNumber(out, metric.second);
+        }
+        out << "}" << (i + 1 < records.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+// 测量一个合成场景的全部阶段
+static void benchmarkScene(const SyntheticSceneSpec& spec, const BenchmarkSuiteOptions& options, std::vector<StageRecord>& records) {
+    const std::string scene_name = cv::format("%dx%d_cov%.2f_%s", spec.size.width, spec.size.height,
+        spec.algae_coverage, flowPatternName(spec.flow));
+    const double megapixels = spec.size.area() / 1e6;
+    const int repeats = options.repeats;
+    std::cout << "\n--- 合成场景 " << scene_name << " ---" << std::endl;
+
+    SyntheticScene scene;
+    records.push_back(measureStage(scene_name, "generate_scene", 1, [&] {
+        scene = generateSyntheticScene(spec);
+    }));
+    records.back().metrics.push_back({ "mpixel_per_s", perSecond(megapixels, records.back().best_ms) });
+
+    // 写入GDAL内存文件，读取路径与真实数据完全相同
+    const std::string path_t0 = "/vsimem/algae_bench_t0.tif";
+    const std::string path_t1 = "/vsimem/algae_bench_t1.tif";
+    if (!writeSyntheticGeoTiff(path_t0, scene.bands_t0, spec.spatial_resolution_meters) ||
+        !writeSyntheticGeoTiff(path_t1, scene.bands_t1, spec.spatial_resolution_meters)) {
+        VSIUnlink(path_t0.c_str());
+        VSIUnlink(path_t1.c_str());
+        return;
+    }
+    ImageProcessor processor_t0(path_t0);
+    ImageProcessor processor_t1(path_t1);
+
+    records.push_back(measureStage(scene_name, "calculate_ndvi", repeats, [&] {
+        processor_t0.calculateNDVI();
+    }));
+    records.back().metrics.push_back({ "mpixel_per_s", perSecond(megapixels, records.back().best_ms) });
+
+    SceneProducts products_t0;
+    records.push_back(measureStage(scene_name, "process_scene", repeats, [&] {
+        products_t0 = processor_t0.processScene();
+    }));
+    records.back().metrics.push_back({ "mpixel_per_s", perSecond(megapixels, records.back().best_ms) });
+    SceneProducts products_t1 = processor_t1.processScene();
+
+    // 藻华分割：固定阈值与分块大津法的吞吐量与掩膜精度（对照合成真值）
+    const ThresholdMode segmentation_modes[] = { ThresholdMode::Fixed, ThresholdMode::GlobalOtsu, ThresholdMode::TileOtsu };
+    const char* segmentation_names[] = { "segment_fixed", "segment_global_otsu", "segment_tile_otsu" };
+    for (int m = 0; m < 3; ++m) {
+        SegmentationOptions segmentation_options;
+        segmentation_options.mode = segmentation_modes[m];
+        AlgaeSegmenter segmenter(segmentation_options);
+        cv::Mat segmented;
+        records.push_back(measureStage(scene_name, segmentation_names[m], repeats, [&] {
+            segmenter.segment(products_t0.ndvi, products_t0.data_mask, segmented);
+        }));
+        records.back().metrics.push_back({ "mpixel_per_s", perSecond(megapixels, records.back().best_ms) });
+        records.back().metrics.push_back({ "mask_iou", maskIoU(segmented, scene.algae_mask_t0) });
+        records.back().metrics.push_back({ "adaptive_tiles", (double)segmenter.adaptiveTileCount() });
+    }
+    VSIUnlink(path_t0.c_str());
+    VSIUnlink(path_t1.c_str());
+
+    AlgaeTracker tracker;
+    cv::Mat flow;
+    records.push_back(measureStage(scene_name, "optical_flow", repeats, [&] {
+        flow = tracker.calculateOpticalFlow(products_t0.ndvi, products_t1.ndvi);
+    }));
+    records.back().metrics.push_back({ "mpixel_per_s", perSecond(megapixels, records.back().best_ms) });
+    cv::Mat truth_pixels = scene.velocity_field_mps * (spec.interval_seconds / spec.spatial_resolution_meters);
+    records.back().metrics.push_back({ "endpoint_error_px", meanEndpointError(flow, truth_pixels, scene.algae_mask_t0) });
+
+    const double algae_pixels = cv::countNonZero(scene.algae_mask_t0);
+    const float forecast_hours = 8.0f;
+    AlgaeSimulator simulator;
+    records.push_back(measureStage(scene_name, "predict_algae_position", repeats, [&] {
+        simulator.predictAlgaePosition(scene.algae_mask_t0, scene.velocity_field_mps, forecast_hours, spec.spatial_resolution_meters);
+    }));
+    records.back().metrics.push_back({ "particles_per_s", perSecond(algae_pixels, records.back().best_ms) });
+
+    // 与动态模拟相同：8小时、每步20分钟
+    const int engine_steps = 24;
+    const float step_seconds = 20.0f * 60.0f;
+    AlgaeParticleEngine engine(scene.velocity_field_mps, spec.spatial_resolution_meters);
+    const int substeps = engine.suggestSubsteps(step_seconds);
+    records.push_back(measureStage(scene_name, "particle_engine", repeats, [&] {
+        engine.seedFromMask(scene.algae_mask_t0);
+        for (int i = 0; i < engine_steps; ++i) {
+            engine.step(step_seconds, substeps, Integrator::RK2);
+        }
+    }));
+    records.back().metrics.push_back({ "steps_per_s", perSecond(engine_steps, records.back().best_ms) });
+    records.back().metrics.push_back({ "particles_per_s", perSecond(algae_pixels * engine_steps, records.back().best_ms) });
+
+    // 按藻华掩膜过滤后的流场（与实际流程相同）：掩膜外流速为0，粒子一出掩膜就停住；
+    // 延拓后的流场应与真实流场推演的位移和终态掩膜接近
+    engine.seedFromMask(scene.algae_mask_t0);
+    const std::vector<float> seed_x = engine.xs();
+    const std::vector<float> seed_y = engine.ys();
+    for (int i = 0; i < engine_steps; ++i) {
+        engine.step(step_seconds, substeps, Integrator::RK2);
+    }
+    const double truth_displacement = meanParticleDisplacement(engine, seed_x, seed_y);
+    const cv::Mat truth_final = engine.rasterize();
+
+    cv::Mat masked_field = tracker.filterFlowByMask(scene.velocity_field_mps, scene.algae_mask_t0);
+    AlgaeParticleEngine masked_engine(masked_field, spec.spatial_resolution_meters);
+    masked_engine.seedFromMask(scene.algae_mask_t0);
+    for (int i = 0; i < engine_steps; ++i) {
+        masked_engine.step(step_seconds, substeps, Integrator::RK2);
+    }
+
+    cv::Mat extended_field;
+    records.push_back(measureStage(scene_name, "extend_masked_flow", repeats, [&] {
+        extended_field = tracker.extendFlowBeyondMask(masked_field, scene.algae_mask_t0, scene.data_mask);
+    }));
+    records.back().metrics.push_back({ "mpixel_per_s", perSecond(megapixels, records.back().best_ms) });
+    AlgaeParticleEngine extended_engine(extended_field, spec.spatial_resolution_meters);
+    const int extended_substeps = extended_engine.suggestSubsteps(step_seconds);
+    records.push_back(measureStage(scene_name, "particle_engine_masked", repeats, [&] {
+        extended_engine.seedFromMask(scene.algae_mask_t0);
+        for (int i = 0; i < engine_steps; ++i) {
+            extended_engine.step(step_seconds, extended_substeps, Integrator::RK2);
+        }
+    }));
+    records.back().metrics.push_back({ "steps_per_s", perSecond(engine_steps, records.back().best_ms) });
+    records.back().metrics.push_back({ "truth_displacement_px", truth_displacement });
+    records.back().metrics.push_back({ "masked_displacement_px", meanParticleDisplacement(masked_engine, seed_x, seed_y) });
+    records.back().metrics.push_back({ "extended_displacement_px", meanParticleDisplacement(extended_engine, seed_x, seed_y) });
+    records.back().metrics.push_back({ "masked_iou_vs_truth", maskIoU(masked_engine.rasterize(), truth_final) });
+    records.back().metrics.push_back({ "extended_iou_vs_truth", maskIoU(extended_engine.rasterize(), truth_final) });
+
+    // 到达时间估计与正向推演的一致性：湖面上按网格取初始无藻华的探测点，
+    // 正向推演记录各点首次被覆盖的步，逆向估计应给出相同的到达与否，时间差不超过一个步长左右
+    std::vector<cv::Point2f> probes;
+    const int probe_stride = std::max(1, spec.size.width / 16);
+    for (int y = probe_stride / 2; y < spec.size.height; y += probe_stride) {
+        for (int x = probe_stride / 2; x < spec.size.width; x += probe_stride) {
+            if (scene.data_mask.at<uchar>(y, x) && !scene.algae_mask_t0.at<uchar>(y, x)) {
+                probes.push_back(cv::Point2f((float)x, (float)y));
+            }
+        }
+    }
+    std::vector<float> forward_hours(probes.size(), -1.0f);
+    extended_engine.seedFromMask(scene.algae_mask_t0);
+    cv::Mat forward_frame;
+    for (int i = 1; i <= engine_steps; ++i) {
+        extended_engine.step(step_seconds, extended_substeps, Integrator::RK2);
+        forward_frame = extended_engine.rasterize();
+        for (size_t p = 0; p < probes.size(); ++p) {
+            if (forward_hours[p] < 0.0f && forward_frame.at<uchar>(cvRound(probes[p].y), cvRound(probes[p].x))) {
+                forward_hours[p] = i * step_seconds / 3600.0f;
+            }
+        }
+    }
+    ArrivalOptions arrival_options;
+    arrival_options.horizon_hours = engine_steps * step_seconds / 3600.0f;
+    std::vector<ArrivalEstimate> estimates;
+    records.push_back(measureStage(scene_name, "arrival_time", repeats, [&] {
+        ArrivalTimeEstimator estimator(scene.algae_mask_t0, extended_field, spec.spatial_resolution_meters, arrival_options);
+        estimates = estimator.query(probes);
+    }));
+    int agreed = 0, both_reached = 0, forward_reached = 0;
+    double hour_error = 0.0;
+    for (size_t p = 0; p < probes.size(); ++p) {
+        const bool forward = forward_hours[p] >= 0.0f;
+        forward_reached += forward ? 1 : 0;
+        agreed += (forward == estimates[p].reached) ? 1 : 0;
+        if (forward && estimates[p].reached) {
+            hour_error += std::fabs(forward_hours[p] - estimates[p].arrival_hours);
+            ++both_reached;
+        }
+    }
+    records.back().metrics.push_back({ "probes", (double)probes.size() });
+    records.back().metrics.push_back({ "forward_reached", (double)forward_reached });
+    records.back().metrics.push_back({ "reached_agreement", probes.empty() ? 1.0 : (double)agreed / probes.size() });
+    records.back().metrics.push_back({ "mean_abs_arrival_error_h", both_reached > 0 ? hour_error / both_reached : 0.0 });
+
+    // 画面渲染：每步整幅拷贝底图、涂色再缩放（原做法）与显示分辨率上的增量重绘对照，掩膜序列预先推演好
+    std::vector<CompactMask> step_masks(engine_steps + 1);
+    engine.seedFromMask(scene.algae_mask_t0);
+    for (int i = 0; i <= engine_steps; ++i) {
+        if (i > 0) engine.step(step_seconds, substeps, Integrator::RK2);
+        engine.rasterizeCompact(step_masks[i]);
+    }
+    const double display_scale = 0.7;
+    cv::Mat full_frame, display_frame;
+    records.push_back(measureStage(scene_name, "render_full", repeats, [&] {
+        for (int i = 0; i <= engine_steps; ++i) {
+            createColorMapFromMask(step_masks[i], products_t0.colormap, full_frame);
+            cv::putText(full_frame, cv::format("Time: +%.1f hours", i / 3.0), cv::Point(30, 30),
+                cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(255, 255, 255), 2);
+            cv::resize(full_frame, display_frame, cv::Size(), display_scale, display_scale, cv::INTER_AREA);
+        }
+    }));
+    records.back().metrics.push_back({ "frames_per_s", perSecond(engine_steps + 1, records.back().best_ms) });
+    double blocks_per_frame = 0.0;
+    records.push_back(measureStage(scene_name, "render_incremental", repeats, [&] {
+        FrameRenderer renderer(products_t0.colormap, display_scale);
+        for (int i = 0; i <= engine_steps; ++i) {
+            renderer.update(step_masks[i]);
+            renderer.drawText(cv::format("Time: +%.1f hours", i / 3.0), cv::Point(30, 30), 1, cv::Scalar(255, 255, 255), 2);
+        }
+        blocks_per_frame = (double)renderer.recompositedBlocks() / renderer.frames() / renderer.blockCount();
+    }));
+    records.back().metrics.push_back({ "frames_per_s", perSecond(engine_steps + 1, records.back().best_ms) });
+    records.back().metrics.push_back({ "dirty_block_fraction", blocks_per_frame });
+
+    // 浓度场平流：稀疏瓦片推进的耗时随藻华覆盖率变化，整网格推进作为对照
+    ConcentrationAdvector advector(scene.velocity_field_mps, spec.spatial_resolution_meters, scene.data_mask);
+    const int advector_substeps = advector.suggestSubsteps(step_seconds);
+    for (int dense = 0; dense < 2; ++dense) {
+        advector.setActiveTiles(dense == 0);
+        double mass_error = 0.0;
+        records.push_back(measureStage(scene_name, dense ? "eulerian_advection_dense" : "eulerian_advection", repeats, [&] {
+            advector.seedFromNDVI(products_t0.ndvi);
+            for (int i = 0; i < engine_steps; ++i) {
+                advector.step(step_seconds, advector_substeps);
+            }
+            mass_error = advector.initialMass() > 0 ? std::fabs(advector.totalMass() / advector.initialMass() - 1.0) : 0.0;
+        }));
+        records.back().metrics.push_back({ "steps_per_s", perSecond(engine_steps, records.back().best_ms) });
+        records.back().metrics.push_back({ "mpixel_per_s", perSecond(megapixels * engine_steps, records.back().best_ms) });
+        records.back().metrics.push_back({ "relative_mass_error", mass_error });
+        records.back().metrics.push_back({ "active_tiles", (double)advector.activeTileCount() });
+    }
+
+    // 取水口放在湖心，警戒圈内必有藻华
+    SalvageScenario scenario = makeSalvageScenario(scene.algae_mask_t0, scene.velocity_field_mps, products_t0.colormap,
+        spec.spatial_resolution_meters, cv::Point(spec.size.width / 2, spec.size.height / 2));
+    size_t salvage_reallocations = 0;
+    uint64_t salvage_allocations = 0;
+    records.push_back(measureStage(scene_name, "salvage", repeats, [&] {
+        SalvageOutcome outcome = simulateSalvage(scenario, options.salvage_boats);
+        salvage_reallocations = outcome.buffer_reallocations;
+        salvage_allocations = outcome.steady_state_allocations;
+    }));
+    records.back().metrics.push_back({ "steps_per_s", perSecond(scenario.num_steps, records.back().best_ms) });
+    // 首步之后工作区缓冲区（掩膜与画面）的重新分配次数，非0说明这些缓冲区未能复用；
+    // 只比较缓冲区地址与容量，各步内部的临时分配不在此列，逐作用域的 operator new 次数见 --trace
+    records.back().metrics.push_back({ "workspace_buffer_reallocations", (double)salvage_reallocations });
+    // 跟踪构建中另报告首步之后打捞循环线程上的实际 operator new 次数（cv::Mat 像素缓冲区不计入），应为0
+    if (SimulationWorkspace::allocationsCounted()) {
+        records.back().metrics.push_back({ "steady_state_heap_allocations", (double)salvage_allocations });
+        if (salvage_allocations > 0) {
+            std::cerr << cv::format("警告：%s 打捞循环稳态下仍有 %llu 次堆分配", scene_name.c_str(),
+                (unsigned long long)salvage_allocations) << std::endl;
+        }
+    }
+}
+
+bool runBenchmarkSuite(const BenchmarkSuiteOptions& options) {
+    const bool rss_resettable = resetPeakRss();
+    std::vector<StageRecord> records;
+
+    uint64_t seed = 1;
+    for (int extent : options.sizes) {
+        for (double coverage : options.coverages) {
+            for (FlowPattern flow : options.flows) {
+                SyntheticSceneSpec spec;
+                spec.size = cv::Size(extent, extent);
+                spec.algae_coverage = coverage;
+                spec.flow = flow;
+                spec.seed = seed++;
+                benchmarkScene(spec, options, records);
+            }
+        }
+    }
+
+    std::cout << "\n--- 基准测试汇总 (最佳耗时) ---" << std::endl;
+    for (const auto& r : records) {
+        std::cout << cv::format("  %-28s %-24s %10.1f ms  %8.1f MB", r.scene.c_str(), r.stage.c_str(), r.best_ms, r.peak_rss_mb) << std::endl;
+    }
+    if (!writeBenchmarkJson(options.json_path, options, rss_resettable, records)) {
+        return false;
+    }
+    std::cout << "结果已写入 " << options.json_path << std::endl;
+    return true;
+}
@@ -0,0 +1,29 @@
+// Benchmark.h
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "SyntheticScene.h"
+#include <string>
+#include <vector>
+
+class ImageProcessor;
+
+// 对比原有四个独立函数（calculateNDVI / extractAlgaeMask / createDataMask / createNDVIColorMap）
+// 与融合内核 processScene 的耗时，并检查两条路径的结果是否一致
+void runSceneKernelBenchmark(ImageProcessor& processor, int repeats = 5);
+
+// 合成场景基准测试的参数网格：场景尺寸 × 藻华覆盖率 × 流场形态
+struct BenchmarkSuiteOptions {
+    std::vector<int> sizes = { 1024, 2048 };
+    std::vector<double> coverages = { 0.05, 0.2 };
+    std::vector<FlowPattern> flows = { FlowPattern::Uniform, FlowPattern::Vortex, FlowPattern::Shear };
+    int repeats = 3;
+    int salvage_boats = 20;
+    std::string json_path = "output/benchmark.json";
+};
+
+// 对每个合成场景依次测量 NDVI、融合内核、光流、位置推演、粒子引擎与打捞模拟，
+// 记录最佳/平均耗时、吞吐量（Mpixel/s、粒子/s、步/s）与峰值内存，结果写成JSON
+bool runBenchmarkSuite(const BenchmarkSuiteOptions& options);
+
+#endif
@@ -0,0 +1,216 @@
+// BloomPatches.cpp（藻华斑块分解与跟踪）
+#include "BloomPatches.h"
+#include "Trace.h"
+#include <algorithm>
+
+namespace {
+
+struct OverlapCandidate {
+    int previous_label;
+    int current_label;
+    int overlap;
+};
+
+}
+
+BloomPatchTracker::BloomPatchTracker(const BloomTrackingOptions& options)
+    : options_(options), next_id_(1), frames_(0), continued_(0), split_(0), new_(0), ended_(0) {}
+
+std::vector<BloomPatch> BloomPatchTracker::measure(const cv::Mat& labels, const cv::Mat& stats, const cv::Mat& centroids,
+    const cv::Mat& velocity_field_mps, int min_area, cv::Point origin) {
+    CV_Assert(labels.type() == CV_32S && stats.type() == CV_32S && centroids.type() == CV_64F);
+    const bool has_velocity = !velocity_field_mps.empty();
+    CV_Assert(!has_velocity || (velocity_field_mps.type() == CV_32FC2 && velocity_field_mps.size() == labels.size()));
+
+    std::vector<BloomPatch> patches;
+    for (int label = 1; label < stats.rows; ++label) {
+        const int* row = stats.ptr<int>(label);
+        if (row[cv::CC_STAT_AREA] < std::max(1, min_area)) continue;
+        BloomPatch patch;
+        patch.id = -1;
+        patch.label = label;
+        patch.parent_id = -1;
+        patch.age = 1;
+        patch.area = row[cv::CC_STAT_AREA];
+        patch.centroid = cv::Point2f((float)centroids.at<double>(label, 0) + origin.x, (float)centroids.at<double>(label, 1) + origin.y);
+        patch.bounding_box = cv::Rect(row[cv::CC_STAT_LEFT], row[cv::CC_STAT_TOP], row[cv::CC_STAT_WIDTH], row[cv::CC_STAT_HEIGHT]);
+        patch.mean_velocity_mps = cv::Vec2f(0.0f, 0.0f);
+        patches.push_back(patch);
+    }
+
+    // 平均流速：每个斑块只扫描自己的外接框，结果写入各自的槽位，并行时无需合并
+    if (has_velocity) {
+        cv::parallel_for_(cv::Range(0, (int)patches.size()), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; ++i) {
+                BloomPatch& patch = patches[i];
+                const cv::Rect& box = patch.bounding_box;
+                double sum_vx = 0.0, sum_vy = 0.0;
+                for (int y = box.y; y < box.y + box.height; ++y) {
+                    const int* label_row = labels.ptr<int>(y);
+                    const cv::Vec2f* velocity_row = velocity_field_mps.ptr<cv::Vec2f>(y);
+                    for (int x = box.x; x < box.x + box.width; ++x) {
+                        if (label_row[x] == patch.label) {
+                            sum_vx += velocity_row[x][0];
+                            sum_vy += velocity_row[x][1];
+                        }
+                    }
+                }
+                patch.mean_velocity_mps = cv::Vec2f((float)(sum_vx / patch.area), (float)(sum_vy / patch.area));
+            }
+        });
+    }
+    for (auto& patch : patches) {
+        patch.bounding_box += origin;
+    }
+    return patches;
+}
+
+const std::vector<BloomPatch>& BloomPatchTracker::update(const cv::Mat& mask, const cv::Mat& velocity_field_mps,
+    float elapsed_seconds, float spatial_resolution) {
+    CV_Assert(mask.type() == CV_8U);
+    CV_Assert(velocity_field_mps.empty() || velocity_field_mps.size() == mask.size());
+    updateRegion(mask, cv::Point(0, 0), velocity_field_mps, elapsed_seconds, spatial_resolution);
+    return patches_;
+}
+
+const std::vector<BloomPatch>& BloomPatchTracker::update(const SparseTileMask& mask, const cv::Mat& velocity_field_mps,
+    float elapsed_seconds, float spatial_resolution) {
+    CV_Assert(velocity_field_mps.empty() || velocity_field_mps.size() == mask.size());
+    // 已分配瓦片的外接范围包含全部藻华像素，范围外的连通域不存在，标号结果与整幅相同
+    const cv::Rect region = mask.activeBounds();
+    mask.toMat(region_mask_, region);
+    updateRegion(region_mask_, region.tl(), velocity_field_mps.empty() ? cv::Mat() : velocity_field_mps(region),
+        elapsed_seconds, spatial_resolution);
+    return patches_;
+}
+
+void BloomPatchTracker::updateRegion(const cv::Mat& mask, cv::Point origin, const cv::Mat& velocity_field_mps,
+    float elapsed_seconds, float spatial_resolution) {
+    ALGAE_TRACE_SCOPE("track_bloom_patches");
+
+    // 上一帧的标号图与斑块留作匹配，本帧写入两帧前的缓冲区
+    std::swap(previous_labels_, labels_);
+    std::swap(previous_origin_, label_origin_);
+    previous_patches_.swap(patches_);
+    previous_index_.swap(patch_index_);
+
+    label_origin_ = origin;
+    int label_count = 1;
+    if (mask.empty()) {
+        labels_.create(0, 0, CV_32S);
+        patches_.clear();
+    }
+    else {
+        label_count = cv::connectedComponentsWithStats(mask, labels_, stats_, centroids_, options_.connectivity, CV_32S);
+        patches_ = measure(labels_, stats_, centroids_, velocity_field_mps, options_.min_area, origin);
+    }
+    patch_index_.assign(std::max(1, label_count), -1);
+    for (size_t i = 0; i < patches_.size(); ++i) {
+        patch_index_[patches_[i].label] = (int)i;
+    }
+    ALGAE_TRACE_ANNOTATE("patches", patches_.size());
+    ALGAE_TRACE_ANNOTATE("pixels", (double)mask.total());
+
+    ++frames_;
+    match(elapsed_seconds, spatial_resolution);
+}
+
+void BloomPatchTracker::match(float elapsed_seconds, float spatial_resolution) {
+    continued_ = split_ = new_ = ended_ = 0;
+    if (previous_patches_.empty() || patches_.empty()) {
+        for (auto& patch : patches_) {
+            patch.id = next_id_++;
+            ++new_;
+        }
+        ended_ = (int)previous_patches_.size();
+        return;
+    }
+
+    // 统计 (旧斑块, 新斑块) 的重叠像素数：旧斑块按自身平均流速平移到本帧时刻，
+    // 只扫描其外接框；每个旧斑块接触的新斑块很少，计数放在各自的小数组中按线性查找累加
+    const float pixels_per_mps = elapsed_seconds > 0.0f ? elapsed_seconds / spatial_resolution : 0.0f;
+    const cv::Rect current_region = labelRegion();
+    if (overlaps_.size() < previous_patches_.size()) {
+        overlaps_.resize(previous_patches_.size());
+    }
+    cv::parallel_for_(cv::Range(0, (int)previous_patches_.size()), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            const BloomPatch& ancestor = previous_patches_[i];
+            std::vector<OverlapCount>& counts = overlaps_[i];
+            counts.clear();
+            const cv::Point shift(cvRound(ancestor.mean_velocity_mps[0] * pixels_per_mps),
+                cvRound(ancestor.mean_velocity_mps[1] * pixels_per_mps));
+            // 平移后仍落在本帧标号范围内的那部分外接框（影像坐标）
+            const cv::Rect box = (ancestor.bounding_box + shift) & current_region;
+            size_t last = 0;
+            for (int y = box.y; y < box.y + box.height; ++y) {
+                const int* previous_row = previous_labels_.ptr<int>(y - shift.y - previous_origin_.y);
+                const int* current_row = labels_.ptr<int>(y - label_origin_.y);
+                for (int x = box.x; x < box.x + box.width; ++x) {
+                    if (previous_row[x - shift.x - previous_origin_.x] != ancestor.label) continue;
+                    const int current_label = current_row[x - label_origin_.x];
+                    if (current_label <= 0 || patch_index_[current_label] < 0) continue;
+                    if (last >= counts.size() || counts[last].current_label != current_label) {
+                        last = 0;
+                        while (last < counts.size() && counts[last].current_label != current_label) ++last;
+                        if (last == counts.size()) counts.push_back(OverlapCount{ current_label, 0 });
+                    }
+                    ++counts[last].overlap;
+                }
+            }
+        }
+    });
+
+    std::vector<OverlapCandidate> candidates;
+    for (size_t i = 0; i < previous_patches_.size(); ++i) {
+        for (const auto& count : overlaps_[i]) {
+            candidates.push_back(OverlapCandidate{ previous_patches_[i].label, count.current_label, count.overlap });
+        }
+    }
+    // 重叠多者优先；相同时按编号排序，结果与线程调度无关
+    std::sort(candidates.begin(), candidates.end(), [](const OverlapCandidate& a, const OverlapCandidate& b) {
+        if (a.overlap != b.overlap) return a.overlap > b.overlap;
+        if (a.previous_label != b.previous_label) return a.previous_label < b.previous_label;
+        return a.current_label < b.current_label;
+    });
+
+    std::vector<bool> claimed(previous_patches_.size(), false);
+    std::vector<bool> assigned(patches_.size(), false);
+    for (const auto& candidate : candidates) {
+        const int current = patch_index_[candidate.current_label];
+        const int previous = previous_index_[candidate.previous_label];
+        BloomPatch& patch = patches_[current];
+        if (assigned[current] || candidate.overlap < options_.min_overlap * patch.area) continue;
+
+        const BloomPatch& ancestor = previous_patches_[previous];
+        if (!claimed[previous]) {
+            patch.id = ancestor.id;
+            patch.parent_id = ancestor.parent_id;
+            patch.age = ancestor.age + 1;
+            claimed[previous] = true;
+            ++continued_;
+        }
+        else {
+            // 旧斑块已由重叠更多的部分延续，其余部分视为分裂
+            patch.id = next_id_++;
+            patch.parent_id = ancestor.id;
+            ++split_;
+        }
+        assigned[current] = true;
+    }
+
+    for (size_t i = 0; i < patches_.size(); ++i) {
+        if (!assigned[i]) {
+            patches_[i].id = next_id_++;
+            ++new_;
+        }
+    }
+    ended_ = (int)std::count(claimed.begin(), claimed.end(), false);
+}
+
+const BloomPatch* BloomPatchTracker::patchForLabel(int label) const {
+    if (label <= 0 || label >= (int)patch_index_.size() || patch_index_[label] < 0) {
+        return nullptr;
+    }
+    return &patches_[patch_index_[label]];
+}
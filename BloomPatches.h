@@ -0,0 +1,94 @@
+// BloomPatches.h
+#ifndef BLOOM_PATCHES_H
+#define BLOOM_PATCHES_H
+
+#include "SparseTileMask.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// 一个藻华斑块（掩膜的连通域）的汇总
+struct BloomPatch {
+    int id;                         // 跟踪编号，跨时间步/场景保持不变
+    int label;                      // 本帧标号图中的连通域编号（从1开始）
+    int parent_id;                  // 由分裂产生时为原斑块的跟踪编号，否则为 -1
+    int age;                        // 已连续跟踪的帧数，首次出现为1
+    int area;                       // 像素数
+    cv::Point2f centroid;
+    cv::Rect bounding_box;
+    cv::Vec2f mean_velocity_mps;    // 斑块内的平均流速（米/秒）
+};
+
+struct BloomTrackingOptions {
+    int connectivity = 8;           // 与 ArrivalTimeEstimator 的连通域编号一致
+    int min_area = 9;               // 小于此像素数的连通域不计为斑块（粒子栅格化的零散像素不单独跟踪）
+    float min_overlap = 0.1f;       // 与上一帧斑块的重叠像素至少占本斑块面积的比例
+};
+
+// 藻华斑块分解与跨帧跟踪
+// 每帧由 connectedComponentsWithStats 得到各连通域的面积、外接框与质心，平均流速只对
+// 达到 min_area 的斑块在其外接框内累加；上一帧各斑块按自身平均流速平移后，只在平移后的
+// 外接框内与本帧标号图比较重叠，重叠最多者沿用编号，同一旧斑块分裂出的其余部分取新编号
+// 并记录来源。下游按几百个斑块汇总推理，不必逐像素处理
+class BloomPatchTracker {
+public:
+    explicit BloomPatchTracker(const BloomTrackingOptions& options = BloomTrackingOptions());
+
+    // 分解 mask（CV_8U）并与上一帧匹配；velocity_field_mps 为空时平均流速为0，
+    // elapsed_seconds 为与上一帧的时间间隔，为0时不做运动补偿
+    const std::vector<BloomPatch>& update(const cv::Mat& mask, const cv::Mat& velocity_field_mps = cv::Mat(),
+        float elapsed_seconds = 0.0f, float spatial_resolution = 50.0f);
+    // 稀疏掩膜只在已分配瓦片的外接范围内栅格化与标号，耗时取决于藻华范围而非湖面大小
+    const std::vector<BloomPatch>& update(const SparseTileMask& mask, const cv::Mat& velocity_field_mps = cv::Mat(),
+        float elapsed_seconds = 0.0f, float spatial_resolution = 50.0f);
+
+    const std::vector<BloomPatch>& patches() const { return patches_; }
+    // 本帧标号图，覆盖影像中的 labelRegion() 范围
+    const cv::Mat& labels() const { return labels_; }
+    cv::Rect labelRegion() const { return cv::Rect(label_origin_, labels_.size()); }
+    // 按连通域编号查找斑块，编号无效或面积低于 min_area 时返回 nullptr
+    const BloomPatch* patchForLabel(int label) const;
+
+    // 最近一次 update 的匹配结果
+    int frames() const { return frames_; }
+    int continuedCount() const { return continued_; }
+    int splitCount() const { return split_; }
+    int newCount() const { return new_; }
+    int endedCount() const { return ended_; }        // 上一帧中未被延续的斑块（合并或消失）
+
+    // 由 connectedComponentsWithStats 的结果汇总面积不小于 min_area 的连通域，跟踪字段置为初值；
+    // labels 与 velocity_field_mps 为同一范围，origin 为该范围在影像中的左上角
+    static std::vector<BloomPatch> measure(const cv::Mat& labels, const cv::Mat& stats, const cv::Mat& centroids,
+        const cv::Mat& velocity_field_mps, int min_area = 9, cv::Point origin = cv::Point());
+
+private:
+    struct OverlapCount {
+        int current_label;
+        int overlap;
+    };
+
+    void updateRegion(const cv::Mat& mask, cv::Point origin, const cv::Mat& velocity_field_mps,
+        float elapsed_seconds, float spatial_resolution);
+    void match(float elapsed_seconds, float spatial_resolution);
+
+    BloomTrackingOptions options_;
+    cv::Mat region_mask_;                   // 稀疏掩膜栅格化到标号范围的缓冲区
+    cv::Mat labels_;
+    cv::Mat previous_labels_;
+    cv::Mat stats_;
+    cv::Mat centroids_;
+    cv::Point label_origin_;
+    cv::Point previous_origin_;
+    std::vector<std::vector<OverlapCount>> overlaps_;   // 每个旧斑块与本帧各连通域的重叠计数
+    std::vector<BloomPatch> patches_;
+    std::vector<BloomPatch> previous_patches_;
+    std::vector<int> patch_index_;          // 连通域编号 -> patches_ 下标，无斑块为 -1
+    std::vector<int> previous_index_;
+    int next_id_;
+    int frames_;
+    int continued_;
+    int split_;
+    int new_;
+    int ended_;
+};
+
+#endif
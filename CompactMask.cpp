@@ -0,0 +1,231 @@
+// CompactMask.cpp（位压缩二值掩膜）
+#include "CompactMask.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 覆盖 [bit0, bit1] 位（含两端，0~63）的字掩码
+inline uint64_t bitRange(int bit0, int bit1) {
+    return (~uint64_t(0) << bit0) & (~uint64_t(0) >> (63 - bit1));
+}
+
+}
+
+CompactMask::CompactMask() : rows_(0), cols_(0), words_per_row_(0) {}
+
+CompactMask::CompactMask(cv::Size size)
+    : rows_(std::max(0, size.height)),
+      cols_(std::max(0, size.width)),
+      words_per_row_((cols_ + 63) / 64),
+      bits_((size_t)rows_ * words_per_row_, 0) {}
+
+CompactMask CompactMask::fromMat(const cv::Mat& mask) {
+    CV_Assert(mask.empty() || mask.type() == CV_8U);
+    CompactMask compact(mask.size());
+    for (int y = 0; y < compact.rows_; ++y) {
+        const uchar* src = mask.ptr<uchar>(y);
+        uint64_t* dst = compact.rowPtr(y);
+        for (int w = 0; w < compact.words_per_row_; ++w) {
+            int x0 = w * 64;
+            int n = std::min(64, compact.cols_ - x0);
+            uint64_t word = 0;
+            for (int b = 0; b < n; ++b) {
+                word |= uint64_t(src[x0 + b] != 0) << b;
+            }
+            dst[w] = word;
+        }
+    }
+    return compact;
+}
+
+void CompactMask::create(cv::Size size) {
+    if (size == this->size()) {
+        return;
+    }
+    *this = CompactMask(size);
+}
+
+cv::Mat CompactMask::toMat() const {
+    cv::Mat mask;
+    toMat(mask);
+    return mask;
+}
+
+void CompactMask::toMat(cv::Mat& mask) const {
+    mask.create(size(), CV_8U);
+    mask.setTo(0);
+    forEachSet([&mask](int x, int y) {
+        mask.at<uchar>(y, x) = 255;
+    });
+}
+
+void CompactMask::clear() {
+    std::fill(bits_.begin(), bits_.end(), 0);
+}
+
+size_t CompactMask::count() const {
+    size_t total = 0;
+    for (uint64_t word : bits_) {
+        total += popCount(word);
+    }
+    return total;
+}
+
+bool CompactMask::circleSpan(cv::Point center, int radius, int y, int& x0, int& x1) const {
+    int dy = y - center.y;
+    if (radius < 0 || y < 0 || y >= rows_ || std::abs(dy) > radius) {
+        return false;
+    }
+    // 满足 dx² <= r² - dy² 的最大整数 dx
+    long long remaining = (long long)radius * radius - (long long)dy * dy;
+    long long half = (long long)std::sqrt((double)remaining);
+    while ((half + 1) * (half + 1) <= remaining) ++half;
+    while (half * half > remaining) --half;
+    x0 = (int)std::max<long long>(0, center.x - half);
+    x1 = (int)std::min<long long>(cols_ - 1, center.x + half);
+    return x0 <= x1;
+}
+
+size_t CompactMask::countSpan(int y, int x0, int x1) const {
+    const uint64_t* row = rowPtr(y);
+    int w0 = x0 >> 6;
+    int w1 = x1 >> 6;
+    if (w0 == w1) {
+        return popCount(row[w0] & bitRange(x0 & 63, x1 & 63));
+    }
+    size_t total = popCount(row[w0] & bitRange(x0 & 63, 63));
+    for (int w = w0 + 1; w < w1; ++w) {
+        total += popCount(row[w]);
+    }
+    return total + popCount(row[w1] & bitRange(0, x1 & 63));
+}
+
+size_t CompactMask::clearSpan(int y, int x0, int x1) {
+    uint64_t* row = rowPtr(y);
+    int w0 = x0 >> 6;
+    int w1 = x1 >> 6;
+    size_t removed = 0;
+    for (int w = w0; w <= w1; ++w) {
+        uint64_t range = bitRange(w == w0 ? (x0 & 63) : 0, w == w1 ? (x1 & 63) : 63);
+        removed += popCount(row[w] & range);
+        row[w] &= ~range;
+    }
+    return removed;
+}
+
+size_t CompactMask::countInCircle(cv::Point center, int radius) const {
+    size_t total = 0;
+    int x0, x1;
+    for (int y = center.y - radius; y <= center.y + radius; ++y) {
+        if (circleSpan(center, radius, y, x0, x1)) {
+            total += countSpan(y, x0, x1);
+        }
+    }
+    return total;
+}
+
+size_t CompactMask::countInAnnulus(cv::Point center, int inner_radius, int outer_radius) const {
+    if (outer_radius <= inner_radius) {
+        return 0;
+    }
+    size_t outer = countInCircle(center, outer_radius);
+    return inner_radius < 0 ? outer : outer - countInCircle(center, inner_radius);
+}
+
+bool CompactMask::anyInCircle(cv::Point center, int radius) const {
+    int x0, x1;
+    for (int y = center.y - radius; y <= center.y + radius; ++y) {
+        if (circleSpan(center, radius, y, x0, x1) && countSpan(y, x0, x1) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t CompactMask::clearCircle(cv::Point center, int radius) {
+    size_t removed = 0;
+    int x0, x1;
+    for (int y = center.y - radius; y <= center.y + radius; ++y) {
+        if (circleSpan(center, radius, y, x0, x1)) {
+            removed += clearSpan(y, x0, x1);
+        }
+    }
+    return removed;
+}
+
+CompactMask& CompactMask::operator|=(const CompactMask& other) {
+    CV_Assert(other.size() == size());
+    for (size_t i = 0; i < bits_.size(); ++i) {
+        bits_[i] |= other.bits_[i];
+    }
+    return *this;
+}
+
+CompactMask& CompactMask::operator&=(const CompactMask& other) {
+    CV_Assert(other.size() == size());
+    for (size_t i = 0; i < bits_.size(); ++i) {
+        bits_[i] &= other.bits_[i];
+    }
+    return *this;
+}
+
+CompactMask& CompactMask::subtract(const CompactMask& other) {
+    CV_Assert(other.size() == size());
+    for (size_t i = 0; i < bits_.size(); ++i) {
+        bits_[i] &= ~other.bits_[i];
+    }
+    return *this;
+}
+
+cv::Rect CompactMask::boundingRect() const {
+    int min_x = cols_, min_y = rows_, max_x = -1, max_y = -1;
+    for (int y = 0; y < rows_; ++y) {
+        const uint64_t* row = rowPtr(y);
+        int first = -1, last = -1;
+        for (int w = 0; w < words_per_row_; ++w) {
+            if (!row[w]) continue;
+            if (first < 0) first = w * 64 + countTrailingZeros(row[w]);
+            int high = 63;
+            while (!((row[w] >> high) & 1u)) --high;
+            last = w * 64 + high;
+        }
+        if (first < 0) continue;
+        min_y = std::min(min_y, y);
+        max_y = y;
+        min_x = std::min(min_x, first);
+        max_x = std::max(max_x, last);
+    }
+    if (max_y < 0) {
+        return cv::Rect();
+    }
+    return cv::Rect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+}
+
+cv::Point2d CompactMask::centroid() const {
+    double sum_x = 0.0, sum_y = 0.0;
+    size_t n = 0;
+    forEachSet([&](int x, int y) {
+        sum_x += x;
+        sum_y += y;
+        ++n;
+    });
+    if (n == 0) {
+        return cv::Point2d(0.0, 0.0);
+    }
+    return cv::Point2d(sum_x / n, sum_y / n);
+}
+
+cv::Mat createColorMapFromMask(const CompactMask& mask, const cv::Mat& background_template) {
+    cv::Mat colormap;
+    createColorMapFromMask(mask, background_template, colormap);
+    return colormap;
+}
+
+void createColorMapFromMask(const CompactMask& mask, const cv::Mat& background_template, cv::Mat& colormap) {
+    CV_Assert(mask.size() == background_template.size() && background_template.type() == CV_8UC3);
+    background_template.copyTo(colormap);
+    mask.forEachSet([&colormap](int x, int y) {
+        colormap.at<cv::Vec3b>(y, x) = cv::Vec3b(0, 200, 0);
+    });
+}
@@ -0,0 +1,136 @@
+// CompactMask.h
+#ifndef COMPACT_MASK_H
+#define COMPACT_MASK_H
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 按行位压缩的二值掩膜：每个像素1位，每行补齐到64位字
+// 藻华、数据与预测掩膜只占 CV_8U 的1/8，且无需 findNonZero 生成坐标列表；
+// 计数、圆形警戒区查询与集合运算都按字处理（popcount），遍历时按位跳过空字
+class CompactMask {
+public:
+    CompactMask();
+    explicit CompactMask(cv::Size size);
+
+    // mask 中非零像素置位
+    static CompactMask fromMat(const cv::Mat& mask);
+    // 尺寸不同时才重新分配（与 cv::Mat::create 相同），内容不清零
+    void create(cv::Size size);
+    // CV_8U，置位像素为255
+    cv::Mat toMat() const;
+    // 同上，尺寸不变时复用 mask 的缓冲区
+    void toMat(cv::Mat& mask) const;
+
+    cv::Size size() const { return cv::Size(cols_, rows_); }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+    // 位数据占用的字节数
+    size_t byteSize() const { return bits_.size() * sizeof(uint64_t); }
+
+    bool test(int x, int y) const {
+        return (bits_[wordIndex(x, y)] >> (x & 63)) & 1u;
+    }
+    void set(int x, int y) {
+        bits_[wordIndex(x, y)] |= uint64_t(1) << (x & 63);
+    }
+    void reset(int x, int y) {
+        bits_[wordIndex(x, y)] &= ~(uint64_t(1) << (x & 63));
+    }
+    void clear();
+
+    // 置位像素总数
+    size_t count() const;
+    // 以下圆形查询均为 距离 <= radius（与 cv::circle 填充范围一致），超出影像的部分自动裁剪
+    size_t countInCircle(cv::Point center, int radius) const;
+    // 满足 inner_radius < 距离 <= outer_radius 的置位像素数量
+    size_t countInAnnulus(cv::Point center, int inner_radius, int outer_radius) const;
+    bool anyInCircle(cv::Point center, int radius) const;
+    // 清除圆内全部置位像素，返回清除数量
+    size_t clearCircle(cv::Point center, int radius);
+
+    // 集合运算，两个掩膜尺寸必须一致
+    CompactMask& operator|=(const CompactMask& other);
+    CompactMask& operator&=(const CompactMask& other);
+    CompactMask& subtract(const CompactMask& other);
+
+    // 置位像素的外接矩形与质心；掩膜为空时分别返回空矩形与 (0, 0)
+    cv::Rect boundingRect() const;
+    cv::Point2d centroid() const;
+
+    // 按行优先顺序对每个置位像素调用 f(x, y)，空字整体跳过
+    template <typename F>
+    void forEachSet(F&& f) const {
+        for (int y = 0; y < rows_; ++y) {
+            const uint64_t* row = rowPtr(y);
+            for (int w = 0; w < words_per_row_; ++w) {
+                uint64_t word = row[w];
+                while (word) {
+                    f(w * 64 + countTrailingZeros(word), y);
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+
+    const uint64_t* rowPtr(int y) const { return bits_.data() + (size_t)y * words_per_row_; }
+    uint64_t* rowPtr(int y) { return bits_.data() + (size_t)y * words_per_row_; }
+    int wordsPerRow() const { return words_per_row_; }
+    // 位数据的起始地址，用于判断缓冲区是否被重新分配
+    const void* storage() const { return bits_.data(); }
+
+    static int popCount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(word);
+#else
+        word = word - ((word >> 1) & 0x5555555555555555ULL);
+        word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+        word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return (int)((word * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    // word 必须非零
+    static int countTrailingZeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return (int)index;
+#else
+        int index = 0;
+        while (!(word & 1u)) {
+            word >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+private:
+    size_t wordIndex(int x, int y) const { return (size_t)y * words_per_row_ + (x >> 6); }
+    // 第 y 行圆内的列范围 [x0, x1]；该行与圆不相交或超出影像时返回 false
+    bool circleSpan(cv::Point center, int radius, int y, int& x0, int& x1) const;
+    size_t countSpan(int y, int x0, int x1) const;
+    size_t clearSpan(int y, int x0, int x1);
+
+    int rows_;
+    int cols_;
+    int words_per_row_;
+    std::vector<uint64_t> bits_;
+};
+
+// 以 background_template 为底图，将置位像素涂为藻华绿色
+cv::Mat createColorMapFromMask(const CompactMask& mask, const cv::Mat& background_template);
+// 同上，结果写入 colormap，尺寸不变时复用其缓冲区
+void createColorMapFromMask(const CompactMask& mask, const cv::Mat& background_template, cv::Mat& colormap);
+
+#endif
@@ -0,0 +1,282 @@
+// ConcentrationAdvector.cpp（半拉格朗日浓度平流）
+#include "ConcentrationAdvector.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+
+ConcentrationAdvector::ConcentrationAdvector(const cv::Mat& velocity_field_mps, float spatial_resolution, const cv::Mat& water_mask)
+    : water_mask_(water_mask),
+      mapped_dt_(0.0f),
+      max_speed_pixels_(0.0f),
+      pixels_per_meter_(1.0f / spatial_resolution),
+      initial_mass_(0.0),
+      default_threshold_(0.5f),
+      mass_correction_(true),
+      active_tiles_(true) {
+    CV_Assert(velocity_field_mps.type() == CV_32FC2);
+    CV_Assert(water_mask.empty() || (water_mask.type() == CV_8U && water_mask.size() == velocity_field_mps.size()));
+
+    velocity_field_mps.convertTo(velocity_pixels_, CV_32FC2, pixels_per_meter_);
+    std::vector<cv::Mat> components;
+    cv::split(velocity_pixels_, components);
+    cv::Mat speed;
+    cv::magnitude(components[0], components[1], speed);
+    double max_speed = 0.0;
+    cv::minMaxLoc(speed, NULL, &max_speed);
+    max_speed_pixels_ = (float)max_speed;
+
+    concentration_ = cv::Mat::zeros(velocity_field_mps.size(), CV_32F);
+    scratch_ = cv::Mat::zeros(velocity_field_mps.size(), CV_32F);
+    if (!water_mask_.empty()) {
+        land_mask_ = water_mask_ == 0;
+    }
+    tiles_x_ = (concentration_.cols + SparseTileMask::TILE_SIZE - 1) / SparseTileMask::TILE_SIZE;
+    tiles_y_ = (concentration_.rows + SparseTileMask::TILE_SIZE - 1) / SparseTileMask::TILE_SIZE;
+}
+
+cv::Rect ConcentrationAdvector::tileRect(int tile) const {
+    const int size = SparseTileMask::TILE_SIZE;
+    int x0 = (tile % tiles_x_) * size;
+    int y0 = (tile / tiles_x_) * size;
+    return cv::Rect(x0, y0, std::min(size, concentration_.cols - x0), std::min(size, concentration_.rows - y0));
+}
+
+std::vector<int> ConcentrationAdvector::tilesWithMass(const std::vector<int>& tiles) const {
+    std::vector<uchar> has_mass(tiles.size(), 0);
+    cv::parallel_for_(cv::Range(0, (int)tiles.size()), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            has_mass[i] = cv::countNonZero(concentration_(tileRect(tiles[i]))) > 0;
+        }
+    });
+    std::vector<int> result;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (has_mass[i]) {
+            result.push_back(tiles[i]);
+        }
+    }
+    return result;
+}
+
+void ConcentrationAdvector::seedFromNDVI(const cv::Mat& ndvi_image) {
+    CV_Assert(ndvi_image.type() == CV_32F && ndvi_image.size() == concentration_.size());
+    cv::parallel_for_(cv::Range(0, ndvi_image.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float* ndvi = ndvi_image.ptr<float>(y);
+            float* c = concentration_.ptr<float>(y);
+            for (int x = 0; x < ndvi_image.cols; ++x) {
+                // NaN 比较结果为假，无效像素浓度为0
+                c[x] = ndvi[x] > 0.0f ? std::min(ndvi[x], 1.0f) : 0.0f;
+            }
+        }
+    });
+    seedFinished();
+}
+
+void ConcentrationAdvector::seedFromMask(const cv::Mat& algae_mask) {
+    CV_Assert(algae_mask.type() == CV_8U && algae_mask.size() == concentration_.size());
+    concentration_.setTo(0.0f);
+    concentration_.setTo(1.0f, algae_mask);
+    seedFinished();
+}
+
+void ConcentrationAdvector::seedFinished() {
+    if (!land_mask_.empty()) {
+        concentration_.setTo(0.0f, land_mask_);
+    }
+    // 播种只做一次，这里扫描全部瓦片建立初始活动集
+    std::vector<int> all_tiles(tiles_x_ * tiles_y_);
+    for (size_t i = 0; i < all_tiles.size(); ++i) {
+        all_tiles[i] = (int)i;
+    }
+    mass_tiles_ = tilesWithMass(all_tiles);
+    scratch_.setTo(0.0f);
+    scratch_tiles_.clear();
+    initial_mass_ = totalMass();
+    int seeded = cv::countNonZero(concentration_);
+    default_threshold_ = seeded > 0 ? (float)(0.5 * initial_mass_ / seeded) : 0.5f;
+}
+
+int ConcentrationAdvector::suggestSubsteps(float seconds, float max_pixels_per_substep) const {
+    float max_displacement = max_speed_pixels_ * std::fabs(seconds);
+    return std::max(1, (int)std::ceil(max_displacement / max_pixels_per_substep));
+}
+
+void ConcentrationAdvector::prepareDepartureMaps(float dt) {
+    if (!map_x_.empty() && dt == mapped_dt_) {
+        return;
+    }
+    const int rows = velocity_pixels_.rows;
+    const int cols = velocity_pixels_.cols;
+
+    // 先求半步位置，再在该处采样速度（与粒子引擎的 RK2 一致）
+    cv::Mat mid_x(rows, cols, CV_32F), mid_y(rows, cols, CV_32F);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const cv::Vec2f* v = velocity_pixels_.ptr<cv::Vec2f>(y);
+            float* mx = mid_x.ptr<float>(y);
+            float* my = mid_y.ptr<float>(y);
+            for (int x = 0; x < cols; ++x) {
+                mx[x] = x - 0.5f * dt * v[x][0];
+                my[x] = y - 0.5f * dt * v[x][1];
+            }
+        }
+    });
+    cv::Mat mid_velocity;
+    cv::remap(velocity_pixels_, mid_velocity, mid_x, mid_y, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+
+    map_x_.create(rows, cols, CV_32F);
+    map_y_.create(rows, cols, CV_32F);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const cv::Vec2f* v = mid_velocity.ptr<cv::Vec2f>(y);
+            float* mx = map_x_.ptr<float>(y);
+            float* my = map_y_.ptr<float>(y);
+            for (int x = 0; x < cols; ++x) {
+                mx[x] = x - dt * v[x][0];
+                my[x] = y - dt * v[x][1];
+            }
+        }
+    });
+    mapped_dt_ = dt;
+}
+
+void ConcentrationAdvector::step(float seconds, int substeps, float diffusion_m2_per_s) {
+    ALGAE_TRACE_SCOPE("concentration_step");
+    ALGAE_TRACE_ANNOTATE("pixels", concentration_.total());
+    substeps = std::max(1, substeps);
+    const float dt = seconds / substeps;
+    prepareDepartureMaps(dt);
+
+    // 扩散项用高斯核的精确解：标准差 sqrt(2·D·dt)，换算为像素
+    const double sigma_pixels = std::sqrt(2.0 * std::max(0.0f, diffusion_m2_per_s) * std::fabs(dt)) * pixels_per_meter_;
+    const double blur_sigma = sigma_pixels > 0.05 ? sigma_pixels : 0.0;
+
+    for (int s = 0; s < substeps; ++s) {
+        if (active_tiles_) {
+            stepActiveTiles(dt, blur_sigma);
+            continue;
+        }
+        // 影像外流入的浓度为0；remap 内部按行并行并使用SIMD
+        cv::remap(concentration_, scratch_, map_x_, map_y_, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0));
+        cv::swap(concentration_, scratch_);
+
+        if (blur_sigma > 0.0) {
+            cv::GaussianBlur(concentration_, concentration_, cv::Size(), blur_sigma, blur_sigma, cv::BORDER_REFLECT);
+        }
+        if (!land_mask_.empty()) {
+            concentration_.setTo(0.0f, land_mask_);
+        }
+        // 整网格推进后所有瓦片都视为活动
+        mass_tiles_.resize(tiles_x_ * tiles_y_);
+        for (size_t i = 0; i < mass_tiles_.size(); ++i) {
+            mass_tiles_[i] = (int)i;
+        }
+        scratch_tiles_ = mass_tiles_;
+    }
+    ALGAE_TRACE_ANNOTATE("active_tiles", mass_tiles_.size());
+
+    // 质量校正：插值与流场辐合/辐散造成的总量偏差按比例分摊到所有网格点（只有活动瓦片非零）
+    if (mass_correction_ && initial_mass_ > 0.0) {
+        double mass = totalMass();
+        if (mass > 0.0) {
+            const double scale = initial_mass_ / mass;
+            for (int tile : mass_tiles_) {
+                cv::Mat roi = concentration_(tileRect(tile));
+                roi.convertTo(roi, -1, scale);
+            }
+        }
+    }
+}
+
+void ConcentrationAdvector::stepActiveTiles(float dt, double blur_sigma_pixels) {
+    // 目标像素的出发点最远在 最大速度·dt（+1 个双线性插值像素）之外，扩散核再向外延伸约 4σ
+    int reach = (int)std::ceil(max_speed_pixels_ * std::fabs(dt)) + 1;
+    int blur_radius = 0;
+    if (blur_sigma_pixels > 0.0) {
+        blur_radius = (int)std::ceil(4.0 * blur_sigma_pixels) + 1;
+        reach += blur_radius;
+    }
+    const int halo = (reach + SparseTileMask::TILE_SIZE - 1) / SparseTileMask::TILE_SIZE;
+    const std::vector<int> targets = dilateTiles(mass_tiles_, tiles_x_, tiles_y_, halo);
+
+    // scratch_ 中不会被本步覆盖的旧瓦片先清零
+    for (int tile : scratch_tiles_) {
+        if (!std::binary_search(targets.begin(), targets.end(), tile)) {
+            scratch_(tileRect(tile)).setTo(0.0f);
+        }
+    }
+    cv::parallel_for_(cv::Range(0, (int)targets.size()), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            cv::Rect rect = tileRect(targets[i]);
+            cv::Mat destination = scratch_(rect);
+            cv::remap(concentration_, destination, map_x_(rect), map_y_(rect), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0));
+        }
+    });
+    cv::swap(concentration_, scratch_);
+    scratch_tiles_ = mass_tiles_;
+
+    if (blur_radius > 0) {
+        // 每个瓦片连同外圈一起模糊再取中心，ROI 外的真实邻域参与卷积，结果与整图模糊一致
+        const cv::Rect image(0, 0, concentration_.cols, concentration_.rows);
+        cv::parallel_for_(cv::Range(0, (int)targets.size()), [&](const cv::Range& range) {
+            cv::Mat blurred;
+            for (int i = range.start; i < range.end; ++i) {
+                cv::Rect rect = tileRect(targets[i]);
+                cv::Rect padded = cv::Rect(rect.x - blur_radius, rect.y - blur_radius,
+                    rect.width + 2 * blur_radius, rect.height + 2 * blur_radius) & image;
+                cv::GaussianBlur(concentration_(padded), blurred, cv::Size(), blur_sigma_pixels, blur_sigma_pixels, cv::BORDER_REFLECT);
+                blurred(cv::Rect(rect.x - padded.x, rect.y - padded.y, rect.width, rect.height)).copyTo(scratch_(rect));
+            }
+        });
+        // 上一步的活动瓦片都在 targets 内，scratch_ 已被完整覆盖
+        cv::swap(concentration_, scratch_);
+        scratch_tiles_ = targets;
+    }
+
+    if (!land_mask_.empty()) {
+        for (int tile : targets) {
+            cv::Rect rect = tileRect(tile);
+            concentration_(rect).setTo(0.0f, land_mask_(rect));
+        }
+    }
+    mass_tiles_ = tilesWithMass(targets);
+}
+
+double ConcentrationAdvector::totalMass() const {
+    double total = 0.0;
+    for (int tile : mass_tiles_) {
+        total += cv::sum(concentration_(tileRect(tile)))[0];
+    }
+    return total;
+}
+
+cv::Mat ConcentrationAdvector::toMask(float threshold) const {
+    if (threshold <= 0.0f) {
+        threshold = default_threshold_;
+    }
+    cv::Mat mask;
+    cv::threshold(concentration_, mask, threshold, 255.0, cv::THRESH_BINARY);
+    mask.convertTo(mask, CV_8U);
+    return mask;
+}
+
+void ConcentrationAdvector::toSparseMask(SparseTileMask& mask, float threshold) const {
+    if (threshold <= 0.0f) {
+        threshold = default_threshold_;
+    }
+    if (mask.size() != concentration_.size()) {
+        mask = SparseTileMask(concentration_.size());
+    }
+    mask.clear();
+    for (int tile : mass_tiles_) {
+        cv::Rect rect = tileRect(tile);
+        for (int y = rect.y; y < rect.br().y; ++y) {
+            const float* c = concentration_.ptr<float>(y);
+            for (int x = rect.x; x < rect.br().x; ++x) {
+                if (c[x] >= threshold) {
+                    mask.set(x, y);
+                }
+            }
+        }
+    }
+}
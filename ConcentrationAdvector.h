@@ -0,0 +1,73 @@
+// ConcentrationAdvector.h
+#ifndef CONCENTRATION_ADVECTOR_H
+#define CONCENTRATION_ADVECTOR_H
+
+#include "SparseTileMask.h"
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// 欧拉网格上的藻华浓度平流（半拉格朗日）
+// 每个网格点沿流场逆向追踪到出发点，在上一时刻的浓度场中双线性取值（cv::remap），
+// 可选叠加扩散，最后按总量做质量校正。只有在需要预警或打捞时才把浓度阈值化为掩膜。
+// 默认按 64×64 瓦片稀疏推进：只处理含浓度的瓦片及其一步可达的外圈，每步耗时取决于藻华范围而非湖面大小。
+class ConcentrationAdvector {
+public:
+    // water_mask 非空时，陆地（为0处）浓度恒为0，流到陆地上的藻华经质量校正重新分配到水面
+    ConcentrationAdvector(const cv::Mat& velocity_field_mps, float spatial_resolution = 50.0f, const cv::Mat& water_mask = cv::Mat());
+
+    // 以 NDVI 为浓度初值：NDVI > 0 处取 min(NDVI, 1)，其余为0
+    void seedFromNDVI(const cv::Mat& ndvi_image);
+    // 掩膜像素浓度为1
+    void seedFromMask(const cv::Mat& algae_mask);
+
+    // 推进 seconds 秒，拆成 substeps 个子步；diffusion_m2_per_s 为扩散系数（米²/秒）
+    void step(float seconds, int substeps = 1, float diffusion_m2_per_s = 0.0f);
+    // 按子步位移不超过 max_pixels_per_substep 个像素估计所需子步数
+    int suggestSubsteps(float seconds, float max_pixels_per_substep = 2.0f) const;
+
+    // 关闭后 step 不再做质量校正（用于对比半拉格朗日插值本身的质量误差）
+    void setMassCorrection(bool enabled) { mass_correction_ = enabled; }
+    // 关闭后每步处理整个网格（与稀疏推进结果一致，用于对比耗时）
+    void setActiveTiles(bool enabled) { active_tiles_ = enabled; }
+    // 当前含浓度的瓦片数量（编号同 SparseTileMask）
+    size_t activeTileCount() const { return mass_tiles_.size(); }
+
+    // 浓度 >= threshold 处为255；threshold <= 0 时使用初始藻华平均浓度的一半
+    cv::Mat toMask(float threshold = 0.0f) const;
+    // 同上，只扫描含浓度的瓦片，结果写入稀疏掩膜（复用其瓦片内存）
+    void toSparseMask(SparseTileMask& mask, float threshold = 0.0f) const;
+    const cv::Mat& concentration() const { return concentration_; }
+    double totalMass() const;
+    double initialMass() const { return initial_mass_; }
+
+private:
+    void seedFinished();
+    // 为时间步 dt 预计算逆向追踪的出发点坐标（中点法），dt 不变时复用
+    void prepareDepartureMaps(float dt);
+    // 稀疏推进的一个子步；blur_sigma_pixels > 0 时叠加扩散
+    void stepActiveTiles(float dt, double blur_sigma_pixels);
+    // 从 tiles 中筛出含非零浓度的瓦片
+    std::vector<int> tilesWithMass(const std::vector<int>& tiles) const;
+    cv::Rect tileRect(int tile) const;
+
+    cv::Mat velocity_pixels_;       // CV_32FC2，像素/秒
+    cv::Mat water_mask_;
+    cv::Mat land_mask_;             // water_mask_ 为0处为255，未提供水域掩膜时为空
+    cv::Mat concentration_;         // CV_32F
+    cv::Mat scratch_;
+    cv::Mat map_x_;
+    cv::Mat map_y_;
+    float mapped_dt_;
+    float max_speed_pixels_;
+    float pixels_per_meter_;
+    double initial_mass_;
+    float default_threshold_;
+    bool mass_correction_;
+    bool active_tiles_;
+    int tiles_x_;
+    int tiles_y_;
+    std::vector<int> mass_tiles_;       // concentration_ 中可能非零的瓦片（升序）
+    std::vector<int> scratch_tiles_;    // scratch_ 中可能非零的瓦片
+};
+
+#endif
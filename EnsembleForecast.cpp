@@ -0,0 +1,154 @@
+// EnsembleForecast.cpp（蒙特卡洛集合预报）
+#include "EnsembleForecast.h"
+#include "AlgaeParticleEngine.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cmath>
+#include <random>
+
+// SplitMix64，把 (种子, 成员序号) 混合成互不相关的成员种子
+static uint64_t mixSeed(uint64_t seed, uint64_t member) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (member + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+namespace {
+
+// 每个工作线程独占的缓冲区，成员数量增加时内存不增长
+struct WorkerBuffers {
+    cv::Mat visit_stamp;        // CV_32S，像素最近一次被哪个成员经过（成员序号 + 1）
+    cv::Mat visit_count;        // CV_32S，经过该像素的成员数
+    cv::Mat occupancy_stamp;    // CV_32S，像素在哪个 (成员, 时间步) 被占据
+    std::vector<std::vector<int>> first_arrival_counts;
+};
+
+}
+
+static float arrivalQuantile(const std::vector<int>& counts, int arrived, double quantile, float step_hours) {
+    if (arrived == 0) {
+        return -1.0f;
+    }
+    int target = std::max(1, (int)std::ceil(quantile * arrived));
+    int cumulative = 0;
+    for (size_t step = 0; step < counts.size(); ++step) {
+        cumulative += counts[step];
+        if (cumulative >= target) {
+            return step * step_hours;
+        }
+    }
+    return (counts.size() - 1) * step_hours;
+}
+
+EnsembleResult runEnsembleForecast(
+    const cv::Mat& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    float spatial_resolution_meters,
+    const std::vector<Location>& locations,
+    const EnsembleOptions& options
+) {
+    const int num_steps = static_cast<int>(options.hours * 60 / options.step_minutes);
+    const float step_seconds = options.step_minutes * 60.0f;
+    const int members = std::max(1, options.members);
+    const cv::Size size = initial_algae_mask.size();
+
+    ThreadPool pool(options.threads);
+    std::vector<WorkerBuffers> buffers(pool.size());
+    std::atomic<int> next_member(0);
+
+    std::vector<std::future<void>> workers;
+    for (size_t w = 0; w < pool.size(); ++w) {
+        workers.push_back(pool.submit([&, w] {
+            WorkerBuffers& buffer = buffers[w];
+            buffer.visit_stamp = cv::Mat::zeros(size, CV_32S);
+            buffer.visit_count = cv::Mat::zeros(size, CV_32S);
+            buffer.occupancy_stamp = cv::Mat::zeros(size, CV_32S);
+            buffer.first_arrival_counts.assign(locations.size(), std::vector<int>(num_steps + 1, 0));
+
+            // 粒子缓冲区在成员之间复用
+            AlgaeParticleEngine engine(velocity_field_mps, spatial_resolution_meters);
+            engine.setParallel(false);
+            const int substeps = engine.suggestSubsteps(step_seconds * (1.0f + 3.0f * options.velocity_scale_sigma));
+
+            for (int member = next_member++; member < members; member = next_member++) {
+                std::mt19937_64 rng(mixSeed(options.seed, (uint64_t)member));
+                std::normal_distribution<float> standard_normal(0.0f, 1.0f);
+                float scale = std::max(0.0f, 1.0f + options.velocity_scale_sigma * standard_normal(rng));
+                float rotation = (float)(options.velocity_rotation_sigma_deg * CV_PI / 180.0) * standard_normal(rng);
+                engine.setVelocityPerturbation(scale, rotation);
+                engine.seedFromMask(initial_algae_mask);
+
+                std::vector<bool> arrived(locations.size(), false);
+                for (int step = 0; step <= num_steps; ++step) {
+                    if (step > 0) {
+                        engine.step(step_seconds, substeps, Integrator::RK2, options.diffusion_m2_per_s, rng);
+                    }
+
+                    // 以 (成员, 时间步) 为标记写入占据缓冲区，无需逐步清零
+                    const int occupancy_tag = member * (num_steps + 1) + step + 1;
+                    const int visit_tag = member + 1;
+                    const std::vector<float>& xs = engine.xs();
+                    const std::vector<float>& ys = engine.ys();
+                    for (size_t i = 0; i < xs.size(); ++i) {
+                        int px = cvRound(xs[i]);
+                        int py = cvRound(ys[i]);
+                        buffer.occupancy_stamp.at<int>(py, px) = occupancy_tag;
+                        int& stamp = buffer.visit_stamp.at<int>(py, px);
+                        if (stamp != visit_tag) {
+                            stamp = visit_tag;
+                            ++buffer.visit_count.at<int>(py, px);
+                        }
+                    }
+
+                    for (size_t k = 0; k < locations.size(); ++k) {
+                        const cv::Point& p = locations[k].coordinate;
+                        if (arrived[k] || p.x < 0 || p.y < 0 || p.x >= size.width || p.y >= size.height) continue;
+                        if (buffer.occupancy_stamp.at<int>(p.y, p.x) == occupancy_tag) {
+                            arrived[k] = true;
+                            ++buffer.first_arrival_counts[k][step];
+                        }
+                    }
+                }
+            }
+        }));
+    }
+    for (auto& worker : workers) {
+        worker.get();
+    }
+
+    // 合并各线程的整数计数，结果与成员在线程间的分配无关
+    EnsembleResult result;
+    result.members = members;
+    cv::Mat total_count = cv::Mat::zeros(size, CV_32S);
+    for (const auto& buffer : buffers) {
+        if (!buffer.visit_count.empty()) {
+            total_count += buffer.visit_count;
+        }
+    }
+    total_count.convertTo(result.arrival_probability, CV_32F, 1.0 / members);
+
+    const float step_hours = options.step_minutes / 60.0f;
+    for (size_t k = 0; k < locations.size(); ++k) {
+        LocationArrival arrival;
+        arrival.name = locations[k].name;
+        arrival.coordinate = locations[k].coordinate;
+        arrival.first_arrival_counts.assign(num_steps + 1, 0);
+        for (const auto& buffer : buffers) {
+            if (buffer.first_arrival_counts.empty()) continue;
+            for (int step = 0; step <= num_steps; ++step) {
+                arrival.first_arrival_counts[step] += buffer.first_arrival_counts[k][step];
+            }
+        }
+        int arrived = 0;
+        for (int count : arrival.first_arrival_counts) {
+            arrived += count;
+        }
+        arrival.probability = (double)arrived / members;
+        arrival.p10_hours = arrivalQuantile(arrival.first_arrival_counts, arrived, 0.1, step_hours);
+        arrival.p50_hours = arrivalQuantile(arrival.first_arrival_counts, arrived, 0.5, step_hours);
+        arrival.p90_hours = arrivalQuantile(arrival.first_arrival_counts, arrived, 0.9, step_hours);
+        result.locations.push_back(arrival);
+    }
+    return result;
+}
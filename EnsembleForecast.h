@@ -0,0 +1,50 @@
+// EnsembleForecast.h
+#ifndef ENSEMBLE_FORECAST_H
+#define ENSEMBLE_FORECAST_H
+
+#include "Locations.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct EnsembleOptions {
+    int members = 200;
+    float hours = 8.0f;
+    float step_minutes = 20.0f;
+    float diffusion_m2_per_s = 2.0f;        // 随机游走扩散系数
+    float velocity_scale_sigma = 0.15f;     // 成员流速整体缩放扰动（相对标准差）
+    float velocity_rotation_sigma_deg = 10.0f; // 成员流向整体旋转扰动（度）
+    uint64_t seed = 20210530;
+    size_t threads = 0;                     // 0 表示使用硬件并发数
+};
+
+// 某地点的首次到达时间分布
+struct LocationArrival {
+    std::string name;
+    cv::Point coordinate;
+    double probability;                     // 预报时段内藻华到达的成员比例
+    std::vector<int> first_arrival_counts;  // 下标为时间步，值为在该步首次到达的成员数
+    float p10_hours;                        // 首次到达时间的分位数（仅统计到达的成员），未到达时为 -1
+    float p50_hours;
+    float p90_hours;
+};
+
+struct EnsembleResult {
+    int members;
+    cv::Mat arrival_probability;            // CV_32F，预报时段内每个像素被藻华经过的概率
+    std::vector<LocationArrival> locations;
+};
+
+// 蒙特卡洛集合预报：各成员按流速缩放/旋转扰动与随机游走扩散推进粒子，
+// 成员在线程池上并行，每个线程复用自己的粒子与计数缓冲区；
+// 成员 i 的随机数流只由 (seed, i) 决定，结果与线程数无关
+EnsembleResult runEnsembleForecast(
+    const cv::Mat& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    float spatial_resolution_meters,
+    const std::vector<Location>& locations,
+    const EnsembleOptions& options = EnsembleOptions()
+);
+
+#endif
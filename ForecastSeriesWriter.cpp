@@ -0,0 +1,260 @@
+// ForecastSeriesWriter.cpp（预报时间序列的 GeoTIFF 写出）
+#include "ForecastSeriesWriter.h"
+#include "Trace.h"
+#include "gdal_priv.h"
+#include <opencv2/core/utils/filesystem.hpp>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+std::string jsonString(const std::string& text) {
+    std::string escaped = "\"";
+    for (char c : text) {
+        switch (c) {
+        case '"':  escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        case '\t': escaped += "\\t"; break;
+        default:   escaped += c; break;
+        }
+    }
+    return escaped + "\"";
+}
+
+const char* dataTypeName(int depth) {
+    return depth == CV_8U ? "uint8" : "float32";
+}
+
+size_t fileSize(const std::string& path) {
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    return file ? (size_t)file.tellg() : 0;
+}
+
+}
+
+ForecastSeriesWriter::ForecastSeriesWriter(const std::string& output_dir, const GeoReference& geo_reference,
+    const SeriesWriterOptions& options)
+    : output_dir_(output_dir), geo_reference_(geo_reference), options_(options),
+      queue_(options.queue_capacity), closed_(false) {
+    if (options_.keyframe_interval < 1) {
+        options_.keyframe_interval = 1;
+    }
+    GDALAllRegister();
+    cv::utils::fs::createDirectories(output_dir_);
+    writer_ = std::thread(&ForecastSeriesWriter::writerLoop, this);
+}
+
+ForecastSeriesWriter::~ForecastSeriesWriter() {
+    close();
+}
+
+void ForecastSeriesWriter::writeStep(const std::string& series, float minutes, const cv::Mat& layer) {
+    if (layer.type() != CV_8U && layer.type() != CV_32F && layer.type() != CV_32FC2) {
+        std::cerr << "错误：时间序列 " << series << " 不支持该数据类型: " << layer.type() << std::endl;
+        return;
+    }
+    // 调用方会复用缓冲区，入队前拷贝一份
+    queue_.push(StepJob{ series, minutes, layer.clone() });
+}
+
+void ForecastSeriesWriter::close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    queue_.close();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    writeManifest();
+
+    size_t steps = 0, bytes = 0;
+    for (const auto& entry : series_) {
+        steps += entry.second.steps.size();
+        bytes += entry.second.bytes_written;
+    }
+    std::cout << cv::format("时间序列输出完成：%d 个序列、%d 个时间步，共 %.2f MB -> ",
+        (int)series_.size(), (int)steps, bytes / (1024.0 * 1024.0))
+        << cv::utils::fs::join(output_dir_, "manifest.json") << std::endl;
+}
+
+void ForecastSeriesWriter::writerLoop() {
+    StepJob job;
+    while (queue_.pop(job)) {
+        writeJob(job);
+    }
+}
+
+void ForecastSeriesWriter::writeJob(const StepJob& job) {
+    ALGAE_TRACE_SCOPE("write_series_step");
+    SeriesState& state = series_[job.series];
+    if (!state.previous.empty() && (state.previous.size() != job.layer.size() || state.previous.type() != job.layer.type())) {
+        std::cerr << "错误：时间序列 " << job.series << " 的尺寸或类型发生变化，已丢弃该帧。" << std::endl;
+        return;
+    }
+
+    // 文件名只保留字母数字，避免序列名中的路径字符
+    std::string directory_name;
+    for (char c : job.series) {
+        directory_name += std::isalnum((unsigned char)c) ? c : '_';
+    }
+    cv::utils::fs::createDirectories(cv::utils::fs::join(output_dir_, directory_name));
+    std::string relative = directory_name + "/" + cv::format("t%05d.tif", cvRound(job.minutes));
+
+    const bool keyframe = state.previous.empty() || state.steps.size() % options_.keyframe_interval == 0;
+    cv::Mat payload;
+    if (keyframe) {
+        payload = job.layer;
+    }
+    else {
+        // 按位异或：逐字节可逆，浮点数据也无精度损失；未变化的像素为0
+        cv::bitwise_xor(job.layer, state.previous, payload);
+    }
+
+    std::string path = cv::utils::fs::join(output_dir_, relative);
+    if (!writeGeoTiff(path, payload, keyframe, job.minutes, job.layer.depth() == CV_8U)) {
+        return;
+    }
+    state.previous = job.layer;
+    state.steps.push_back(StepEntry{ job.minutes, relative, keyframe });
+    state.bytes_written += fileSize(path);
+}
+
+bool ForecastSeriesWriter::writeGeoTiff(const std::string& path, const cv::Mat& data, bool keyframe,
+    float minutes, bool categorical) const {
+    const GDALDataType gdal_type = data.depth() == CV_8U ? GDT_Byte : GDT_Float32;
+    const int num_bands = data.channels();
+    const std::string block = cv::format("%d", options_.block_size);
+
+    // 先在内存数据集中组装像素与元数据，有 COG 驱动时整体复制为 COG，否则写瓦片化 GTiff
+    GDALDriver* mem_driver = GetGDALDriverManager()->GetDriverByName("MEM");
+    GDALDriver* cog_driver = GetGDALDriverManager()->GetDriverByName("COG");
+    GDALDriver* gtiff_driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+    if (gtiff_driver == NULL || (cog_driver != NULL && mem_driver == NULL)) {
+        std::cerr << "错误：GDAL缺少GTiff驱动。" << std::endl;
+        return false;
+    }
+
+    GDALDataset* dataset = NULL;
+    char** create_options = NULL;
+    if (cog_driver != NULL) {
+        dataset = mem_driver->Create("", data.cols, data.rows, num_bands, gdal_type, NULL);
+    }
+    else {
+        create_options = CSLSetNameValue(create_options, "TILED", "YES");
+        create_options = CSLSetNameValue(create_options, "BLOCKXSIZE", block.c_str());
+        create_options = CSLSetNameValue(create_options, "BLOCKYSIZE", block.c_str());
+        create_options = CSLSetNameValue(create_options, "COMPRESS", "DEFLATE");
+        create_options = CSLSetNameValue(create_options, "PREDICTOR", gdal_type == GDT_Byte ? "2" : "3");
+        dataset = gtiff_driver->Create(path.c_str(), data.cols, data.rows, num_bands, gdal_type, create_options);
+        CSLDestroy(create_options);
+        create_options = NULL;
+    }
+    if (dataset == NULL) {
+        std::cerr << "错误：无法创建时间序列文件: " << path << " (" << CPLGetLastErrorMsg() << ")" << std::endl;
+        return false;
+    }
+
+    if (geo_reference_.valid) {
+        double geo_transform[6];
+        std::copy(geo_reference_.geo_transform, geo_reference_.geo_transform + 6, geo_transform);
+        dataset->SetGeoTransform(geo_transform);
+    }
+    if (!geo_reference_.projection_wkt.empty()) {
+        dataset->SetProjection(geo_reference_.projection_wkt.c_str());
+    }
+    dataset->SetMetadataItem("FORECAST_MINUTES", cv::format("%.1f", minutes).c_str());
+    dataset->SetMetadataItem("FRAME_ENCODING", keyframe ? "KEY" : "XOR_DELTA");
+
+    const int element_size = (int)data.elemSize1();
+    bool ok = true;
+    for (int b = 0; b < num_bands && ok; ++b) {
+        ok = dataset->GetRasterBand(b + 1)->RasterIO(GF_Write, 0, 0, data.cols, data.rows,
+            (void*)(data.data + b * element_size), data.cols, data.rows, gdal_type,
+            (GSpacing)data.elemSize(), (GSpacing)data.step) == CE_None;
+    }
+
+    // 完整帧附带金字塔：掩膜取最近邻，浓度与流速取平均；差分帧的金字塔没有意义
+    const char* resampling = categorical ? "NEAREST" : "AVERAGE";
+    if (ok && cog_driver != NULL) {
+        create_options = CSLSetNameValue(create_options, "BLOCKSIZE", block.c_str());
+        create_options = CSLSetNameValue(create_options, "COMPRESS", "DEFLATE");
+        create_options = CSLSetNameValue(create_options, "PREDICTOR", "YES");
+        create_options = CSLSetNameValue(create_options, "OVERVIEWS", keyframe ? "AUTO" : "NONE");
+        create_options = CSLSetNameValue(create_options, "RESAMPLING", resampling);
+        GDALDataset* copy = cog_driver->CreateCopy(path.c_str(), dataset, FALSE, create_options, NULL, NULL);
+        CSLDestroy(create_options);
+        ok = copy != NULL;
+        if (copy != NULL) {
+            GDALClose(copy);
+        }
+    }
+    else if (ok && keyframe) {
+        std::vector<int> levels;
+        for (int level = 2; std::max(data.cols, data.rows) / level >= options_.block_size; level *= 2) {
+            levels.push_back(level);
+        }
+        if (!levels.empty()) {
+            ok = dataset->BuildOverviews(resampling, (int)levels.size(), levels.data(), 0, NULL, NULL, NULL) == CE_None;
+        }
+    }
+    GDALClose(dataset);
+
+    if (!ok) {
+        std::cerr << "错误：写入时间序列文件失败: " << path << " (" << CPLGetLastErrorMsg() << ")" << std::endl;
+    }
+    return ok;
+}
+
+void ForecastSeriesWriter::writeManifest() const {
+    std::string path = cv::utils::fs::join(output_dir_, "manifest.json");
+    std::ofstream out(path.c_str());
+    if (!out) {
+        std::cerr << "错误：无法写出时间序列清单: " << path << std::endl;
+        return;
+    }
+
+    out << "{\n";
+    out << "  \"format\": \"algae-forecast-series/1\",\n";
+    out << "  \"geo_transform\": [";
+    for (int k = 0; k < 6; ++k) {
+        out << (k ? ", " : "") << cv::format("%.10g", geo_reference_.geo_transform[k]);
+    }
+    out << "],\n";
+    out << "  \"georeferenced\": " << (geo_reference_.valid ? "true" : "false") << ",\n";
+    out << "  \"projection\": " << jsonString(geo_reference_.projection_wkt) << ",\n";
+    out << "  \"keyframe_interval\": " << options_.keyframe_interval << ",\n";
+    out << "  \"delta_encoding\": \"xor\",\n";
+    out << "  \"series\": {";
+    bool first_series = true;
+    for (const auto& entry : series_) {
+        const SeriesState& state = entry.second;
+        if (state.steps.empty()) {
+            continue;
+        }
+        out << (first_series ? "\n" : ",\n");
+        first_series = false;
+        out << "    " << jsonString(entry.first) << ": {\n";
+        out << "      \"width\": " << state.previous.cols << ", \"height\": " << state.previous.rows
+            << ", \"bands\": " << state.previous.channels()
+            << ", \"data_type\": \"" << dataTypeName(state.previous.depth()) << "\",\n";
+        out << "      \"steps\": [";
+        for (size_t i = 0; i < state.steps.size(); ++i) {
+            const StepEntry& step = state.steps[i];
+            out << (i ? ",\n" : "\n") << "        {\"minutes\": " << cv::format("%.1f", step.minutes)
+                << ", \"file\": " << jsonString(step.file)
+                << ", \"keyframe\": " << (step.keyframe ? "true" : "false");
+            // 差分帧的解码基准是上一步的完整值
+            if (!step.keyframe) {
+                out << ", \"base\": " << jsonString(state.steps[i - 1].file);
+            }
+            out << "}";
+        }
+        out << "\n      ]\n    }";
+    }
+    out << "\n  }\n}\n";
+}
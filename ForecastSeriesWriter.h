@@ -0,0 +1,72 @@
+// ForecastSeriesWriter.h
+#ifndef FORECAST_SERIES_WRITER_H
+#define FORECAST_SERIES_WRITER_H
+
+#include "BoundedQueue.h"
+#include "ImageProcessor.h"
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SeriesWriterOptions {
+    int keyframe_interval = 12;     // 每隔多少步写一个完整帧，其余帧为与上一帧的按位异或差分
+    int block_size = 256;           // GeoTIFF 瓦片边长
+    size_t queue_capacity = 8;
+};
+
+// 预报时间序列的后台写出器
+// 每个序列（如 forecast_mask、concentration、velocity）的每个时间步写成一个带地理参考的
+// 瓦片化 DEFLATE 压缩 GeoTIFF（GDAL 提供 COG 驱动时写 Cloud-Optimized GeoTIFF），
+// 完整帧附带金字塔，差分帧只保存与上一帧的异或结果（未变化处全为0，压缩后几乎不占空间）；
+// close 时在输出目录写出 manifest.json，列出各序列的时间步、文件与解码所需的基准帧。
+// 浏览端只需按 manifest 取所需时间步的瓦片即可。
+class ForecastSeriesWriter {
+public:
+    ForecastSeriesWriter(const std::string& output_dir, const GeoReference& geo_reference,
+        const SeriesWriterOptions& options = SeriesWriterOptions());
+    ~ForecastSeriesWriter();
+
+    ForecastSeriesWriter(const ForecastSeriesWriter&) = delete;
+    ForecastSeriesWriter& operator=(const ForecastSeriesWriter&) = delete;
+
+    // 提交 series 在 minutes 时刻的一帧（入队前拷贝）；layer 为 CV_8U（掩膜）、CV_32F（浓度）
+    // 或 CV_32FC2（流速，写为两个波段）。同一序列的尺寸与类型须保持不变
+    void writeStep(const std::string& series, float minutes, const cv::Mat& layer);
+
+    // 写完队列中剩余的帧、结束写出线程并生成 manifest.json
+    void close();
+
+private:
+    struct StepJob {
+        std::string series;
+        float minutes;
+        cv::Mat layer;
+    };
+    struct StepEntry {
+        float minutes;
+        std::string file;           // 相对输出目录
+        bool keyframe;
+    };
+    struct SeriesState {
+        cv::Mat previous;
+        std::vector<StepEntry> steps;
+        size_t bytes_written = 0;
+    };
+
+    void writerLoop();
+    void writeJob(const StepJob& job);
+    bool writeGeoTiff(const std::string& path, const cv::Mat& data, bool keyframe, float minutes, bool categorical) const;
+    void writeManifest() const;
+
+    std::string output_dir_;
+    GeoReference geo_reference_;
+    SeriesWriterOptions options_;
+    BoundedQueue<StepJob> queue_;
+    std::map<std::string, SeriesState> series_;    // 仅由写出线程访问
+    std::thread writer_;
+    bool closed_;
+};
+
+#endif
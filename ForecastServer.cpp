@@ -0,0 +1,544 @@
+// ForecastServer.cpp（常驻预报服务）
+#include "ForecastServer.h"
+#include "ImageProcessor.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <opencv2/core/utils/filesystem.hpp>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstring>
+#include <thread>
+#endif
+
+// 预报与预警支持的最长时间
+static const float MAX_QUERY_HOURS = 24.0f;
+static const float SNAPSHOT_MINUTES = 20.0f;
+
+// ---------------------------------------------------------------------------
+// 行式 JSON：请求只需要扁平对象（字符串、数字、布尔），不引入第三方库
+// ---------------------------------------------------------------------------
+
+static void skipSpaces(const std::string& text, size_t& pos) {
+    while (pos < text.size() && std::isspace((unsigned char)text[pos])) ++pos;
+}
+
+static bool parseJsonString(const std::string& text, size_t& pos, std::string& value) {
+    if (pos >= text.size() || text[pos] != '"') return false;
+    ++pos;
+    value.clear();
+    while (pos < text.size() && text[pos] != '"') {
+        char c = text[pos++];
+        if (c == '\\' && pos < text.size()) {
+            char escaped = text[pos++];
+            switch (escaped) {
+            case 'n': value += '\n'; break;
+            case 't': value += '\t'; break;
+            case 'r': value += '\r'; break;
+            default: value += escaped; break;   // \" \\ \/；\u 转义按原样保留
+            }
+        }
+        else {
+            value += c;
+        }
+    }
+    if (pos >= text.size()) return false;
+    ++pos;
+    return true;
+}
+
+static bool parseFlatJsonObject(const std::string& text, std::map<std::string, std::string>& fields) {
+    size_t pos = 0;
+    skipSpaces(text, pos);
+    if (pos >= text.size() || text[pos] != '{') return false;
+    ++pos;
+    skipSpaces(text, pos);
+    if (pos < text.size() && text[pos] == '}') return true;
+
+    while (pos < text.size()) {
+        std::string key, value;
+        skipSpaces(text, pos);
+        if (!parseJsonString(text, pos, key)) return false;
+        skipSpaces(text, pos);
+        if (pos >= text.size() || text[pos] != ':') return false;
+        ++pos;
+        skipSpaces(text, pos);
+        if (pos < text.size() && text[pos] == '"') {
+            if (!parseJsonString(text, pos, value)) return false;
+        }
+        else {
+            size_t end = pos;
+            while (end < text.size() && text[end] != ',' && text[end] != '}' && !std::isspace((unsigned char)text[end])) ++end;
+            value = text.substr(pos, end - pos);
+            if (value.empty()) return false;
+            pos = end;
+        }
+        fields[key] = value;
+        skipSpaces(text, pos);
+        if (pos < text.size() && text[pos] == ',') {
+            ++pos;
+            continue;
+        }
+        return pos < text.size() && text[pos] == '}';
+    }
+    return false;
+}
+
+static std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size() + 2);
+    for (char c : text) {
+        switch (c) {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        case '\t': escaped += "\\t"; break;
+        default: escaped += c; break;
+        }
+    }
+    return escaped;
+}
+
+// 原样带回请求 id：数字保持数字，其余按字符串输出
+static std::string idField(const std::map<std::string, std::string>& request) {
+    auto it = request.find("id");
+    if (it == request.end()) return "";
+    char* end = NULL;
+    std::strtod(it->second.c_str(), &end);
+    bool numeric = !it->second.empty() && end != NULL && *end == '\0';
+    return "\"id\": " + (numeric ? it->second : "\"" + jsonEscape(it->second) + "\"") + ", ";
+}
+
+static std::string errorResponse(const std::map<std::string, std::string>& request, const std::string& message) {
+    return "{" + idField(request) + "\"ok\": false, \"error\": \"" + jsonEscape(message) + "\"}";
+}
+
+static double numberField(const std::map<std::string, std::string>& request, const std::string& key, double fallback) {
+    auto it = request.find(key);
+    if (it == request.end()) return fallback;
+    char* end = NULL;
+    double value = std::strtod(it->second.c_str(), &end);
+    return (end != NULL && *end == '\0') ? value : fallback;
+}
+
+static std::string stringField(const std::map<std::string, std::string>& request, const std::string& key) {
+    auto it = request.find(key);
+    return it == request.end() ? std::string() : it->second;
+}
+
+// ---------------------------------------------------------------------------
+
+ForecastServer::ForecastServer(
+    const cv::Mat& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    const cv::Mat& colormap,
+    float spatial_resolution_meters,
+    size_t num_threads
+)
+    : initial_algae_mask_(initial_algae_mask),
+      velocity_field_mps_(velocity_field_mps),
+      colormap_(colormap),
+      spatial_resolution_meters_(spatial_resolution_meters),
+      arrival_estimator_(initial_algae_mask, velocity_field_mps, spatial_resolution_meters,
+          [] { ArrivalOptions options; options.horizon_hours = MAX_QUERY_HOURS; return options; }()),
+      snapshot_substeps_(1),
+      shutdown_requested_(false),
+      pool_(num_threads) {
+    warning_locations_ = defaultWaterIntakes();
+    std::vector<Location> scenic_spots = defaultScenicSpots();
+    warning_locations_.insert(warning_locations_.end(), scenic_spots.begin(), scenic_spots.end());
+
+    std::shared_ptr<AlgaeParticleEngine> initial(new AlgaeParticleEngine(velocity_field_mps, spatial_resolution_meters));
+    initial->seedFromMask(initial_algae_mask);
+    snapshot_substeps_ = initial->suggestSubsteps(SNAPSHOT_MINUTES * 60.0f);
+    std::promise<Snapshot> ready;
+    ready.set_value(initial);
+    snapshots_.push_back(ready.get_future().share());
+}
+
+ForecastServer::Snapshot ForecastServer::snapshotAtOrBefore(float minutes) {
+    const size_t index = (size_t)std::floor(minutes / SNAPSHOT_MINUTES);
+    // 快照按需向后延伸；已有的快照只读，可被多个请求共享。
+    // 锁内只登记缺少的快照并由本请求认领，推进在锁外进行，不阻塞读取已有快照的请求
+    std::vector<std::promise<Snapshot>> claimed;
+    std::shared_future<Snapshot> base;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        if (index < snapshots_.size()) {
+            base = snapshots_[index];
+        }
+        else {
+            base = snapshots_.back();
+            while (snapshots_.size() <= index) {
+                claimed.emplace_back();
+                snapshots_.push_back(claimed.back().get_future().share());
+            }
+        }
+    }
+
+    // base 可能仍由其他请求在推进，get() 等待其完成
+    Snapshot previous = base.get();
+    size_t done = 0;
+    try {
+        for (; done < claimed.size(); ++done) {
+            std::shared_ptr<AlgaeParticleEngine> next(new AlgaeParticleEngine(*previous));
+            next->step(SNAPSHOT_MINUTES * 60.0f, snapshot_substeps_, Integrator::RK2);
+            claimed[done].set_value(next);
+            previous = next;
+        }
+    }
+    catch (...) {
+        // 等待这些快照的请求同样得到异常
+        for (; done < claimed.size(); ++done) {
+            claimed[done].set_exception(std::current_exception());
+        }
+        throw;
+    }
+    return previous;
+}
+
+std::shared_ptr<const SalvageScenario> ForecastServer::salvageScenario(cv::Point intake_center) {
+    std::lock_guard<std::mutex> lock(scenario_mutex_);
+    auto key = std::make_pair(intake_center.x, intake_center.y);
+    auto it = scenarios_.find(key);
+    if (it != scenarios_.end()) {
+        return it->second;
+    }
+    std::shared_ptr<const SalvageScenario> scenario(new SalvageScenario(makeSalvageScenario(
+        initial_algae_mask_, velocity_field_mps_, colormap_, spatial_resolution_meters_, intake_center)));
+    scenarios_[key] = scenario;
+    return scenario;
+}
+
+std::string ForecastServer::handleForecast(const Request& request) {
+    float hours = (float)numberField(request, "hours", 1.0);
+    if (!(hours >= 0.0f && hours <= MAX_QUERY_HOURS)) {
+        return errorResponse(request, cv::format("hours 须在 0 到 %.0f 之间", MAX_QUERY_HOURS));
+    }
+
+    // 只允许写到服务配置的输出目录下：output 须为不含路径的 .png 文件名
+    std::string output_name = stringField(request, "output");
+    std::string output_path;
+    if (!output_name.empty()) {
+        if (output_directory_.empty()) {
+            return errorResponse(request, "服务未配置输出目录，不能写出文件");
+        }
+        std::string extension = output_name.size() > 4 ? output_name.substr(output_name.size() - 4) : std::string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        if (output_name.find_first_of("/\\:") != std::string::npos || output_name[0] == '.' || extension != ".png") {
+            return errorResponse(request, "output 须为输出目录下的 .png 文件名，不能包含路径");
+        }
+        output_path = cv::utils::fs::join(output_directory_, output_name);
+    }
+
+    float minutes = hours * 60.0f;
+    Snapshot snapshot = snapshotAtOrBefore(minutes);
+    float remaining_seconds = (minutes - std::floor(minutes / SNAPSHOT_MINUTES) * SNAPSHOT_MINUTES) * 60.0f;
+
+    CompactMask predicted_mask;
+    if (remaining_seconds > 0.0f) {
+        AlgaeParticleEngine engine(*snapshot);
+        engine.setParallel(false);
+        engine.step(remaining_seconds, engine.suggestSubsteps(remaining_seconds), Integrator::RK2);
+        predicted_mask = engine.rasterizeCompact();
+    }
+    else {
+        predicted_mask = snapshot->rasterizeCompact();
+    }
+
+    size_t algae_pixels = predicted_mask.count();
+    std::ostringstream out;
+    out << "{" << idField(request) << "\"ok\": true, \"type\": \"forecast\", \"hours\": " << hours
+        << ", \"algae_pixels\": " << algae_pixels;
+    if (algae_pixels > 0) {
+        cv::Rect bbox = predicted_mask.boundingRect();
+        cv::Point2d centroid = predicted_mask.centroid();
+        out << ", \"centroid\": [" << centroid.x << ", " << centroid.y << "]"
+            << ", \"bbox\": [" << bbox.x << ", " << bbox.y << ", " << bbox.width << ", " << bbox.height << "]";
+    }
+    if (request.count("x") && request.count("y")) {
+        int x = (int)numberField(request, "x", -1);
+        int y = (int)numberField(request, "y", -1);
+        bool inside = x >= 0 && y >= 0 && x < predicted_mask.cols() && y < predicted_mask.rows();
+        out << ", \"present\": " << ((inside && predicted_mask.test(x, y)) ? "true" : "false");
+    }
+    if (!output_path.empty()) {
+        bool written = cv::imwrite(output_path, createColorMapFromMask(predicted_mask, colormap_));
+        out << ", \"output\": \"" << jsonEscape(output_path) << "\", \"written\": " << (written ? "true" : "false");
+    }
+    out << "}";
+    return out.str();
+}
+
+std::string ForecastServer::handleWarning(const Request& request) {
+    float hours = (float)numberField(request, "hours", 8.0);
+    std::vector<ArrivalEstimate> arrivals = arrival_estimator_.query(warning_locations_);
+
+    std::ostringstream out;
+    out << "{" << idField(request) << "\"ok\": true, \"type\": \"warning\", \"hours\": " << hours << ", \"locations\": [";
+    for (size_t i = 0; i < warning_locations_.size(); ++i) {
+        const ArrivalEstimate& arrival = arrivals[i];
+        bool within = arrival.reached && arrival.arrival_hours <= hours;
+        out << (i ? ", " : "") << "{\"name\": \"" << jsonEscape(warning_locations_[i].name) << "\", \"warning\": "
+            << (within ? "true" : "false");
+        if (arrival.reached) {
+            out << ", \"arrival_hours\": " << arrival.arrival_hours << ", \"source_region\": " << arrival.source_region;
+        }
+        out << "}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+std::string ForecastServer::handleArrival(const Request& request) {
+    if (!request.count("x") || !request.count("y")) {
+        return errorResponse(request, "arrival 请求需要 x 与 y");
+    }
+    cv::Point2f point((float)numberField(request, "x", -1), (float)numberField(request, "y", -1));
+    ArrivalEstimate arrival = arrival_estimator_.query(point);
+
+    std::ostringstream out;
+    out << "{" << idField(request) << "\"ok\": true, \"type\": \"arrival\", \"reached\": " << (arrival.reached ? "true" : "false");
+    if (arrival.reached) {
+        out << ", \"arrival_hours\": " << arrival.arrival_hours
+            << ", \"source\": [" << arrival.source.x << ", " << arrival.source.y << "]"
+            << ", \"source_region\": " << arrival.source_region;
+    }
+    out << "}";
+    return out.str();
+}
+
+std::string ForecastServer::handleSalvage(const Request& request) {
+    int boats = (int)numberField(request, "boats", -1);
+    if (boats < 0) {
+        return errorResponse(request, "salvage 请求需要非负的 boats");
+    }
+
+    cv::Point intake(-1, -1);
+    std::string intake_name = stringField(request, "intake");
+    if (!intake_name.empty()) {
+        for (const auto& location : defaultWaterIntakes()) {
+            if (location.name == intake_name || location.name.find(intake_name) == 0) {
+                intake = location.coordinate;
+                intake_name = location.name;
+            }
+        }
+        if (intake.x < 0) {
+            return errorResponse(request, "未知的水源地: " + intake_name);
+        }
+    }
+    else if (request.count("x") && request.count("y")) {
+        intake = cv::Point((int)numberField(request, "x", -1), (int)numberField(request, "y", -1));
+    }
+    else {
+        intake = defaultWaterIntakes()[1].coordinate;   // 与打捞模拟默认的太湖镇水源地一致
+    }
+    if (intake.x < 0 || intake.y < 0 || intake.x >= initial_algae_mask_.cols || intake.y >= initial_algae_mask_.rows) {
+        return errorResponse(request, "取水口坐标超出影像范围");
+    }
+
+    std::shared_ptr<const SalvageScenario> scenario = salvageScenario(intake);
+    SalvageOutcome outcome = simulateSalvage(*scenario, boats);
+
+    std::ostringstream out;
+    out << "{" << idField(request) << "\"ok\": true, \"type\": \"salvage\", \"boats\": " << boats
+        << ", \"intake\": [" << intake.x << ", " << intake.y << "], \"success\": " << (outcome.success ? "true" : "false");
+    if (!outcome.success) {
+        out << ", \"failure_minutes\": " << outcome.failure_minutes;
+    }
+    out << ", \"health\": [";
+    for (size_t i = 0; i < outcome.health_trajectory.size(); ++i) {
+        out << (i ? ", " : "") << outcome.health_trajectory[i];
+    }
+    out << "]}";
+    return out.str();
+}
+
+std::string ForecastServer::handleRequest(const std::string& line) {
+    Request request;
+    if (!parseFlatJsonObject(line, request)) {
+        return errorResponse(request, "无法解析请求，需为单行扁平 JSON 对象");
+    }
+
+    int64 start = cv::getTickCount();
+    std::string type = stringField(request, "type");
+    std::string response;
+    try {
+        if (type == "forecast") response = handleForecast(request);
+        else if (type == "warning") response = handleWarning(request);
+        else if (type == "arrival") response = handleArrival(request);
+        else if (type == "salvage") response = handleSalvage(request);
+        else if (type == "ping") response = "{" + idField(request) + "\"ok\": true, \"type\": \"ping\"}";
+        else return errorResponse(request, "未知的请求类型: " + type);
+    }
+    catch (const std::exception& e) {
+        return errorResponse(request, e.what());
+    }
+
+    // 在应答末尾附上服务端耗时
+    double elapsed_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    if (!response.empty() && response.back() == '}') {
+        response.insert(response.size() - 1, cv::format(", \"elapsed_ms\": %.3f", elapsed_ms));
+    }
+    return response;
+}
+
+bool ForecastServer::dispatch(const std::string& line, const ResponseWriter& writer, std::vector<std::future<void>>& pending) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+        return true;
+    }
+    Request request;
+    if (parseFlatJsonObject(line, request) && stringField(request, "type") == "shutdown") {
+        shutdown_requested_ = true;
+        writer("{" + idField(request) + "\"ok\": true, \"type\": \"shutdown\"}");
+        return false;
+    }
+
+    // 清理已完成的请求，避免长连接上 future 无限增长
+    pending.erase(std::remove_if(pending.begin(), pending.end(), [](std::future<void>& f) {
+        return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), pending.end());
+    pending.push_back(pool_.submit([this, line, writer] {
+        writer(handleRequest(line));
+    }));
+    return true;
+}
+
+void ForecastServer::serveStream(std::istream& input, std::ostream& output) {
+    std::mutex output_mutex;
+    ResponseWriter writer = [&](const std::string& response) {
+        std::lock_guard<std::mutex> lock(output_mutex);
+        output << response << std::endl;
+    };
+
+    std::vector<std::future<void>> pending;
+    std::string line;
+    while (!shutdown_requested_ && std::getline(input, line)) {
+        if (!dispatch(line, writer, pending)) break;
+    }
+    for (auto& f : pending) {
+        f.get();
+    }
+}
+
+bool ForecastServer::serveUnixSocket(const std::string& socket_path) {
+#ifdef _WIN32
+    std::cerr << "错误：当前平台不支持 Unix 套接字，请使用标准输入模式。" << std::endl;
+    return false;
+#else
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "错误：套接字路径过长: " << socket_path << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "错误：无法创建套接字。" << std::endl;
+        return false;
+    }
+    ::unlink(socket_path.c_str());
+    if (::bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(listen_fd, 16) != 0) {
+        std::cerr << "错误：无法监听套接字: " << socket_path << std::endl;
+        ::close(listen_fd);
+        return false;
+    }
+    std::cerr << "预报服务已在 " << socket_path << " 上监听" << std::endl;
+
+    // 连接线程按编号保存；结束的连接登记编号，接受下一个连接前合并并移除，线程数不随历史连接数增长
+    std::map<int, std::thread> connections;
+    int next_connection = 0;
+    std::mutex clients_mutex;
+    std::vector<int> client_fds;
+    std::vector<int> finished_connections;
+    auto reap_finished = [&] {
+        std::vector<int> finished;
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            finished.swap(finished_connections);
+        }
+        for (int id : finished) {
+            auto it = connections.find(id);
+            it->second.join();
+            connections.erase(it);
+        }
+    };
+    // 收到 shutdown 后唤醒 accept 与所有阻塞在 recv 上的连接
+    auto stop_all = [&] {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        ::shutdown(listen_fd, SHUT_RDWR);
+        for (int fd : client_fds) {
+            ::shutdown(fd, SHUT_RD);
+        }
+    };
+
+    while (!shutdown_requested_) {
+        int client_fd = ::accept(listen_fd, NULL, NULL);
+        reap_finished();
+        if (client_fd < 0) {
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            client_fds.push_back(client_fd);
+        }
+        const int connection_id = next_connection++;
+        connections[connection_id] = std::thread([this, client_fd, connection_id, &stop_all, &clients_mutex, &client_fds, &finished_connections] {
+            std::mutex send_mutex;
+            ResponseWriter writer = [&](const std::string& response) {
+                std::lock_guard<std::mutex> lock(send_mutex);
+                std::string data = response + "\n";
+                size_t sent = 0;
+                while (sent < data.size()) {
+                    ssize_t n = ::send(client_fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                    if (n <= 0) break;
+                    sent += (size_t)n;
+                }
+            };
+
+            std::vector<std::future<void>> pending;
+            std::string buffer;
+            char chunk[4096];
+            bool open = true;
+            while (open && !shutdown_requested_) {
+                ssize_t n = ::recv(client_fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) break;
+                buffer.append(chunk, (size_t)n);
+                size_t newline;
+                while (open && (newline = buffer.find('\n')) != std::string::npos) {
+                    std::string line = buffer.substr(0, newline);
+                    buffer.erase(0, newline + 1);
+                    if (!dispatch(line, writer, pending)) {
+                        open = false;
+                        stop_all();
+                    }
+                }
+            }
+            // 本连接的请求全部应答后再关闭
+            for (auto& f : pending) {
+                f.get();
+            }
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            client_fds.erase(std::remove(client_fds.begin(), client_fds.end(), client_fd), client_fds.end());
+            ::close(client_fd);
+            finished_connections.push_back(connection_id);
+        });
+    }
+
+    for (auto& connection : connections) {
+        connection.second.join();
+    }
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+    return true;
+#endif
+}
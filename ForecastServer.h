@@ -0,0 +1,90 @@
+// ForecastServer.h
+#ifndef FORECAST_SERVER_H
+#define FORECAST_SERVER_H
+
+#include "AlgaeParticleEngine.h"
+#include "AlgaeSalvageSim.h"
+#include "ArrivalTime.h"
+#include "Locations.h"
+#include "ThreadPool.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 常驻预报服务：场景产品与流场只加载一次，按行读取 JSON 请求，每行一个对象，
+// 每个请求的应答也是一行 JSON，并原样带回请求中的 "id"。各请求在线程池上并发执行，
+// 应答顺序不一定与请求顺序一致。
+//
+//   {"id": 1, "type": "forecast", "hours": 3.5}                     某时刻藻华分布（像素数、质心、外接框，可选 "x","y" 点查询、
+//                                                                   "output" 把PNG写到输出目录下的该文件名）
+//   {"id": 2, "type": "warning", "hours": 8}                        各水源地/景区的到达时间
+//   {"id": 3, "type": "arrival", "x": 700, "y": 400}                任意点的到达时间与来源斑块
+//   {"id": 4, "type": "salvage", "boats": 4, "intake": "沙渚水源地"}   指定船队规模的打捞结果（也可用 "x","y" 指定取水口）
+//   {"id": 5, "type": "ping"} / {"type": "shutdown"}
+class ForecastServer {
+public:
+    ForecastServer(
+        const cv::Mat& initial_algae_mask,
+        const cv::Mat& velocity_field_mps,
+        const cv::Mat& colormap,
+        float spatial_resolution_meters,
+        size_t num_threads = 0
+    );
+
+    // forecast 请求的 "output" 只能是该目录下的文件名；未设置时拒绝写出
+    void setOutputDirectory(const std::string& directory) { output_directory_ = directory; }
+
+    // 从输入流读取请求、向输出流写应答，直到输入结束或收到 shutdown
+    void serveStream(std::istream& input, std::ostream& output);
+    // 在本地 Unix 套接字上服务，每个连接一个读取线程，请求仍在共享线程池上执行；
+    // 不支持 Unix 套接字的平台返回 false
+    bool serveUnixSocket(const std::string& socket_path);
+
+    // 处理单个请求行，返回应答行（不含换行符）
+    std::string handleRequest(const std::string& line);
+
+private:
+    typedef std::map<std::string, std::string> Request;
+    typedef std::function<void(const std::string&)> ResponseWriter;
+
+    // 把一行请求交给线程池，完成后经 writer 写回；shutdown 请求返回 false
+    bool dispatch(const std::string& line, const ResponseWriter& writer, std::vector<std::future<void>>& pending);
+
+    std::string handleForecast(const Request& request);
+    std::string handleWarning(const Request& request);
+    std::string handleArrival(const Request& request);
+    std::string handleSalvage(const Request& request);
+
+    typedef std::shared_ptr<const AlgaeParticleEngine> Snapshot;
+    // 每 SNAPSHOT_MINUTES 分钟保存一次粒子状态，预报请求从最近的快照继续推进
+    Snapshot snapshotAtOrBefore(float minutes);
+    std::shared_ptr<const SalvageScenario> salvageScenario(cv::Point intake_center);
+
+    cv::Mat initial_algae_mask_;
+    cv::Mat velocity_field_mps_;
+    cv::Mat colormap_;
+    float spatial_resolution_meters_;
+    std::vector<Location> warning_locations_;
+    ArrivalTimeEstimator arrival_estimator_;
+    std::string output_directory_;
+
+    // 每个快照一个 future：锁内只登记，推进由登记它的请求在锁外完成，其余请求等待结果
+    std::mutex snapshot_mutex_;
+    std::vector<std::shared_future<Snapshot>> snapshots_;
+    int snapshot_substeps_;
+
+    std::mutex scenario_mutex_;
+    std::map<std::pair<int, int>, std::shared_ptr<const SalvageScenario>> scenarios_;
+
+    std::atomic<bool> shutdown_requested_;
+    ThreadPool pool_;
+};
+
+#endif
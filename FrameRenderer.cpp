@@ -0,0 +1,216 @@
+// FrameRenderer.cpp（推演画面的增量渲染）
+#include "FrameRenderer.h"
+#include "AlgaeTracker.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const cv::Vec3b ALGAE_COLOR(0, 200, 0);     // 与 createColorMapFromMask 的藻华绿色一致
+
+inline cv::Vec3b blend(const cv::Vec3b& base, const cv::Vec3b& top, int weight, int total) {
+    const int keep = total - weight;
+    const int half = total / 2;
+    return cv::Vec3b(
+        (uchar)((base[0] * keep + top[0] * weight + half) / total),
+        (uchar)((base[1] * keep + top[1] * weight + half) / total),
+        (uchar)((base[2] * keep + top[2] * weight + half) / total));
+}
+
+// 显示像素到原始像素的区间起点，末尾追加 source_length
+void buildFootprints(int source_length, int display_length, std::vector<int>& starts) {
+    starts.resize(display_length + 1);
+    const double ratio = (double)source_length / display_length;
+    for (int d = 0; d < display_length; ++d) {
+        starts[d] = std::min(source_length - 1, (int)std::floor(d * ratio));
+    }
+    starts[display_length] = source_length;
+}
+
+}
+
+FrameRenderer::FrameRenderer()
+    : scale_(1.0), blocks_x_(0), blocks_y_(0), frames_(0), recomposited_blocks_(0) {}
+
+FrameRenderer::FrameRenderer(const cv::Mat& static_layer, double display_scale)
+    : source_size_(static_layer.size()), scale_(display_scale), frames_(0), recomposited_blocks_(0) {
+    CV_Assert(static_layer.type() == CV_8UC3 && display_scale > 0.0);
+    // 与 cv::resize(src, dst, cv::Size(), scale, scale) 的输出尺寸一致
+    const cv::Size display_size(std::max(1, cvRound(source_size_.width * scale_)), std::max(1, cvRound(source_size_.height * scale_)));
+    cv::resize(static_layer, background_, display_size, 0, 0, cv::INTER_AREA);
+    background_.copyTo(frame_);
+
+    buildFootprints(source_size_.width, display_size.width, source_x0_);
+    buildFootprints(source_size_.height, display_size.height, source_y0_);
+
+    blocks_x_ = (display_size.width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    blocks_y_ = (display_size.height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    dirty_.assign((size_t)blocks_x_ * blocks_y_, 0);
+    dirty_blocks_.reserve(dirty_.size());
+
+    previous_sparse_ = SparseTileMask(source_size_);
+    previous_compact_ = CompactMask(source_size_);
+}
+
+void FrameRenderer::setFlowArrows(const cv::Mat& flow_pixels, int step, float gain, const cv::Scalar& color) {
+    CV_Assert(flow_pixels.type() == CV_32FC2 && flow_pixels.size() == source_size_);
+    // 箭头直接以显示分辨率画在单通道覆盖度图上，合成时按覆盖度与底图混合
+    arrow_alpha_.create(background_.size(), CV_8U);
+    arrow_alpha_.setTo(cv::Scalar(0));
+    AlgaeTracker::drawFlowArrows(arrow_alpha_, flow_pixels, step, gain,
+        (double)background_.cols / source_size_.width, cv::Scalar(255));
+    arrow_color_ = cv::Vec3b(cv::saturate_cast<uchar>(color[0]), cv::saturate_cast<uchar>(color[1]), cv::saturate_cast<uchar>(color[2]));
+    markAll();
+}
+
+void FrameRenderer::markDisplayRect(const cv::Rect& rect) {
+    const cv::Rect clipped = rect & cv::Rect(0, 0, frame_.cols, frame_.rows);
+    if (clipped.area() == 0) {
+        return;
+    }
+    const int bx1 = (clipped.x + clipped.width - 1) / BLOCK_SIZE;
+    const int by1 = (clipped.y + clipped.height - 1) / BLOCK_SIZE;
+    for (int by = clipped.y / BLOCK_SIZE; by <= by1; ++by) {
+        for (int bx = clipped.x / BLOCK_SIZE; bx <= bx1; ++bx) {
+            const int block = by * blocks_x_ + bx;
+            if (!dirty_[block]) {
+                dirty_[block] = 1;
+                dirty_blocks_.push_back(block);
+            }
+        }
+    }
+}
+
+void FrameRenderer::markSourceRect(const cv::Rect& rect) {
+    // 多留一个显示像素，覆盖区间跨过矩形边界的显示像素也会重绘
+    const double sx = (double)frame_.cols / source_size_.width;
+    const double sy = (double)frame_.rows / source_size_.height;
+    const int x0 = (int)std::floor(rect.x * sx) - 1;
+    const int y0 = (int)std::floor(rect.y * sy) - 1;
+    const int x1 = (int)std::ceil((rect.x + rect.width) * sx) + 1;
+    const int y1 = (int)std::ceil((rect.y + rect.height) * sy) + 1;
+    markDisplayRect(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+}
+
+void FrameRenderer::markAll() {
+    markDisplayRect(cv::Rect(0, 0, frame_.cols, frame_.rows));
+}
+
+template <typename Test>
+int FrameRenderer::recomposite(const Test& test) {
+    for (const auto& rect : text_rects_) {
+        markDisplayRect(rect);
+    }
+    text_rects_.clear();
+
+    const bool has_arrows = !arrow_alpha_.empty();
+    cv::parallel_for_(cv::Range(0, (int)dirty_blocks_.size()), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            const int block = dirty_blocks_[i];
+            const cv::Rect area = cv::Rect((block % blocks_x_) * BLOCK_SIZE, (block / blocks_x_) * BLOCK_SIZE, BLOCK_SIZE, BLOCK_SIZE)
+                & cv::Rect(0, 0, frame_.cols, frame_.rows);
+            for (int dy = area.y; dy < area.y + area.height; ++dy) {
+                const int sy0 = source_y0_[dy];
+                const int sy1 = std::max(sy0 + 1, source_y0_[dy + 1]);
+                const cv::Vec3b* background_row = background_.ptr<cv::Vec3b>(dy);
+                const uchar* arrow_row = has_arrows ? arrow_alpha_.ptr<uchar>(dy) : NULL;
+                cv::Vec3b* out = frame_.ptr<cv::Vec3b>(dy);
+                for (int dx = area.x; dx < area.x + area.width; ++dx) {
+                    const int sx0 = source_x0_[dx];
+                    const int sx1 = std::max(sx0 + 1, source_x0_[dx + 1]);
+                    int covered = 0;
+                    for (int sy = sy0; sy < sy1; ++sy) {
+                        for (int sx = sx0; sx < sx1; ++sx) {
+                            covered += test(sx, sy) ? 1 : 0;
+                        }
+                    }
+                    cv::Vec3b pixel = background_row[dx];
+                    if (covered > 0) {
+                        pixel = blend(pixel, ALGAE_COLOR, covered, (sx1 - sx0) * (sy1 - sy0));
+                    }
+                    if (arrow_row && arrow_row[dx]) {
+                        pixel = blend(pixel, arrow_color_, arrow_row[dx], 255);
+                    }
+                    out[dx] = pixel;
+                }
+            }
+        }
+    });
+
+    const int recomposited = (int)dirty_blocks_.size();
+    for (int block : dirty_blocks_) {
+        dirty_[block] = 0;
+    }
+    dirty_blocks_.clear();
+    recomposited_blocks_ += recomposited;
+    ++frames_;
+    ALGAE_TRACE_ANNOTATE("blocks", recomposited);
+    return recomposited;
+}
+
+int FrameRenderer::update(const SparseTileMask& mask) {
+    CV_Assert(mask.size() == source_size_);
+    ALGAE_TRACE_SCOPE("render_frame");
+
+    // 两帧都未分配或内容相同的瓦片不必重绘；未分配视为全0
+    const int tile_rows = SparseTileMask::TILE_SIZE;
+    auto tile_changed = [&](int tile) {
+        const uint64_t* current = mask.tileRows(tile);
+        const uint64_t* previous = previous_sparse_.tileRows(tile);
+        for (int r = 0; r < tile_rows; ++r) {
+            if ((current ? current[r] : 0) != (previous ? previous[r] : 0)) return true;
+        }
+        return false;
+    };
+    for (int tile : mask.activeTiles()) {
+        if (tile_changed(tile)) markSourceRect(mask.tileRect(tile));
+    }
+    for (int tile : previous_sparse_.activeTiles()) {
+        if (!mask.tileRows(tile) && tile_changed(tile)) markSourceRect(mask.tileRect(tile));
+    }
+
+    const int recomposited = recomposite([&mask](int x, int y) { return mask.test(x, y); });
+    previous_sparse_ = mask;
+    return recomposited;
+}
+
+int FrameRenderer::update(const CompactMask& mask) {
+    CV_Assert(mask.size() == source_size_);
+    ALGAE_TRACE_SCOPE("render_frame");
+
+    // 每个64位字恰好是一个 64×64 瓦片的一行，按瓦片比较两帧的字
+    const int tile = 64;
+    const int words = mask.wordsPerRow();
+    for (int ty = 0; ty * tile < mask.rows(); ++ty) {
+        const int y0 = ty * tile;
+        const int y1 = std::min(mask.rows(), y0 + tile);
+        for (int w = 0; w < words; ++w) {
+            bool changed = false;
+            for (int y = y0; y < y1 && !changed; ++y) {
+                changed = mask.rowPtr(y)[w] != previous_compact_.rowPtr(y)[w];
+            }
+            if (changed) {
+                markSourceRect(cv::Rect(w * tile, y0, tile, y1 - y0));
+            }
+        }
+    }
+
+    const int recomposited = recomposite([&mask](int x, int y) { return mask.test(x, y); });
+    previous_compact_ = mask;
+    return recomposited;
+}
+
+void FrameRenderer::drawText(const std::string& text, cv::Point origin, double font_scale, const cv::Scalar& color, int thickness) {
+    const double sx = (double)frame_.cols / source_size_.width;
+    const double sy = (double)frame_.rows / source_size_.height;
+    const cv::Point display_origin(cvRound(origin.x * sx), cvRound(origin.y * sy));
+    const double display_font_scale = font_scale * sy;
+    const int display_thickness = std::max(1, cvRound(thickness * sy));
+
+    int baseline = 0;
+    const cv::Size text_size = cv::getTextSize(text, cv::FONT_HERSHEY_SIMPLEX, display_font_scale, display_thickness, &baseline);
+    text_rects_.push_back(cv::Rect(display_origin.x - display_thickness, display_origin.y - text_size.height - display_thickness,
+        text_size.width + 2 * display_thickness, text_size.height + baseline + 2 * display_thickness));
+    cv::putText(frame_, text, display_origin, cv::FONT_HERSHEY_SIMPLEX, display_font_scale, color, display_thickness);
+}
@@ -0,0 +1,77 @@
+// FrameRenderer.h
+#ifndef FRAME_RENDERER_H
+#define FRAME_RENDERER_H
+
+#include "CompactMask.h"
+#include "SparseTileMask.h"
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 推演画面的增量渲染器，直接在显示分辨率上合成
+// 静态图层（伪彩色底图、警戒圈与地点标记）与流场箭头层只缩放/绘制一次；每帧按 64×64 瓦片
+// 比较本帧与上一帧的掩膜，只重新合成有变化的瓦片落入的显示块。显示像素按其覆盖的原始像素中
+// 藻华所占比例与底图混合，效果与整幅合成后 INTER_AREA 缩小相当，但不再拷贝与缩放整幅画面。
+// 每帧先 update，再 drawText；文字所在区域在下一次 update 时还原
+class FrameRenderer {
+public:
+    static const int BLOCK_SIZE = 32;       // 显示分辨率上的重新合成单元（像素）
+
+    FrameRenderer();
+    // static_layer 为原始分辨率的 CV_8UC3 静态图层，按 display_scale 缩放后缓存
+    FrameRenderer(const cv::Mat& static_layer, double display_scale);
+
+    // 叠加流场箭头层：flow_pixels 为原始分辨率的 CV_32FC2 位移（像素），箭头规则同 AlgaeTracker::visualizeFlow
+    void setFlowArrows(const cv::Mat& flow_pixels, int step, float gain = 10.0f,
+        const cv::Scalar& color = cv::Scalar(0, 0, 255));
+
+    // 以本帧掩膜更新画面，返回重新合成的显示块数；掩膜尺寸须与静态图层相同
+    int update(const SparseTileMask& mask);
+    int update(const CompactMask& mask);
+
+    // 在显示帧上写字（FONT_HERSHEY_SIMPLEX）；origin、font_scale 与 thickness 按原始分辨率给出
+    void drawText(const std::string& text, cv::Point origin, double font_scale, const cv::Scalar& color, int thickness);
+
+    const cv::Mat& frame() const { return frame_; }
+    cv::Size sourceSize() const { return source_size_; }
+    double displayScale() const { return scale_; }
+    // 显示块总数与累计统计
+    int blockCount() const { return blocks_x_ * blocks_y_; }
+    size_t frames() const { return frames_; }
+    size_t recompositedBlocks() const { return recomposited_blocks_; }
+
+private:
+    // 原始分辨率上的矩形对应的显示块标记为待重绘
+    void markSourceRect(const cv::Rect& rect);
+    void markDisplayRect(const cv::Rect& rect);
+    void markAll();
+    // 重新合成已标记的显示块，test(x, y) 返回原始像素是否为藻华
+    template <typename Test>
+    int recomposite(const Test& test);
+
+    cv::Size source_size_;
+    double scale_;
+    cv::Mat background_;                    // 显示分辨率的静态图层
+    cv::Mat arrow_alpha_;                   // 箭头覆盖度（CV_8U），无箭头层时为空
+    cv::Vec3b arrow_color_;
+    cv::Mat frame_;
+
+    // 显示像素 dx 覆盖原始列 [source_x0_[dx], source_x0_[dx + 1])（放大显示时至少一列），行同理
+    std::vector<int> source_x0_;
+    std::vector<int> source_y0_;
+
+    int blocks_x_;
+    int blocks_y_;
+    std::vector<unsigned char> dirty_;      // 每个显示块是否待重绘
+    std::vector<int> dirty_blocks_;
+    std::vector<cv::Rect> text_rects_;      // 上一帧文字占用的显示区域
+
+    SparseTileMask previous_sparse_;
+    CompactMask previous_compact_;
+
+    size_t frames_;
+    size_t recomposited_blocks_;
+};
+
+#endif
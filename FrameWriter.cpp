@@ -0,0 +1,121 @@
+// FrameWriter.cpp（模拟画面的显示与异步写出）
+#include "FrameWriter.h"
+#include "Trace.h"
+#include <opencv2/core/utils/filesystem.hpp>
+#include <cctype>
+#include <iostream>
+
+WindowFrameSink::WindowFrameSink(int frame_delay_ms) : frame_delay_ms_(frame_delay_ms) {}
+
+bool WindowFrameSink::submit(const std::string& stream, const cv::Mat& frame) {
+    cv::imshow(stream, frame);
+    return cv::waitKey(frame_delay_ms_) != 27;
+}
+
+void WindowFrameSink::endStream(const std::string& stream, bool pause) {
+    if (pause) {
+        cv::waitKey(0);
+    }
+    cv::destroyWindow(stream);
+}
+
+void WindowFrameSink::writeStill(const std::string& name, const cv::Mat& image) {
+    cv::imshow(name, image);
+}
+
+AsyncFrameWriter::AsyncFrameWriter(const std::string& output_dir, FrameOutputFormat format,
+    double fps, size_t queue_capacity)
+    : output_dir_(output_dir), format_(format), fps_(fps), queue_(queue_capacity), closed_(false) {
+    cv::utils::fs::createDirectories(output_dir_);
+    encoder_ = std::thread(&AsyncFrameWriter::encoderLoop, this);
+}
+
+AsyncFrameWriter::~AsyncFrameWriter() {
+    close();
+}
+
+bool AsyncFrameWriter::submit(const std::string& stream, const cv::Mat& frame) {
+    // 调用方会复用帧缓冲区，入队前拷贝一份
+    queue_.push(FrameJob{ JobKind::Frame, stream, frame.clone() });
+    return true;
+}
+
+void AsyncFrameWriter::endStream(const std::string& stream, bool /*pause*/) {
+    queue_.push(FrameJob{ JobKind::EndStream, stream, cv::Mat() });
+}
+
+void AsyncFrameWriter::writeStill(const std::string& name, const cv::Mat& image) {
+    queue_.push(FrameJob{ JobKind::Still, name, image.clone() });
+}
+
+void AsyncFrameWriter::close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    queue_.close();
+    if (encoder_.joinable()) {
+        encoder_.join();
+    }
+}
+
+std::string AsyncFrameWriter::streamPath(const std::string& stream, const std::string& suffix) const {
+    // 窗口标题转为文件名
+    std::string file_name;
+    for (char c : stream) {
+        file_name += std::isalnum((unsigned char)c) ? c : '_';
+    }
+    return cv::utils::fs::join(output_dir_, file_name + suffix);
+}
+
+void AsyncFrameWriter::encoderLoop() {
+    FrameJob job;
+    while (queue_.pop(job)) {
+        encodeFrame(job);
+    }
+    for (auto& entry : streams_) {
+        entry.second.video.release();
+    }
+    streams_.clear();
+}
+
+void AsyncFrameWriter::encodeFrame(const FrameJob& job) {
+    ALGAE_TRACE_SCOPE("encode_frame");
+    if (job.kind == JobKind::Still) {
+        std::string path = streamPath(job.stream, ".png");
+        if (!cv::imwrite(path, job.image)) {
+            std::cerr << "错误：无法写出图像: " << path << std::endl;
+        }
+        return;
+    }
+
+    if (job.kind == JobKind::EndStream) {
+        auto it = streams_.find(job.stream);
+        if (it != streams_.end()) {
+            it->second.video.release();
+            std::cout << "已写出 " << it->second.frame_count << " 帧: " << job.stream << std::endl;
+            streams_.erase(it);
+        }
+        return;
+    }
+
+    StreamState& state = streams_[job.stream];
+    if (format_ == FrameOutputFormat::Video) {
+        if (!state.video.isOpened()) {
+            std::string path = streamPath(job.stream, ".mp4");
+            if (!state.video.open(path, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps_, job.image.size())) {
+                std::cerr << "错误：无法创建视频文件: " << path << std::endl;
+                return;
+            }
+        }
+        state.video.write(job.image);
+    }
+    else {
+        std::string path = streamPath(job.stream, cv::format("_%06d.png", state.frame_count));
+        if (!cv::imwrite(path, job.image)) {
+            std::cerr << "错误：无法写出图像: " << path << std::endl;
+            return;
+        }
+    }
+    ++state.frame_count;
+}
@@ -0,0 +1,81 @@
+// FrameWriter.h
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include "BoundedQueue.h"
+#include <opencv2/opencv.hpp>
+#include <map>
+#include <string>
+#include <thread>
+
+// 模拟画面的去向：交互窗口或后台写文件
+// 每个 stream 对应一个画面序列（原先的一个 imshow 窗口）
+class FrameSink {
+public:
+    virtual ~FrameSink() {}
+    // 提交一帧，返回 false 表示用户请求提前结束
+    virtual bool submit(const std::string& stream, const cv::Mat& frame) = 0;
+    // 画面序列结束；pause 为 true 时交互模式等待按键
+    virtual void endStream(const std::string& stream, bool pause) = 0;
+    // 单张静态结果图
+    virtual void writeStill(const std::string& name, const cv::Mat& image) = 0;
+};
+
+// 交互模式：imshow + waitKey，与原有行为一致
+class WindowFrameSink : public FrameSink {
+public:
+    explicit WindowFrameSink(int frame_delay_ms = 100);
+    bool submit(const std::string& stream, const cv::Mat& frame) override;
+    void endStream(const std::string& stream, bool pause) override;
+    void writeStill(const std::string& name, const cv::Mat& image) override;
+
+private:
+    int frame_delay_ms_;
+};
+
+enum class FrameOutputFormat {
+    PngSequence,
+    Video
+};
+
+// 无界面模式：帧进入有界队列，由后台编码线程写出 PNG 序列或视频，
+// 渲染/编码与模拟计算重叠进行，不做任何等待
+class AsyncFrameWriter : public FrameSink {
+public:
+    AsyncFrameWriter(const std::string& output_dir, FrameOutputFormat format,
+        double fps = 10.0, size_t queue_capacity = 16);
+    ~AsyncFrameWriter();
+
+    bool submit(const std::string& stream, const cv::Mat& frame) override;
+    void endStream(const std::string& stream, bool pause) override;
+    void writeStill(const std::string& name, const cv::Mat& image) override;
+
+    // 写完队列中剩余的帧并结束编码线程
+    void close();
+
+private:
+    enum class JobKind { Frame, Still, EndStream };
+    struct FrameJob {
+        JobKind kind;
+        std::string stream;
+        cv::Mat image;
+    };
+    struct StreamState {
+        int frame_count = 0;
+        cv::VideoWriter video;
+    };
+
+    void encoderLoop();
+    void encodeFrame(const FrameJob& job);
+    std::string streamPath(const std::string& stream, const std::string& suffix) const;
+
+    std::string output_dir_;
+    FrameOutputFormat format_;
+    double fps_;
+    BoundedQueue<FrameJob> queue_;
+    std::map<std::string, StreamState> streams_;  // 仅由编码线程访问
+    std::thread encoder_;
+    bool closed_;
+};
+
+#endif
@@ -1,9 +1,23 @@
 // ImageProcessor.cpp（数据预处理）
 #include "ImageProcessor.h"
+#include "Trace.h"
+#include <algorithm>
 #include <iostream>
 #include "gdal_priv.h"
+#include <opencv2/core/hal/intrin.hpp>
 
-ImageProcessor::ImageProcessor(const std::string& image_path) {
+// 瓦片边长至少取 MIN_TILE_EXTENT 像素，并对齐到GDAL块大小的整数倍
+static const int MIN_TILE_EXTENT = 512;
+
+static int alignTileExtent(int block_extent, int full_extent) {
+    block_extent = std::max(1, block_extent);
+    int extent = ((MIN_TILE_EXTENT + block_extent - 1) / block_extent) * block_extent;
+    return std::min(extent, full_extent);
+}
+
+ImageProcessor::ImageProcessor(const std::string& image_path)
+    : image_path_(image_path), width_(0), height_(0), num_bands_(0),
+      gdal_type_(GDT_Unknown), opencv_type_(-1), loaded_successfully_(false) {
     GDALAllRegister();
     GDALDataset* poDataset = (GDALDataset*)GDALOpen(image_path.c_str(), GA_ReadOnly);
 
@@ -38,60 +52,135 @@ ImageProcessor::ImageProcessor(const std::string& image_path) {
 
     std::cout << "检测到GDAL数据类型: " << GDALGetDataTypeName(gdal_type) << ", 对应OpenCV类型: " << opencv_type << std::endl;
 
-    std::vector<cv::Mat> bands_vector;
-    for (int i = 1; i <= num_bands; ++i) {
-        GDALRasterBand* poBand = poDataset->GetRasterBand(i);
-
-        cv::Mat current_band(height, width, opencv_type);
+    // 只记录元数据，像素数据在各计算阶段按块流式读取
+    int block_x = 0, block_y = 0;
+    poDataset->GetRasterBand(1)->GetBlockSize(&block_x, &block_y);
 
-        CPLErr read_result = poBand->RasterIO(GF_Read, 0, 0, width, height,
-            current_band.data, width, height, gdal_type,
-            0, 0);
-
-        if (read_result != CE_None) {
-            std::cerr << "错误：从波段 " << i << " 读取数据失败!" << std::endl;
-            loaded_successfully_ = false;
-            GDALClose(poDataset);
-            return;
-        }
-
-        bands_vector.push_back(current_band);
-    }
-
-    cv::merge(bands_vector, image_data_);
+    width_ = width;
+    height_ = height;
+    num_bands_ = num_bands;
+    gdal_type_ = gdal_type;
+    opencv_type_ = opencv_type;
+    tile_size_ = cv::Size(alignTileExtent(block_x, width), alignTileExtent(block_y, height));
+    geo_reference_.valid = poDataset->GetGeoTransform(geo_reference_.geo_transform) == CE_None;
+    const char* projection = poDataset->GetProjectionRef();
+    geo_reference_.projection_wkt = projection ? projection : "";
 
     loaded_successfully_ = true;
     GDALClose(poDataset);
 
     std::cout << "成功加载图像: " << image_path << std::endl;
-    std::cout << "尺寸: " << width << "x" << height << ", 通道数: " << image_data_.channels() << std::endl;
+    std::cout << "尺寸: " << width << "x" << height << ", 通道数: " << num_bands
+        << ", 块大小: " << block_x << "x" << block_y
+        << ", 读取瓦片: " << tile_size_.width << "x" << tile_size_.height << std::endl;
 }
 
 bool ImageProcessor::isLoaded() const {
     return loaded_successfully_;
 }
 
+cv::Size ImageProcessor::size() const {
+    return cv::Size(width_, height_);
+}
+
+cv::Size ImageProcessor::tileSize() const {
+    return tile_size_;
+}
+
+int ImageProcessor::bandCount() const {
+    return num_bands_;
+}
+
+int ImageProcessor::redBandIndex() const {
+    return num_bands_ - 2;
+}
+
+int ImageProcessor::nirBandIndex() const {
+    return num_bands_ - 1;
+}
+
+bool ImageProcessor::forEachTile(const std::vector<int>& band_indices, const TileCallback& callback) const {
+    if (!loaded_successfully_) {
+        return false;
+    }
+    for (int index : band_indices) {
+        if (index < 0 || index >= num_bands_) {
+            std::cerr << "错误：请求的波段序号越界: " << index << std::endl;
+            return false;
+        }
+    }
+
+    // 每次遍历单独打开数据集，不同阶段可以在不同线程中同时读取
+    GDALDataset* poDataset = (GDALDataset*)GDALOpen(image_path_.c_str(), GA_ReadOnly);
+    if (poDataset == NULL) {
+        std::cerr << "错误：GDAL无法打开图像，路径: " << image_path_ << std::endl;
+        return false;
+    }
+
+    RasterTile tile;
+    tile.bands.resize(band_indices.size());
+
+    for (int y = 0; y < height_; y += tile_size_.height) {
+        for (int x = 0; x < width_; x += tile_size_.width) {
+            tile.region = cv::Rect(x, y, std::min(tile_size_.width, width_ - x), std::min(tile_size_.height, height_ - y));
+
+            // raster_tile 包含读取与回调，两者之差即为GDAL读取耗时
+            ALGAE_TRACE_SCOPE("raster_tile");
+            for (size_t k = 0; k < band_indices.size(); ++k) {
+                cv::Mat& band_tile = tile.bands[k];
+                band_tile.create(tile.region.height, tile.region.width, opencv_type_);
+
+                GDALRasterBand* poBand = poDataset->GetRasterBand(band_indices[k] + 1);
+                CPLErr read_result = poBand->RasterIO(GF_Read, tile.region.x, tile.region.y, tile.region.width, tile.region.height,
+                    band_tile.data, tile.region.width, tile.region.height, (GDALDataType)gdal_type_,
+                    0, (GSpacing)band_tile.step[0]);
+
+                if (read_result != CE_None) {
+                    std::cerr << "错误：从波段 " << band_indices[k] + 1 << " 读取数据失败!" << std::endl;
+                    GDALClose(poDataset);
+                    return false;
+                }
+                ALGAE_TRACE_ANNOTATE("bytes_read", band_tile.total() * band_tile.elemSize());
+            }
+
+            {
+                ALGAE_TRACE_SCOPE("tile_kernel");
+                callback(tile);
+            }
+        }
+    }
+
+    GDALClose(poDataset);
+    return true;
+}
+
 cv::Mat ImageProcessor::calculateNDVI() {
-    if (!loaded_successfully_ || image_data_.channels() < 2) {
+    if (!loaded_successfully_ || num_bands_ < 2) {
         std::cerr << "错误：无法计算NDVI。图像未加载或波段数少于2。" << std::endl;
         return cv::Mat(); 
     }
 
-    std::vector<cv::Mat> bands = this->getBands();
-
-    cv::Mat red_band = bands[image_data_.channels() - 2];
-    cv::Mat nir_band = bands[image_data_.channels() - 1];
-
+    ALGAE_TRACE_SCOPE("calculate_ndvi");
+    ALGAE_TRACE_ANNOTATE("pixels", (double)width_ * height_);
+    cv::Mat ndvi(height_, width_, CV_32F);
     cv::Mat red_float, nir_float;
-    red_band.convertTo(red_float, CV_32F);
-    nir_band.convertTo(nir_float, CV_32F);
 
-    cv::Mat numerator = nir_float - red_float;
-    cv::Mat denominator = nir_float + red_float;
+    // 只读取红光与近红外两个波段
+    std::vector<int> ndvi_bands = { redBandIndex(), nirBandIndex() };
+    bool read_ok = forEachTile(ndvi_bands, [&](const RasterTile& tile) {
+        tile.bands[0].convertTo(red_float, CV_32F);
+        tile.bands[1].convertTo(nir_float, CV_32F);
 
-    cv::Mat ndvi;
-    cv::divide(numerator, denominator, ndvi);
+        cv::Mat numerator = nir_float - red_float;
+        cv::Mat denominator = nir_float + red_float;
 
+        cv::Mat ndvi_tile = ndvi(tile.region);
+        cv::divide(numerator, denominator, ndvi_tile);
+    });
+
+    if (!read_ok) {
+        return cv::Mat();
+    }
     return ndvi;
 }
 
@@ -101,19 +190,30 @@ cv::Mat ImageProcessor::extractAlgaeMask(const cv::Mat& ndvi_image) {
         return cv::Mat();
     }
 
-    cv::Mat algae_mask;
-    cv::threshold(ndvi_image, algae_mask, 0.0, 255.0, cv::THRESH_BINARY);
-
-    cv::Mat algae_mask_8u;
-    algae_mask.convertTo(algae_mask_8u, CV_8U);
-
-    return algae_mask_8u;
+    return AlgaeSegmenter(segmentation_options_).segment(ndvi_image);
 }
 
 std::vector<cv::Mat> ImageProcessor::getBands() const {
     std::vector<cv::Mat> bands;
-    if (loaded_successfully_) {
-        cv::split(image_data_, bands);
+    if (!loaded_successfully_) {
+        return bands;
+    }
+
+    std::vector<int> all_bands;
+    for (int i = 0; i < num_bands_; ++i) {
+        all_bands.push_back(i);
+        bands.push_back(cv::Mat(height_, width_, opencv_type_));
+    }
+
+    bool read_ok = forEachTile(all_bands, [&](const RasterTile& tile) {
+        for (size_t k = 0; k < tile.bands.size(); ++k) {
+            cv::Mat band_region = bands[k](tile.region);
+            tile.bands[k].copyTo(band_region);
+        }
+    });
+
+    if (!read_ok) {
+        bands.clear();
     }
     return bands;
 }
@@ -156,25 +256,239 @@ cv::Mat ImageProcessor::createDataMask() {
     if (!loaded_successfully_) {
         return cv::Mat();
     }
-    std::vector<cv::Mat> bands = this->getBands();
 
-    cv::Mat mask = cv::Mat::zeros(image_data_.size(), CV_8U);
-    cv::Mat accumulator = cv::Mat::zeros(image_data_.size(), CV_32F);
+    ALGAE_TRACE_SCOPE("create_data_mask");
+    cv::Mat final_mask = cv::Mat::zeros(height_, width_, CV_8U);
+    cv::Mat accumulator, band_float, mask;
 
-    for (const auto& band : bands) {
-        cv::Mat band_float;
-        band.convertTo(band_float, CV_32F);
-        accumulator += band_float;
+    std::vector<int> all_bands;
+    for (int i = 0; i < num_bands_; ++i) {
+        all_bands.push_back(i);
     }
 
-    cv::threshold(accumulator, mask, 0, 255, cv::THRESH_BINARY);
+    // 累加器只覆盖当前瓦片
+    bool read_ok = forEachTile(all_bands, [&](const RasterTile& tile) {
+        accumulator = cv::Mat::zeros(tile.region.size(), CV_32F);
+        for (const auto& band : tile.bands) {
+            band.convertTo(band_float, CV_32F);
+            accumulator += band_float;
+        }
+
+        cv::threshold(accumulator, mask, 0, 255, cv::THRESH_BINARY);
 
-    cv::Mat final_mask;
-    mask.convertTo(final_mask, CV_8U);
+        cv::Mat mask_tile = final_mask(tile.region);
+        mask.convertTo(mask_tile, CV_8U);
+    });
 
+    if (!read_ok) {
+        return cv::Mat();
+    }
     return final_mask;
 }
 
+// 融合内核已按 NDVI > 0 写出掩膜，其他阈值方式在整幅 NDVI 上重新分割
+static void segmentScene(const SegmentationOptions& options, SceneProducts& products) {
+    if (options.mode == ThresholdMode::Fixed && options.fixed_threshold == 0.0f) {
+        return;
+    }
+    AlgaeSegmenter(options).segment(products.ndvi, products.data_mask, products.algae_mask);
+}
+
+// 伪彩色查找表：前半段为水体（按 -NDVI 索引），后半段为藻华/陆地（按 NDVI 索引）
+static const int NDVI_LUT_BINS = 2048;
+
+static const std::vector<cv::Vec3b>& ndviColorLUT() {
+    static const std::vector<cv::Vec3b> lut = [] {
+        std::vector<cv::Vec3b> table(2 * NDVI_LUT_BINS);
+        for (int i = 0; i < NDVI_LUT_BINS; ++i) {
+            float ratio = (float)i / (NDVI_LUT_BINS - 1);
+            // 与 createNDVIColorMap 中的插值保持一致
+            table[i] = cv::Vec3b((uchar)(150 * (1 - ratio) + 200 * ratio),
+                (uchar)(100 * (1 - ratio) + 220 * ratio),
+                (uchar)(50 * (1 - ratio) + 180 * ratio));
+            table[NDVI_LUT_BINS + i] = cv::Vec3b((uchar)(20 * (1 - ratio) + 0 * ratio),
+                (uchar)(220 * (1 - ratio) + 80 * ratio),
+                (uchar)(20 * (1 - ratio) + 0 * ratio));
+        }
+        return table;
+    }();
+    return lut;
+}
+
+static inline int ndviLUTIndex(float ndvi_value) {
+    if (ndvi_value < 0) {
+        return std::min(cvRound(-ndvi_value * (NDVI_LUT_BINS - 1)), NDVI_LUT_BINS - 1);
+    }
+    if (ndvi_value >= 0) {
+        return NDVI_LUT_BINS + std::min(cvRound(ndvi_value * (NDVI_LUT_BINS - 1)), NDVI_LUT_BINS - 1);
+    }
+    return NDVI_LUT_BINS; // NaN（无数据像素 0/0）按 NDVI = 0 着色
+}
+
+void ImageProcessor::processTile(const RasterTile& tile, int red_slot, int nir_slot, SceneProducts& products) {
+    const cv::Rect& region = tile.region;
+    const int cols = region.width;
+    const std::vector<cv::Vec3b>& lut = ndviColorLUT();
+
+    // 行缓冲区：各波段的当前行转为浮点后只在缓存中停留一次
+    std::vector<cv::Mat> band_rows(tile.bands.size());
+    cv::Mat accumulator_row(1, cols, CV_32F);
+
+    for (int y = 0; y < region.height; ++y) {
+        for (size_t k = 0; k < tile.bands.size(); ++k) {
+            tile.bands[k].row(y).convertTo(band_rows[k], CV_32F);
+        }
+
+        const float* red = band_rows[red_slot].ptr<float>();
+        const float* nir = band_rows[nir_slot].ptr<float>();
+        float* acc = accumulator_row.ptr<float>();
+        float* ndvi = products.ndvi.ptr<float>(region.y + y) + region.x;
+        uchar* algae = products.algae_mask.ptr<uchar>(region.y + y) + region.x;
+        uchar* valid = products.data_mask.ptr<uchar>(region.y + y) + region.x;
+        cv::Vec3b* color = products.colormap.ptr<cv::Vec3b>(region.y + y) + region.x;
+
+        band_rows[0].copyTo(accumulator_row);
+        for (size_t k = 1; k < band_rows.size(); ++k) {
+            const float* band = band_rows[k].ptr<float>();
+            int x = 0;
+#if CV_SIMD128
+            for (; x <= cols - cv::v_float32x4::nlanes; x += cv::v_float32x4::nlanes) {
+                cv::v_store(acc + x, cv::v_load(acc + x) + cv::v_load(band + x));
+            }
+#endif
+            for (; x < cols; ++x) {
+                acc[x] += band[x];
+            }
+        }
+
+        int x = 0;
+#if CV_SIMD128
+        for (; x <= cols - cv::v_float32x4::nlanes; x += cv::v_float32x4::nlanes) {
+            cv::v_float32x4 r = cv::v_load(red + x);
+            cv::v_float32x4 n = cv::v_load(nir + x);
+            cv::v_store(ndvi + x, (n - r) / (n + r));
+        }
+#endif
+        for (; x < cols; ++x) {
+            ndvi[x] = (nir[x] - red[x]) / (nir[x] + red[x]);
+        }
+
+        for (x = 0; x < cols; ++x) {
+            algae[x] = ndvi[x] > 0 ? 255 : 0;
+            valid[x] = acc[x] > 0 ? 255 : 0;
+            color[x] = lut[ndviLUTIndex(ndvi[x])];
+        }
+    }
+}
+
+cv::Mat ImageProcessor::colorizeNDVI(const cv::Mat& ndvi_image) {
+    if (ndvi_image.empty() || ndvi_image.type() != CV_32F) {
+        std::cerr << "错误：colorizeNDVI 的输入无效，需要一个单通道浮点型Mat。" << std::endl;
+        return cv::Mat();
+    }
+
+    const std::vector<cv::Vec3b>& lut = ndviColorLUT();
+    cv::Mat colormap_image(ndvi_image.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, ndvi_image.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float* ndvi = ndvi_image.ptr<float>(y);
+            cv::Vec3b* color = colormap_image.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < ndvi_image.cols; ++x) {
+                color[x] = lut[ndviLUTIndex(ndvi[x])];
+            }
+        }
+    });
+    return colormap_image;
+}
+
+SceneProducts ImageProcessor::processScene() {
+    SceneProducts products;
+    if (!loaded_successfully_ || num_bands_ < 2) {
+        std::cerr << "错误：无法处理场景。图像未加载或波段数少于2。" << std::endl;
+        return products;
+    }
+
+    ALGAE_TRACE_SCOPE("process_scene");
+    ALGAE_TRACE_ANNOTATE("pixels", (double)width_ * height_);
+    products.ndvi.create(height_, width_, CV_32F);
+    products.algae_mask.create(height_, width_, CV_8U);
+    products.data_mask.create(height_, width_, CV_8U);
+    products.colormap.create(height_, width_, CV_8UC3);
+
+    // 有效数据掩膜需要全部波段，每个瓦片的每个波段只读取一次
+    std::vector<int> all_bands;
+    for (int i = 0; i < num_bands_; ++i) {
+        all_bands.push_back(i);
+    }
+
+    bool read_ok = forEachTile(all_bands, [&](const RasterTile& tile) {
+        processTile(tile, redBandIndex(), nirBandIndex(), products);
+    });
+
+    if (!read_ok) {
+        return SceneProducts();
+    }
+    segmentScene(segmentation_options_, products);
+    return products;
+}
+
+SceneProducts ImageProcessor::processSceneDownsampled(int factor) {
+    if (factor <= 1) {
+        return processScene();
+    }
+    SceneProducts products;
+    if (!loaded_successfully_ || num_bands_ < 2) {
+        std::cerr << "错误：无法处理场景。图像未加载或波段数少于2。" << std::endl;
+        return products;
+    }
+
+    ALGAE_TRACE_SCOPE("process_scene_downsampled");
+    const int out_width = std::max(1, width_ / factor);
+    const int out_height = std::max(1, height_ / factor);
+    ALGAE_TRACE_ANNOTATE("pixels", (double)out_width * out_height);
+
+    GDALDataset* poDataset = (GDALDataset*)GDALOpen(image_path_.c_str(), GA_ReadOnly);
+    if (poDataset == NULL) {
+        std::cerr << "错误：GDAL无法打开图像，路径: " << image_path_ << std::endl;
+        return products;
+    }
+
+    // 降采样后的整幅影像作为一个瓦片，一次读取每个波段
+    RasterTile tile;
+    tile.region = cv::Rect(0, 0, out_width, out_height);
+    tile.bands.resize(num_bands_);
+    GDALRasterIOExtraArg extra_arg;
+    INIT_RASTERIO_EXTRA_ARG(extra_arg);
+    extra_arg.eResampleAlg = GRIORA_Average;
+
+    for (int k = 0; k < num_bands_; ++k) {
+        cv::Mat& band = tile.bands[k];
+        band.create(out_height, out_width, opencv_type_);
+        GDALRasterBand* poBand = poDataset->GetRasterBand(k + 1);
+        CPLErr read_result = poBand->RasterIO(GF_Read, 0, 0, width_, height_,
+            band.data, out_width, out_height, (GDALDataType)gdal_type_,
+            0, (GSpacing)band.step[0], &extra_arg);
+        if (read_result != CE_None) {
+            std::cerr << "错误：从波段 " << k + 1 << " 读取降采样数据失败!" << std::endl;
+            GDALClose(poDataset);
+            return products;
+        }
+    }
+    GDALClose(poDataset);
+
+    products.ndvi.create(out_height, out_width, CV_32F);
+    products.algae_mask.create(out_height, out_width, CV_8U);
+    products.data_mask.create(out_height, out_width, CV_8U);
+    products.colormap.create(out_height, out_width, CV_8UC3);
+    processTile(tile, redBandIndex(), nirBandIndex(), products);
+
+    // 瓦片边长随分辨率缩小，覆盖的地面范围与全分辨率一致
+    SegmentationOptions preview_options = segmentation_options_;
+    preview_options.tile_size = std::max(1, preview_options.tile_size / factor);
+    segmentScene(preview_options, products);
+    return products;
+}
+
 cv::Mat createColorMapFromMask(const cv::Mat& mask, const cv::Mat& background_template) {
     cv::Mat colormap = background_template.clone();
     colormap.setTo(cv::Scalar(0, 200, 0), mask);
@@ -2,22 +2,81 @@
 #ifndef IMAGE_PROCESSOR_H
 #define IMAGE_PROCESSOR_H
 
+#include "AlgaeSegmenter.h"
 #include <opencv2/opencv.hpp>
+#include <functional>
 #include <string>
 #include <vector>
 
+// 分块读取得到的一个瓦片
+// region 为瓦片在整幅影像中的位置，bands 按请求的波段顺序存放该区域的原始数据
+struct RasterTile {
+    cv::Rect region;
+    std::vector<cv::Mat> bands;
+};
+
+// 影像的地理参考：GDAL 仿射变换六参数与投影（WKT），用于写出带坐标的预报结果
+struct GeoReference {
+    double geo_transform[6] = { 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+    std::string projection_wkt;
+    bool valid = false;             // 影像不含地理变换时为 false，此时为像素坐标
+};
+
+// 融合内核单次遍历得到的全部场景产品
+struct SceneProducts {
+    cv::Mat ndvi;        // CV_32F
+    cv::Mat algae_mask;  // CV_8U，NDVI 高于阈值处为255（阈值方式见 SegmentationOptions）
+    cv::Mat data_mask;   // CV_8U，各波段之和 > 0 处为255
+    cv::Mat colormap;    // CV_8UC3，NDVI伪彩色
+};
+
 class ImageProcessor {
 public:
+    // 回调拿到的瓦片缓冲区会在下一个瓦片中复用，需要保留时请自行拷贝
+    typedef std::function<void(const RasterTile&)> TileCallback;
+
     ImageProcessor(const std::string& image_path);
     bool isLoaded() const;
     cv::Mat calculateNDVI();
+    // 按 segmentationOptions() 分割，默认为分块大津法
     cv::Mat extractAlgaeMask(const cv::Mat& ndvi_image);
     std::vector<cv::Mat> getBands() const;
     cv::Mat createNDVIColorMap(const cv::Mat& ndvi_image);
     cv::Mat createDataMask();
 
+    // 单次遍历同时计算 NDVI、藻华掩膜、有效数据掩膜与伪彩色图
+    SceneProducts processScene();
+    // 以 1/factor 分辨率执行融合内核，供渐进式预览使用；影像带金字塔（overview）时GDAL直接读取对应层级，
+    // 否则读取时按区域平均降采样
+    SceneProducts processSceneDownsampled(int factor);
+    // 对一个包含全部波段的瓦片执行融合内核，结果写入 products 中 tile.region 对应的区域；
+    // 瓦片内的藻华掩膜按 NDVI > 0 给出，自适应阈值需在整幅 NDVI 完成后另行分割
+    static void processTile(const RasterTile& tile, int red_slot, int nir_slot, SceneProducts& products);
+    // 用融合内核的查找表为已有的NDVI着色（按行并行，不读取影像）
+    static cv::Mat colorizeNDVI(const cv::Mat& ndvi_image);
+
+    // 按GDAL块大小分块遍历影像，只读取 band_indices 指定的波段（从0开始）
+    bool forEachTile(const std::vector<int>& band_indices, const TileCallback& callback) const;
+
+    cv::Size size() const;
+    cv::Size tileSize() const;
+    int bandCount() const;
+    int redBandIndex() const;
+    int nirBandIndex() const;
+    const GeoReference& geoReference() const { return geo_reference_; }
+    void setSegmentationOptions(const SegmentationOptions& options) { segmentation_options_ = options; }
+    const SegmentationOptions& segmentationOptions() const { return segmentation_options_; }
+
 private:
-    cv::Mat image_data_;
+    std::string image_path_;
+    int width_;
+    int height_;
+    int num_bands_;
+    int gdal_type_;
+    int opencv_type_;
+    cv::Size tile_size_;
+    GeoReference geo_reference_;
+    SegmentationOptions segmentation_options_;
     bool loaded_successfully_;
 };
 cv::Mat createColorMapFromMask(const cv::Mat& mask, const cv::Mat& background_template);
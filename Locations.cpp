@@ -0,0 +1,58 @@
+// Locations.cpp（水源地与景区坐标）
+#include "Locations.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+std::vector<Location> defaultWaterIntakes() {
+    return {
+        {"沙渚水源地", cv::Point(655, 334)},
+        {"太湖镇水源地", cv::Point(758, 498)},
+        {"渔洋山水源地", cv::Point(875, 741)}
+    };
+}
+
+std::vector<Location> defaultScenicSpots() {
+    return {
+        {"七里风光堤", cv::Point(361, 350)},
+        {"静山夕阳观景处", cv::Point(651, 919)},
+        {"香山景区", cv::Point(77, 878)},
+        {"太湖旅游度假区", cv::Point(390, 1290)}
+    };
+}
+
+std::vector<Location> loadLocationsCsv(const std::string& path) {
+    std::vector<Location> locations;
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "错误：无法打开监测点文件: " << path << std::endl;
+        return locations;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') continue;
+
+        std::stringstream stream(line);
+        std::string name, x_text, y_text;
+        if (!std::getline(stream, name, ',') || !std::getline(stream, x_text, ',') || !std::getline(stream, y_text, ',')) {
+            std::cerr << "警告：监测点文件第 " << line_number << " 行格式错误，已跳过" << std::endl;
+            continue;
+        }
+        try {
+            locations.push_back({ name, cv::Point(std::stoi(x_text), std::stoi(y_text)) });
+        }
+        catch (const std::exception&) {
+            // 表头等非数字行
+            if (line_number > 1) {
+                std::cerr << "警告：监测点文件第 " << line_number << " 行坐标无效，已跳过" << std::endl;
+            }
+        }
+    }
+    return locations;
+}
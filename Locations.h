@@ -0,0 +1,25 @@
+// Locations.h
+#ifndef LOCATIONS_H
+#define LOCATIONS_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// 关键地点
+struct Location {
+    std::string name;
+    cv::Point coordinate;
+};
+
+// 预警圈绘制半径（像素）
+const int WARNING_RADIUS = 30;
+
+std::vector<Location> defaultWaterIntakes();
+std::vector<Location> defaultScenicSpots();
+
+// 从CSV读取监测点，每行 "名称,x,y"（像素坐标），空行与 # 开头的行忽略；
+// 读取失败时返回空列表
+std::vector<Location> loadLocationsCsv(const std::string& path);
+
+#endif
@@ -0,0 +1,212 @@
+// SceneCache.cpp（NDVI 与流场的磁盘缓存）
+#include "SceneCache.h"
+#include <opencv2/core/utils/filesystem.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 文件头固定64字节，数据区按64字节对齐便于向量化读取
+static const char MAT_FILE_MAGIC[8] = { 'A', 'L', 'G', 'M', 'A', 'T', '0', '1' };
+static const size_t MAT_FILE_HEADER_SIZE = 64;
+
+struct MatFileHeader {
+    char magic[8];
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    int32_t reserved;
+    uint64_t data_bytes;
+};
+
+bool writeMatFile(const std::string& path, const cv::Mat& mat) {
+    cv::Mat continuous = mat.isContinuous() ? mat : mat.clone();
+
+    char header_bytes[MAT_FILE_HEADER_SIZE] = {};
+    MatFileHeader header;
+    std::memcpy(header.magic, MAT_FILE_MAGIC, sizeof(header.magic));
+    header.rows = continuous.rows;
+    header.cols = continuous.cols;
+    header.type = continuous.type();
+    header.reserved = 0;
+    header.data_bytes = (uint64_t)continuous.total() * continuous.elemSize();
+    std::memcpy(header_bytes, &header, sizeof(header));
+
+    // 先写临时文件再改名，中断时不会留下不完整的缓存
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(header_bytes, MAT_FILE_HEADER_SIZE);
+        out.write(reinterpret_cast<const char*>(continuous.data), (std::streamsize)header.data_bytes);
+        if (!out) {
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+MappedMatFile::MappedMatFile() : address_(NULL), length_(0) {
+#ifdef _WIN32
+    file_handle_ = NULL;
+    mapping_handle_ = NULL;
+#endif
+}
+
+MappedMatFile::~MappedMatFile() {
+#ifdef _WIN32
+    if (address_) UnmapViewOfFile(address_);
+    if (mapping_handle_) CloseHandle(mapping_handle_);
+    if (file_handle_ && file_handle_ != INVALID_HANDLE_VALUE) CloseHandle(file_handle_);
+#else
+    if (address_) munmap(address_, length_);
+#endif
+}
+
+std::shared_ptr<MappedMatFile> MappedMatFile::open(const std::string& path) {
+    std::shared_ptr<MappedMatFile> file(new MappedMatFile());
+
+    // 以写时复制方式映射：下游代码误写 Mat 时只会修改私有副本，不会破坏缓存文件
+#ifdef _WIN32
+    file->file_handle_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file->file_handle_ == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file->file_handle_, &file_size);
+    file->length_ = (size_t)file_size.QuadPart;
+    file->mapping_handle_ = CreateFileMappingA(file->file_handle_, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (!file->mapping_handle_) {
+        return nullptr;
+    }
+    file->address_ = MapViewOfFile(file->mapping_handle_, FILE_MAP_COPY, 0, 0, 0);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    file->length_ = (size_t)file_stat.st_size;
+    void* address = mmap(NULL, file->length_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    file->address_ = address == MAP_FAILED ? NULL : address;
+#endif
+    if (!file->address_ || file->length_ < MAT_FILE_HEADER_SIZE) {
+        return nullptr;
+    }
+
+    // 文件头可能损坏或文件被截断：尺寸、类型与数据长度必须自洽且不超出映射范围，否则 Mat 会越界读取
+    MatFileHeader header;
+    std::memcpy(&header, file->address_, sizeof(header));
+    bool valid = std::memcmp(header.magic, MAT_FILE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.rows > 0 && header.cols > 0 &&
+        header.type >= 0 && (header.type & ~CV_MAT_TYPE_MASK) == 0 && CV_MAT_DEPTH(header.type) <= CV_16F &&
+        header.data_bytes <= (uint64_t)(file->length_ - MAT_FILE_HEADER_SIZE);
+    if (valid) {
+        // 像素数不超过 data_bytes / 元素大小时乘法不会溢出
+        const uint64_t element_bytes = CV_ELEM_SIZE(header.type);
+        const uint64_t pixels = (uint64_t)header.rows * (uint64_t)header.cols;
+        valid = pixels <= header.data_bytes / element_bytes && pixels * element_bytes == header.data_bytes;
+    }
+    if (!valid) {
+        std::cerr << "错误：缓存文件格式无效: " << path << std::endl;
+        return nullptr;
+    }
+
+    uchar* data = static_cast<uchar*>(file->address_) + MAT_FILE_HEADER_SIZE;
+    file->mat_ = cv::Mat(header.rows, header.cols, header.type, data);
+    return file;
+}
+
+// FNV-1a 64位哈希
+static void hashBytes(uint64_t& hash, const char* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+SceneCache::SceneCache(const std::string& cache_dir) : cache_dir_(cache_dir) {}
+
+std::string SceneCache::makeKey(const std::vector<std::string>& input_paths, const std::string& parameters) const {
+    uint64_t hash = 14695981039346656037ULL;
+    std::vector<char> buffer(1 << 20);
+
+    for (const auto& path : input_paths) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if (!in) {
+            return std::string();
+        }
+        while (in) {
+            in.read(buffer.data(), (std::streamsize)buffer.size());
+            hashBytes(hash, buffer.data(), (size_t)in.gcount());
+        }
+        // 文件之间加分隔，避免内容拼接后碰撞
+        hashBytes(hash, "\0", 1);
+    }
+    hashBytes(hash, parameters.data(), parameters.size());
+
+    return cv::format("%016llx", (unsigned long long)hash);
+}
+
+static const char* const CACHED_FIELD_NAMES[] = { "ndvi_t0", "ndvi_t1", "mask_t1", "data_mask_t0", "velocity_field_mps" };
+
+static cv::Mat* cachedField(CachedSceneFields& fields, int index) {
+    cv::Mat* slots[] = { &fields.ndvi_t0, &fields.ndvi_t1, &fields.mask_t1, &fields.data_mask_t0, &fields.velocity_field_mps };
+    return slots[index];
+}
+
+bool SceneCache::load(const std::string& key, CachedSceneFields& fields) const {
+    if (key.empty()) {
+        return false;
+    }
+    std::string entry_dir = cv::utils::fs::join(cache_dir_, key);
+
+    CachedSceneFields loaded;
+    for (int i = 0; i < 5; ++i) {
+        std::shared_ptr<MappedMatFile> file = MappedMatFile::open(cv::utils::fs::join(entry_dir, std::string(CACHED_FIELD_NAMES[i]) + ".mat"));
+        if (!file) {
+            return false;
+        }
+        *cachedField(loaded, i) = file->mat();
+        loaded.mappings.push_back(file);
+    }
+    fields = loaded;
+    return true;
+}
+
+bool SceneCache::store(const std::string& key, const CachedSceneFields& fields) const {
+    if (key.empty()) {
+        return false;
+    }
+    std::string entry_dir = cv::utils::fs::join(cache_dir_, key);
+    cv::utils::fs::createDirectories(entry_dir);
+
+    CachedSceneFields to_store = fields;
+    for (int i = 0; i < 5; ++i) {
+        std::string path = cv::utils::fs::join(entry_dir, std::string(CACHED_FIELD_NAMES[i]) + ".mat");
+        if (!writeMatFile(path, *cachedField(to_store, i))) {
+            std::cerr << "错误：无法写入缓存文件: " << path << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+// SceneCache.h
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 只读（写时复制）内存映射的 Mat 文件，映射在对象销毁前保持有效
+class MappedMatFile {
+public:
+    ~MappedMatFile();
+    static std::shared_ptr<MappedMatFile> open(const std::string& path);
+    // 直接指向映射内存的 Mat，不拷贝数据
+    const cv::Mat& mat() const { return mat_; }
+
+private:
+    MappedMatFile();
+
+    void* address_;
+    size_t length_;
+#ifdef _WIN32
+    void* file_handle_;
+    void* mapping_handle_;
+#endif
+    cv::Mat mat_;
+};
+
+// 一对场景的计算结果
+// 从缓存加载时各 Mat 直接指向 mappings 中的映射内存，使用期间需保持本结构体存活
+struct CachedSceneFields {
+    cv::Mat ndvi_t0;
+    cv::Mat ndvi_t1;
+    cv::Mat mask_t1;
+    cv::Mat data_mask_t0;
+    cv::Mat velocity_field_mps;
+    std::vector<std::shared_ptr<MappedMatFile>> mappings;
+};
+
+// 以输入文件内容和计算参数的哈希为键的磁盘缓存
+// 每个键对应 cache_dir/<键>/ 下的一组 .mat 文件：64字节文件头 + 按行连续存放的原始数据
+class SceneCache {
+public:
+    explicit SceneCache(const std::string& cache_dir = "cache");
+
+    // 输入文件逐字节参与哈希，任一文件无法读取时返回空字符串
+    std::string makeKey(const std::vector<std::string>& input_paths, const std::string& parameters) const;
+    bool load(const std::string& key, CachedSceneFields& fields) const;
+    bool store(const std::string& key, const CachedSceneFields& fields) const;
+
+private:
+    std::string cache_dir_;
+};
+
+bool writeMatFile(const std::string& path, const cv::Mat& mat);
+
+#endif
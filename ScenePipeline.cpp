@@ -0,0 +1,236 @@
+// ScenePipeline.cpp（多景时间序列流水线）
+#include "ScenePipeline.h"
+#include "BoundedQueue.h"
+#include "ImageProcessor.h"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// 公历日期到 1970-01-01 的天数
+static long long daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    const long long era = (year >= 0 ? year : year - 399) / 400;
+    const int year_of_era = year - (int)(era * 400);
+    const int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+bool parseSceneInfo(const std::string& path, SceneInfo& info) {
+    size_t slash = path.find_last_of("/\\");
+    std::string file_name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    int year, month, day, hour, minute, second;
+    char sensor[32] = {};
+    if (std::sscanf(file_name.c_str(), "%d_%d_%d_%d_%d_%d_%31[^.]", &year, &month, &day, &hour, &minute, &second, sensor) != 7) {
+        return false;
+    }
+
+    info.path = path;
+    info.sensor = sensor;
+    info.timestamp_seconds = daysFromCivil(year, month, day) * 86400.0 + hour * 3600.0 + minute * 60.0 + second;
+    return true;
+}
+
+std::vector<SceneInfo> collectScenes(const std::vector<std::string>& paths) {
+    std::vector<SceneInfo> scenes;
+    for (const auto& path : paths) {
+        SceneInfo info;
+        if (parseSceneInfo(path, info)) {
+            scenes.push_back(info);
+        }
+        else {
+            std::cerr << "错误：无法从文件名解析成像时间，已跳过: " << path << std::endl;
+        }
+    }
+    std::stable_sort(scenes.begin(), scenes.end(),
+        [](const SceneInfo& a, const SceneInfo& b) { return a.timestamp_seconds < b.timestamp_seconds; });
+    return scenes;
+}
+
+namespace {
+
+// 第一级输出：整景全部波段
+struct LoadedScene {
+    SceneInfo info;
+    RasterTile bands;
+    int red_slot;
+    int nir_slot;
+};
+
+// 第二级输出：NDVI 与藻华掩膜
+struct ProcessedScene {
+    SceneInfo info;
+    cv::Mat ndvi;
+    cv::Mat algae_mask;
+    cv::Mat data_mask;
+};
+
+// 离开作用域时合并仍在运行的线程，异常提前退出时也不会析构可合并的 std::thread；
+// 此时先调用 stop（关闭队列）让阻塞中的线程退出
+class ThreadJoiner {
+public:
+    ThreadJoiner(std::vector<std::thread>& threads, std::function<void()> stop) : threads_(threads), stop_(stop) {}
+    ~ThreadJoiner() {
+        for (const auto& thread : threads_) {
+            if (thread.joinable()) {
+                stop_();
+                break;
+            }
+        }
+        joinAll();
+    }
+
+    void joinAll() {
+        for (auto& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+private:
+    std::vector<std::thread>& threads_;
+    std::function<void()> stop_;
+};
+
+}
+
+ScenePipeline::ScenePipeline(const FlowOptions& flow_options, float spatial_resolution_meters, size_t queue_capacity)
+    : flow_options_(flow_options), spatial_resolution_meters_(spatial_resolution_meters), queue_capacity_(queue_capacity) {}
+
+int ScenePipeline::run(const std::vector<SceneInfo>& scenes, const PairCallback& on_pair) {
+    BoundedQueue<LoadedScene> loaded_queue(queue_capacity_);
+    BoundedQueue<ProcessedScene> processed_queue(queue_capacity_);
+
+    // 任一级失败时记下第一个异常并关闭两个队列，其余各级随之退出；全部线程合并后再抛给调用方
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto fail = [&](std::exception_ptr stage_error) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = stage_error;
+            }
+        }
+        loaded_queue.close();
+        processed_queue.close();
+    };
+    std::vector<std::thread> stages;
+    ThreadJoiner joiner(stages, [&] {
+        loaded_queue.close();
+        processed_queue.close();
+    });
+    stages.reserve(2);
+
+    // 第一级：逐景读取全部波段（I/O）
+    stages.emplace_back([&] {
+        try {
+            for (const auto& scene : scenes) {
+                ImageProcessor processor(scene.path);
+                if (!processor.isLoaded() || processor.bandCount() < 2) {
+                    std::cerr << "错误：无法读取场景，已跳过: " << scene.path << std::endl;
+                    continue;
+                }
+                LoadedScene loaded;
+                loaded.info = scene;
+                loaded.bands.region = cv::Rect(cv::Point(0, 0), processor.size());
+                loaded.bands.bands = processor.getBands();
+                loaded.red_slot = processor.redBandIndex();
+                loaded.nir_slot = processor.nirBandIndex();
+                if (loaded.bands.bands.empty()) {
+                    std::cerr << "错误：读取波段失败，已跳过: " << scene.path << std::endl;
+                    continue;
+                }
+                // 队列已因下游失败而关闭
+                if (!loaded_queue.push(std::move(loaded))) {
+                    break;
+                }
+            }
+            loaded_queue.close();
+        }
+        catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    // 第二级：融合内核计算 NDVI 与掩膜，再按整幅 NDVI 分割藻华
+    stages.emplace_back([&] {
+        try {
+            AlgaeSegmenter segmenter(segmentation_options_);
+            LoadedScene loaded;
+            while (loaded_queue.pop(loaded)) {
+                cv::Size scene_size = loaded.bands.region.size();
+                SceneProducts products;
+                products.ndvi.create(scene_size, CV_32F);
+                products.algae_mask.create(scene_size, CV_8U);
+                products.data_mask.create(scene_size, CV_8U);
+                products.colormap.create(scene_size, CV_8UC3);
+                ImageProcessor::processTile(loaded.bands, loaded.red_slot, loaded.nir_slot, products);
+                loaded.bands.bands.clear();
+                segmenter.segment(products.ndvi, products.data_mask, products.algae_mask);
+
+                ProcessedScene processed;
+                processed.info = loaded.info;
+                processed.ndvi = products.ndvi;
+                processed.algae_mask = products.algae_mask;
+                processed.data_mask = products.data_mask;
+                if (!processed_queue.push(std::move(processed))) {
+                    break;
+                }
+            }
+            processed_queue.close();
+        }
+        catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    // 第三级（当前线程）：相邻两景的光流与流速换算，on_pair 抛出的异常同样按失败处理
+    int pair_count = 0;
+    try {
+        AlgaeTracker tracker;
+        ProcessedScene previous, current;
+        bool has_previous = false;
+        while (processed_queue.pop(current)) {
+            if (has_previous && previous.ndvi.size() != current.ndvi.size()) {
+                std::cerr << "错误：相邻场景尺寸不一致，无法计算光流: " << previous.info.path << " -> " << current.info.path << std::endl;
+            }
+            else if (has_previous) {
+                double interval = current.info.timestamp_seconds - previous.info.timestamp_seconds;
+                if (interval <= 0) {
+                    std::cerr << "错误：相邻场景成像时间相同，已跳过: " << current.info.path << std::endl;
+                }
+                else {
+                    cv::Mat raw_flow = tracker.calculateOpticalFlow(previous.ndvi, current.ndvi, current.algae_mask, flow_options_);
+                    cv::Mat filtered_flow = tracker.extendFlowBeyondMask(
+                        tracker.filterFlowByMask(raw_flow, current.algae_mask), current.algae_mask, current.data_mask);
+
+                    PairVelocityField pair;
+                    pair.from = previous.info;
+                    pair.to = current.info;
+                    pair.interval_seconds = interval;
+                    pair.velocity_field_mps = filtered_flow * (spatial_resolution_meters_ / interval);
+                    pair.algae_mask_to = current.algae_mask;
+                    on_pair(pair);
+                    ++pair_count;
+                }
+            }
+            previous = std::move(current);
+            has_previous = true;
+        }
+    }
+    catch (...) {
+        fail(std::current_exception());
+    }
+
+    joiner.joinAll();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return pair_count;
+}
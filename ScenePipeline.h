@@ -0,0 +1,53 @@
+// ScenePipeline.h
+#ifndef SCENE_PIPELINE_H
+#define SCENE_PIPELINE_H
+
+#include "AlgaeSegmenter.h"
+#include "AlgaeTracker.h"
+#include <opencv2/opencv.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 一景影像及其成像时间，由文件名 YYYY_MM_DD_HH_MM_SS_传感器.tif 解析
+struct SceneInfo {
+    std::string path;
+    std::string sensor;
+    double timestamp_seconds;   // 自 1970-01-01 00:00:00 起的秒数（按文件名时间，不做时区换算）
+};
+
+// 相邻两景之间的流速场
+struct PairVelocityField {
+    SceneInfo from;
+    SceneInfo to;
+    double interval_seconds;
+    cv::Mat velocity_field_mps;     // to 时刻藻华掩膜内的流速，掩膜外为延拓值
+    cv::Mat algae_mask_to;
+};
+
+bool parseSceneInfo(const std::string& path, SceneInfo& info);
+// 解析并按成像时间排序，无法解析的文件名会被跳过并报错
+std::vector<SceneInfo> collectScenes(const std::vector<std::string>& paths);
+
+// 多景时间序列流水线：读取 → NDVI → 相邻景光流 三级并行，级间以有界队列连接
+// 第 N+1 景读取、第 N 景 NDVI 与第 (N-1, N) 对光流同时进行，吞吐接近最慢的一级
+class ScenePipeline {
+public:
+    typedef std::function<void(const PairVelocityField&)> PairCallback;
+
+    ScenePipeline(const FlowOptions& flow_options, float spatial_resolution_meters, size_t queue_capacity = 2);
+
+    void setSegmentationOptions(const SegmentationOptions& options) { segmentation_options_ = options; }
+
+    // on_pair 在光流线程中按时间顺序回调；返回成功输出的场景对数量。
+    // 任一级（含 on_pair）抛出异常时关闭各级队列，合并全部线程后把第一个异常重新抛出
+    int run(const std::vector<SceneInfo>& scenes, const PairCallback& on_pair);
+
+private:
+    FlowOptions flow_options_;
+    SegmentationOptions segmentation_options_;
+    float spatial_resolution_meters_;
+    size_t queue_capacity_;
+};
+
+#endif
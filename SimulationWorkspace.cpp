@@ -0,0 +1,56 @@
+// SimulationWorkspace.cpp（推演循环的可复用缓冲区）
+#include "SimulationWorkspace.h"
+#include "Trace.h"
+
+SparseTileMask& SimulationWorkspace::sparseMask(cv::Size size) {
+    if (sparse_mask_.size() != size) {
+        sparse_mask_ = SparseTileMask(size);
+    }
+    return sparse_mask_;
+}
+
+CompactMask& SimulationWorkspace::compactMask(cv::Size size) {
+    compact_mask_.create(size);
+    return compact_mask_;
+}
+
+FrameRenderer& SimulationWorkspace::renderer(const cv::Mat& static_layer, double display_scale) {
+    if (renderer_.sourceSize() != static_layer.size() || renderer_.displayScale() != display_scale) {
+        renderer_ = FrameRenderer(static_layer, display_scale);
+    }
+    return renderer_;
+}
+
+void SimulationWorkspace::captureSignature(StorageSignature& signature) const {
+    signature.clear();
+    signature.push_back(std::make_pair(compact_mask_.storage(), (size_t)0));
+    signature.push_back(std::make_pair((const void*)0, sparse_mask_.storageCapacity()));
+    signature.push_back(std::make_pair((const void*)dense_mask_.data, (size_t)0));
+    signature.push_back(std::make_pair((const void*)renderer_.frame().data, (size_t)0));
+}
+
+void SimulationWorkspace::endStep() {
+    // 两份签名轮换使用，容量固定后比较本身也不分配
+    captureSignature(current_signature_);
+    if (steps_ > 0 && current_signature_ != last_signature_) {
+        ++buffer_reallocations_;
+    }
+    std::swap(last_signature_, current_signature_);
+#ifdef ALGAE_ENABLE_TRACING
+    // 计数在本函数末尾读取，首步（含签名数组的首次分配）不计入
+    const uint64_t allocations = Tracer::threadAllocations();
+    if (steps_ > 0) {
+        steady_state_allocations_ += allocations - last_allocations_;
+    }
+    last_allocations_ = allocations;
+#endif
+    ++steps_;
+}
+
+bool SimulationWorkspace::allocationsCounted() {
+#ifdef ALGAE_ENABLE_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
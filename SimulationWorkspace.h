@@ -0,0 +1,59 @@
+// SimulationWorkspace.h
+#ifndef SIMULATION_WORKSPACE_H
+#define SIMULATION_WORKSPACE_H
+
+#include "CompactMask.h"
+#include "FrameRenderer.h"
+#include "SparseTileMask.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// 逐步推演循环复用的缓冲区：预测掩膜及其稠密副本与增量渲染器
+// 第一步按需分配，之后各步只在原有内存上覆写。每步结束调用 endStep，
+// 若任何缓冲区的地址或容量与上一步结束时不同即计为一次重新分配；
+// 推进时 bufferReallocations() 应保持为0（稀疏掩膜随藻华范围扩大而扩容时除外）。
+// 这里只检查工作区自己持有的缓冲区，推演、打捞与 OpenCV 内部的临时分配不计入；
+// 以 ALGAE_ENABLE_TRACING 编译时另统计首步之后各步在调用线程上的 operator new 总次数
+class SimulationWorkspace {
+public:
+    SimulationWorkspace() : steps_(0), buffer_reallocations_(0), steady_state_allocations_(0), last_allocations_(0) {}
+
+    SimulationWorkspace(const SimulationWorkspace&) = delete;
+    SimulationWorkspace& operator=(const SimulationWorkspace&) = delete;
+
+    // 尺寸不变时返回同一个缓冲区，内容保留上一步的结果
+    SparseTileMask& sparseMask(cv::Size size);
+    CompactMask& compactMask(cv::Size size);
+    // 预测掩膜的稠密副本（供时间序列输出）
+    cv::Mat& denseMask() { return dense_mask_; }
+    // 显示分辨率的增量渲染器：首次或静态图层尺寸、显示比例变化时按 static_layer 重建
+    FrameRenderer& renderer(const cv::Mat& static_layer, double display_scale);
+
+    void endStep();
+    size_t steps() const { return steps_; }
+    size_t bufferReallocations() const { return buffer_reallocations_; }
+    // 首步结束到最后一次 endStep 之间本线程的 operator new 次数，稳态推进应为0；
+    // 未以 ALGAE_ENABLE_TRACING 编译时不统计（allocationsCounted() 为 false，结果恒为0）
+    uint64_t steadyStateAllocations() const { return steady_state_allocations_; }
+    static bool allocationsCounted();
+
+private:
+    typedef std::vector<std::pair<const void*, size_t>> StorageSignature;
+    void captureSignature(StorageSignature& signature) const;
+
+    SparseTileMask sparse_mask_;
+    CompactMask compact_mask_;
+    cv::Mat dense_mask_;
+    FrameRenderer renderer_;
+
+    size_t steps_;
+    size_t buffer_reallocations_;
+    uint64_t steady_state_allocations_;
+    uint64_t last_allocations_;
+    StorageSignature last_signature_;
+    StorageSignature current_signature_;
+};
+
+#endif
@@ -0,0 +1,174 @@
+// SparseTileMask.cpp（稀疏瓦片掩膜）
+#include "SparseTileMask.h"
+#include <algorithm>
+
+std::vector<int> dilateTiles(const std::vector<int>& tiles, int tiles_x, int tiles_y, int halo) {
+    std::vector<uint8_t> marked((size_t)tiles_x * tiles_y, 0);
+    std::vector<int> result;
+    for (int tile : tiles) {
+        int tx = tile % tiles_x;
+        int ty = tile / tiles_x;
+        for (int y = std::max(0, ty - halo); y <= std::min(tiles_y - 1, ty + halo); ++y) {
+            for (int x = std::max(0, tx - halo); x <= std::min(tiles_x - 1, tx + halo); ++x) {
+                int index = y * tiles_x + x;
+                if (!marked[index]) {
+                    marked[index] = 1;
+                    result.push_back(index);
+                }
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+SparseTileMask::SparseTileMask() : rows_(0), cols_(0), tiles_x_(0), tiles_y_(0) {}
+
+SparseTileMask::SparseTileMask(cv::Size size)
+    : rows_(std::max(0, size.height)),
+      cols_(std::max(0, size.width)),
+      tiles_x_((cols_ + TILE_SIZE - 1) / TILE_SIZE),
+      tiles_y_((rows_ + TILE_SIZE - 1) / TILE_SIZE),
+      slot_of_tile_((size_t)tiles_x_ * tiles_y_, -1) {}
+
+SparseTileMask SparseTileMask::fromMat(const cv::Mat& mask) {
+    CV_Assert(mask.empty() || mask.type() == CV_8U);
+    SparseTileMask sparse(mask.size());
+    for (int y = 0; y < sparse.rows_; ++y) {
+        const uchar* row = mask.ptr<uchar>(y);
+        for (int x = 0; x < sparse.cols_; ++x) {
+            if (row[x]) {
+                sparse.set(x, y);
+            }
+        }
+    }
+    return sparse;
+}
+
+SparseTileMask SparseTileMask::fromCompact(const CompactMask& mask) {
+    SparseTileMask sparse(mask.size());
+    mask.forEachSet([&sparse](int x, int y) {
+        sparse.set(x, y);
+    });
+    return sparse;
+}
+
+cv::Mat SparseTileMask::toMat() const {
+    cv::Mat mask;
+    toMat(mask);
+    return mask;
+}
+
+void SparseTileMask::toMat(cv::Mat& mask) const {
+    mask.create(size(), CV_8U);
+    mask.setTo(cv::Scalar(0));
+    forEachSet([&mask](int x, int y) {
+        mask.at<uchar>(y, x) = 255;
+    });
+}
+
+void SparseTileMask::toMat(cv::Mat& mask, const cv::Rect& region) const {
+    mask.create(region.size(), CV_8U);
+    mask.setTo(cv::Scalar(0));
+    for (int tile : active_) {
+        const cv::Rect overlap = tileRect(tile) & region;
+        if (overlap.empty()) continue;
+        const Tile& bits = pool_[slot_of_tile_[tile]];
+        const int x0 = (tile % tiles_x_) * TILE_SIZE;
+        const int y0 = (tile / tiles_x_) * TILE_SIZE;
+        for (int y = overlap.y; y < overlap.y + overlap.height; ++y) {
+            uint64_t word = bits.rows[y - y0];
+            uchar* row = mask.ptr<uchar>(y - region.y);
+            while (word) {
+                const int x = x0 + CompactMask::countTrailingZeros(word);
+                if (x >= overlap.x && x < overlap.x + overlap.width) {
+                    row[x - region.x] = 255;
+                }
+                word &= word - 1;
+            }
+        }
+    }
+}
+
+CompactMask SparseTileMask::toCompact() const {
+    CompactMask compact(size());
+    forEachSet([&compact](int x, int y) {
+        compact.set(x, y);
+    });
+    return compact;
+}
+
+int SparseTileMask::allocateTile(int tile) {
+    int slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else {
+        slot = (int)pool_.size();
+        pool_.push_back(Tile());
+    }
+    std::fill(pool_[slot].rows, pool_[slot].rows + TILE_SIZE, 0);
+    slot_of_tile_[tile] = slot;
+    active_.push_back(tile);
+    return slot;
+}
+
+void SparseTileMask::clear() {
+    for (int tile : active_) {
+        free_slots_.push_back(slot_of_tile_[tile]);
+        slot_of_tile_[tile] = -1;
+    }
+    active_.clear();
+}
+
+size_t SparseTileMask::pruneEmpty() {
+    size_t kept = 0;
+    for (size_t i = 0; i < active_.size(); ++i) {
+        int tile = active_[i];
+        const Tile& bits = pool_[slot_of_tile_[tile]];
+        bool any = false;
+        for (int r = 0; r < TILE_SIZE && !any; ++r) {
+            any = bits.rows[r] != 0;
+        }
+        if (any) {
+            active_[kept++] = tile;
+        }
+        else {
+            free_slots_.push_back(slot_of_tile_[tile]);
+            slot_of_tile_[tile] = -1;
+        }
+    }
+    size_t released = active_.size() - kept;
+    active_.resize(kept);
+    return released;
+}
+
+size_t SparseTileMask::count() const {
+    size_t total = 0;
+    for (int tile : active_) {
+        const Tile& bits = pool_[slot_of_tile_[tile]];
+        for (int r = 0; r < TILE_SIZE; ++r) {
+            total += CompactMask::popCount(bits.rows[r]);
+        }
+    }
+    return total;
+}
+
+std::vector<int> SparseTileMask::haloTiles(int halo) const {
+    return dilateTiles(active_, tiles_x_, tiles_y_, halo);
+}
+
+cv::Rect SparseTileMask::tileRect(int tile) const {
+    int x0 = (tile % tiles_x_) * TILE_SIZE;
+    int y0 = (tile / tiles_x_) * TILE_SIZE;
+    return cv::Rect(x0, y0, std::min((int)TILE_SIZE, cols_ - x0), std::min((int)TILE_SIZE, rows_ - y0));
+}
+
+cv::Rect SparseTileMask::activeBounds() const {
+    cv::Rect bounds;
+    for (int tile : active_) {
+        bounds = bounds.empty() ? tileRect(tile) : (bounds | tileRect(tile));
+    }
+    return bounds;
+}
@@ -0,0 +1,116 @@
+// SparseTileMask.h
+#ifndef SPARSE_TILE_MASK_H
+#define SPARSE_TILE_MASK_H
+
+#include "CompactMask.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+// 把 tiles 中的瓦片（编号 ty * tiles_x + tx）向外扩展 halo 圈，返回升序且去重的瓦片编号
+std::vector<int> dilateTiles(const std::vector<int>& tiles, int tiles_x, int tiles_y, int halo);
+
+// 按固定 64×64 瓦片稀疏存储的二值掩膜
+// 只有含置位像素的瓦片才分配（每块 512 字节，位压缩），活动瓦片列表随 set 增量维护；
+// clear 只把瓦片归还空闲池而不释放内存，逐步推演时每步的开销取决于藻华范围而非湖面大小
+class SparseTileMask {
+public:
+    static const int TILE_SIZE = 64;
+
+    SparseTileMask();
+    explicit SparseTileMask(cv::Size size);
+
+    static SparseTileMask fromMat(const cv::Mat& mask);
+    static SparseTileMask fromCompact(const CompactMask& mask);
+    cv::Mat toMat() const;
+    // 写入 mask，尺寸与类型不变时复用其缓冲区
+    void toMat(cv::Mat& mask) const;
+    // 只栅格化影像中的 region 范围，mask 的尺寸为 region.size()
+    void toMat(cv::Mat& mask, const cv::Rect& region) const;
+    CompactMask toCompact() const;
+
+    cv::Size size() const { return cv::Size(cols_, rows_); }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+    int tilesX() const { return tiles_x_; }
+    int tilesY() const { return tiles_y_; }
+    // 已分配瓦片占用的字节数
+    size_t byteSize() const { return active_.size() * sizeof(Tile); }
+    // 瓦片池与索引数组的总容量，只增不减；变化即表示发生了重新分配
+    size_t storageCapacity() const { return pool_.capacity() + active_.capacity() + free_slots_.capacity() + slot_of_tile_.capacity(); }
+
+    bool test(int x, int y) const {
+        int slot = slot_of_tile_[tileIndex(x, y)];
+        return slot >= 0 && ((pool_[slot].rows[y & (TILE_SIZE - 1)] >> (x & (TILE_SIZE - 1))) & 1u);
+    }
+    void set(int x, int y) {
+        int tile = tileIndex(x, y);
+        int slot = slot_of_tile_[tile];
+        if (slot < 0) {
+            slot = allocateTile(tile);
+        }
+        pool_[slot].rows[y & (TILE_SIZE - 1)] |= uint64_t(1) << (x & (TILE_SIZE - 1));
+    }
+    void reset(int x, int y) {
+        int slot = slot_of_tile_[tileIndex(x, y)];
+        if (slot >= 0) {
+            pool_[slot].rows[y & (TILE_SIZE - 1)] &= ~(uint64_t(1) << (x & (TILE_SIZE - 1)));
+        }
+    }
+    // 归还全部瓦片，分配过的内存留在空闲池中复用
+    void clear();
+    // 归还已经全为0的瓦片，返回归还数量
+    size_t pruneEmpty();
+
+    size_t count() const;
+    // 已分配的瓦片编号（ty * tilesX() + tx），按分配顺序
+    const std::vector<int>& activeTiles() const { return active_; }
+    // 已分配瓦片向外扩展 halo 圈后的瓦片编号（升序）
+    std::vector<int> haloTiles(int halo) const;
+    // 瓦片在影像中的范围（边缘瓦片已裁剪）
+    cv::Rect tileRect(int tile) const;
+    // 全部已分配瓦片的外接范围，没有瓦片时为空
+    cv::Rect activeBounds() const;
+    // 瓦片的 TILE_SIZE 行位数据（第 r 行的第 c 位对应瓦片内 (c, r)），未分配时返回 nullptr
+    const uint64_t* tileRows(int tile) const {
+        const int slot = slot_of_tile_[tile];
+        return slot >= 0 ? pool_[slot].rows : nullptr;
+    }
+
+    // 逐个已分配瓦片、按行对每个置位像素调用 f(x, y)
+    template <typename F>
+    void forEachSet(F&& f) const {
+        for (int tile : active_) {
+            const Tile& bits = pool_[slot_of_tile_[tile]];
+            const int x0 = (tile % tiles_x_) * TILE_SIZE;
+            const int y0 = (tile / tiles_x_) * TILE_SIZE;
+            for (int r = 0; r < TILE_SIZE; ++r) {
+                uint64_t word = bits.rows[r];
+                while (word) {
+                    f(x0 + CompactMask::countTrailingZeros(word), y0 + r);
+                    word &= word - 1;
+                }
+            }
+        }
+    }
+
+private:
+    struct Tile {
+        uint64_t rows[TILE_SIZE];
+    };
+
+    int tileIndex(int x, int y) const { return (y / TILE_SIZE) * tiles_x_ + x / TILE_SIZE; }
+    int allocateTile(int tile);
+
+    int rows_;
+    int cols_;
+    int tiles_x_;
+    int tiles_y_;
+    std::vector<int> slot_of_tile_;     // 每个瓦片在 pool_ 中的位置，未分配为 -1
+    std::vector<Tile> pool_;
+    std::vector<int> free_slots_;
+    std::vector<int> active_;
+};
+
+#endif
@@ -0,0 +1,190 @@
+// SyntheticScene.cpp（合成多波段影像与流场）
+#include "SyntheticScene.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "gdal_priv.h"
+
+// 湖面与藻华的典型反射率（DN值），藻华处 NIR > Red，NDVI 为正
+static const float WATER_RED = 600.0f;
+static const float WATER_NIR = 420.0f;
+static const float ALGAE_RED = 480.0f;
+static const float ALGAE_NIR = 980.0f;
+
+const char* flowPatternName(FlowPattern pattern) {
+    switch (pattern) {
+    case FlowPattern::Uniform: return "uniform";
+    case FlowPattern::Vortex:  return "vortex";
+    case FlowPattern::Shear:   return "shear";
+    }
+    return "unknown";
+}
+
+bool parseFlowPattern(const std::string& name, FlowPattern& pattern) {
+    if (name == "uniform") pattern = FlowPattern::Uniform;
+    else if (name == "vortex") pattern = FlowPattern::Vortex;
+    else if (name == "shear") pattern = FlowPattern::Shear;
+    else return false;
+    return true;
+}
+
+cv::Mat makeSyntheticFlowField(cv::Size size, FlowPattern pattern, float max_speed_mps) {
+    cv::Mat flow(size, CV_32FC2);
+    const float cx = 0.5f * (size.width - 1);
+    const float cy = 0.5f * (size.height - 1);
+    const float radius = 0.5f * std::min(size.width, size.height);
+
+    for (int y = 0; y < size.height; ++y) {
+        cv::Vec2f* row = flow.ptr<cv::Vec2f>(y);
+        for (int x = 0; x < size.width; ++x) {
+            float vx = 0.0f, vy = 0.0f;
+            if (pattern == FlowPattern::Uniform) {
+                vx = max_speed_mps * 0.8f;
+                vy = max_speed_mps * 0.6f;
+            }
+            else if (pattern == FlowPattern::Vortex) {
+                float dx = (x - cx) / radius;
+                float dy = (y - cy) / radius;
+                float r = std::sqrt(dx * dx + dy * dy);
+                float speed = max_speed_mps * std::min(1.0f, r);
+                if (r > 1e-6f) {
+                    vx = -dy / r * speed;
+                    vy = dx / r * speed;
+                }
+            }
+            else {
+                vx = max_speed_mps * (2.0f * y / std::max(1, size.height - 1) - 1.0f);
+                vy = 0.0f;
+            }
+            row[x] = cv::Vec2f(vx, vy);
+        }
+    }
+    return flow;
+}
+
+// 在湖面像素中取第 (1 - coverage) 分位数作为阈值
+static float coverageThreshold(const cv::Mat& field, const cv::Mat& data_mask, double coverage) {
+    std::vector<float> values;
+    values.reserve(cv::countNonZero(data_mask));
+    for (int y = 0; y < field.rows; ++y) {
+        const float* f = field.ptr<float>(y);
+        const uchar* m = data_mask.ptr<uchar>(y);
+        for (int x = 0; x < field.cols; ++x) {
+            if (m[x]) values.push_back(f[x]);
+        }
+    }
+    if (values.empty()) {
+        return 0.0f;
+    }
+    coverage = std::max(0.0, std::min(1.0, coverage));
+    size_t k = std::min(values.size() - 1, (size_t)((1.0 - coverage) * values.size()));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+// 由藻华强度场生成四个波段，湖面外为0（无效数据）
+static std::vector<cv::Mat> synthesizeBands(const cv::Mat& intensity, const cv::Mat& data_mask, float threshold, cv::RNG& rng) {
+    std::vector<cv::Mat> bands(4);
+    for (auto& band : bands) {
+        band = cv::Mat::zeros(intensity.size(), CV_16U);
+    }
+    for (int y = 0; y < intensity.rows; ++y) {
+        const float* f = intensity.ptr<float>(y);
+        const uchar* m = data_mask.ptr<uchar>(y);
+        ushort* blue = bands[0].ptr<ushort>(y);
+        ushort* green = bands[1].ptr<ushort>(y);
+        ushort* red = bands[2].ptr<ushort>(y);
+        ushort* nir = bands[3].ptr<ushort>(y);
+        for (int x = 0; x < intensity.cols; ++x) {
+            if (!m[x]) continue;
+            // 阈值附近平滑过渡，保留纹理供光流匹配
+            float t = std::max(0.0f, std::min(1.0f, (f[x] - threshold) * 8.0f + 0.5f));
+            float noise = (float)rng.gaussian(8.0);
+            red[x] = cv::saturate_cast<ushort>(WATER_RED + (ALGAE_RED - WATER_RED) * t + noise);
+            nir[x] = cv::saturate_cast<ushort>(WATER_NIR + (ALGAE_NIR - WATER_NIR) * t + noise);
+            green[x] = cv::saturate_cast<ushort>(700.0f + 150.0f * t + noise);
+            blue[x] = cv::saturate_cast<ushort>(800.0f - 100.0f * t + noise);
+        }
+    }
+    return bands;
+}
+
+SyntheticScene generateSyntheticScene(const SyntheticSceneSpec& spec) {
+    SyntheticScene scene;
+    const cv::Size size = spec.size;
+    cv::RNG rng(spec.seed);
+
+    scene.data_mask = cv::Mat::zeros(size, CV_8U);
+    cv::ellipse(scene.data_mask, cv::Point(size.width / 2, size.height / 2),
+        cv::Size(size.width * 9 / 20, size.height * 9 / 20), 0, 0, 360, cv::Scalar(255), -1);
+
+    // 平滑噪声：斑块尺度随影像大小缩放
+    cv::Mat noise(size, CV_32F);
+    rng.fill(noise, cv::RNG::UNIFORM, 0.0, 1.0);
+    double sigma = std::max(2.0, std::min(size.width, size.height) / 96.0);
+    cv::Mat intensity;
+    cv::GaussianBlur(noise, intensity, cv::Size(), sigma, sigma);
+    cv::normalize(intensity, intensity, 0.0, 1.0, cv::NORM_MINMAX);
+
+    float threshold = coverageThreshold(intensity, scene.data_mask, spec.algae_coverage);
+    scene.algae_mask_t0 = (intensity > threshold) & scene.data_mask;
+    scene.velocity_field_mps = makeSyntheticFlowField(size, spec.flow, spec.max_speed_mps);
+
+    // t1 = t0 沿流场平移：逆向映射 t1(p) = t0(p - d)，d 为影像坐标下的位移（Y分量还原为行方向）
+    const float pixels_per_second = 1.0f / spec.spatial_resolution_meters;
+    cv::Mat map_x(size, CV_32F), map_y(size, CV_32F);
+    for (int y = 0; y < size.height; ++y) {
+        const cv::Vec2f* v = scene.velocity_field_mps.ptr<cv::Vec2f>(y);
+        float* mx = map_x.ptr<float>(y);
+        float* my = map_y.ptr<float>(y);
+        for (int x = 0; x < size.width; ++x) {
+            mx[x] = x - v[x][0] * spec.interval_seconds * pixels_per_second;
+            my[x] = y + v[x][1] * spec.interval_seconds * pixels_per_second;
+        }
+    }
+    cv::Mat intensity_t1;
+    cv::remap(intensity, intensity_t1, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_REFLECT);
+
+    scene.bands_t0 = synthesizeBands(intensity, scene.data_mask, threshold, rng);
+    scene.bands_t1 = synthesizeBands(intensity_t1, scene.data_mask, threshold, rng);
+    return scene;
+}
+
+bool writeSyntheticGeoTiff(const std::string& path, const std::vector<cv::Mat>& bands, float spatial_resolution_meters) {
+    if (bands.empty() || bands[0].type() != CV_16U) {
+        std::cerr << "错误：合成影像需要 CV_16U 波段。" << std::endl;
+        return false;
+    }
+    GDALAllRegister();
+    GDALDriver* driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+    if (driver == NULL) {
+        std::cerr << "错误：GDAL缺少GTiff驱动。" << std::endl;
+        return false;
+    }
+
+    char** create_options = NULL;
+    create_options = CSLSetNameValue(create_options, "TILED", "YES");
+    create_options = CSLSetNameValue(create_options, "BLOCKXSIZE", "256");
+    create_options = CSLSetNameValue(create_options, "BLOCKYSIZE", "256");
+    GDALDataset* dataset = driver->Create(path.c_str(), bands[0].cols, bands[0].rows, (int)bands.size(), GDT_UInt16, create_options);
+    CSLDestroy(create_options);
+    if (dataset == NULL) {
+        std::cerr << "错误：无法创建合成影像: " << path << " (" << CPLGetLastErrorMsg() << ")" << std::endl;
+        return false;
+    }
+
+    double geo_transform[6] = { 0.0, spatial_resolution_meters, 0.0, 0.0, 0.0, -spatial_resolution_meters };
+    dataset->SetGeoTransform(geo_transform);
+
+    bool ok = true;
+    for (size_t b = 0; b < bands.size() && ok; ++b) {
+        const cv::Mat band = bands[b].isContinuous() ? bands[b] : bands[b].clone();
+        ok = dataset->GetRasterBand((int)b + 1)->RasterIO(GF_Write, 0, 0, band.cols, band.rows,
+            (void*)band.data, band.cols, band.rows, GDT_UInt16, 0, 0) == CE_None;
+    }
+    if (!ok) {
+        std::cerr << "错误：写入合成影像失败: " << path << std::endl;
+    }
+    GDALClose(dataset);
+    return ok;
+}
@@ -0,0 +1,46 @@
+// SyntheticScene.h
+#ifndef SYNTHETIC_SCENE_H
+#define SYNTHETIC_SCENE_H
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 合成流场形态
+enum class FlowPattern {
+    Uniform,    // 全场同向
+    Vortex,     // 绕湖心旋转，外圈快内圈慢
+    Shear       // 沿行方向线性变化的剪切流
+};
+
+const char* flowPatternName(FlowPattern pattern);
+bool parseFlowPattern(const std::string& name, FlowPattern& pattern);
+
+struct SyntheticSceneSpec {
+    cv::Size size = cv::Size(2048, 2048);
+    double algae_coverage = 0.1;            // 藻华像素占湖面像素的比例
+    FlowPattern flow = FlowPattern::Vortex;
+    float max_speed_mps = 0.3f;
+    float spatial_resolution_meters = 50.0f;
+    float interval_seconds = 2141.0f;       // 两景之间的时间间隔，与真实数据一致
+    uint64_t seed = 1;
+};
+
+// 一对合成影像：t1 由 t0 按真实流场平移得到，可用于检验光流精度
+struct SyntheticScene {
+    std::vector<cv::Mat> bands_t0;          // CV_16U，波段顺序 B, G, R, NIR，与真实数据一致
+    std::vector<cv::Mat> bands_t1;
+    cv::Mat data_mask;                      // CV_8U，湖面为255
+    cv::Mat algae_mask_t0;                  // CV_8U
+    cv::Mat velocity_field_mps;             // CV_32FC2，与 calculateOpticalFlow 的输出约定相同（Y分量已取反）
+};
+
+// 湖面为椭圆，藻华为平滑噪声取阈值得到的斑块，阈值按目标覆盖率选取
+SyntheticScene generateSyntheticScene(const SyntheticSceneSpec& spec);
+cv::Mat makeSyntheticFlowField(cv::Size size, FlowPattern pattern, float max_speed_mps);
+
+// 写出分块GeoTIFF（256×256块），path 可以是 /vsimem/ 下的内存文件
+bool writeSyntheticGeoTiff(const std::string& path, const std::vector<cv::Mat>& bands, float spatial_resolution_meters);
+
+#endif
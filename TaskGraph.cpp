@@ -0,0 +1,202 @@
+// TaskGraph.cpp（阶段依赖图）
+#include "TaskGraph.h"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+
+TaskGraph::TaskGraph(size_t num_threads)
+    : pool_(new ThreadPool(num_threads)), outstanding_(0), wall_ms_(0.0) {}
+
+TaskGraph::TaskId TaskGraph::add(const std::string& name, std::function<void()> work,
+    const std::vector<TaskId>& dependencies, TaskAffinity affinity) {
+    TaskId id = (TaskId)tasks_.size();
+    Task task;
+    task.name = name;
+    task.work = std::move(work);
+    task.affinity = affinity;
+    task.remaining = 0;
+    task.failed = false;
+    task.done = false;
+    for (TaskId dependency : dependencies) {
+        // 依赖只能指向已登记的阶段，图因此天然无环
+        if (dependency < 0 || dependency >= id) {
+            std::cerr << "错误：阶段 " << name << " 的依赖编号无效: " << dependency << std::endl;
+            continue;
+        }
+        task.dependencies.push_back(dependency);
+        tasks_[dependency].successors.push_back(id);
+        if (!tasks_[dependency].done) {
+            ++task.remaining;
+        }
+        else if (tasks_[dependency].failed) {
+            task.failed = true;
+        }
+    }
+    tasks_.push_back(std::move(task));
+    timings_.push_back(StageTiming{ name, 0.0, 0.0, -1, false });
+    return id;
+}
+
+bool TaskGraph::run() {
+    origin_ = std::chrono::steady_clock::now();
+    std::vector<TaskId> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        errors_.clear();
+        outstanding_ = 0;
+        for (size_t i = 0; i < tasks_.size(); ++i) {
+            if (tasks_[i].done) continue;
+            ++outstanding_;
+            if (tasks_[i].remaining == 0) {
+                ready.push_back((TaskId)i);
+            }
+        }
+    }
+    for (TaskId id : ready) {
+        schedule(id);
+    }
+
+    // 调用线程在等待期间执行绑定到它的阶段
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        progress_.wait(lock, [this] { return outstanding_ == 0 || !caller_queue_.empty(); });
+        if (caller_queue_.empty()) {
+            break;
+        }
+        TaskId id = caller_queue_.front();
+        caller_queue_.pop_front();
+        lock.unlock();
+        execute(id);
+        lock.lock();
+    }
+    wall_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin_).count();
+
+    for (const std::string& error : errors_) {
+        std::cerr << "错误：阶段失败 " << error << std::endl;
+    }
+    return errors_.empty();
+}
+
+void TaskGraph::schedule(TaskId id) {
+    if (tasks_[id].affinity == TaskAffinity::Caller) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        caller_queue_.push_back(id);
+        progress_.notify_all();
+        return;
+    }
+    pool_->post([this, id] { execute(id); });
+}
+
+void TaskGraph::execute(TaskId id) {
+    Task& task = tasks_[id];
+    const bool skipped = task.failed;
+    bool failed = skipped;
+    auto now_ms = [this] {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin_).count();
+    };
+
+    StageTiming& timing = timings_[id];
+    timing.start_ms = now_ms();
+    timing.worker = pool_->currentWorker();
+    if (!skipped) {
+        std::string error;
+        try {
+            task.work();
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+            failed = true;
+        }
+        catch (...) {
+            error = "未知异常";
+            failed = true;
+        }
+        if (failed) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            errors_.push_back(task.name + ": " + error);
+        }
+    }
+    timing.end_ms = now_ms();
+    timing.executed = !skipped;
+    finish(id, failed);
+}
+
+void TaskGraph::finish(TaskId id, bool failed) {
+    std::vector<TaskId> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Task& task = tasks_[id];
+        task.done = true;
+        task.failed = failed;
+        for (TaskId successor : task.successors) {
+            Task& next = tasks_[successor];
+            if (failed) {
+                next.failed = true;
+            }
+            if (--next.remaining == 0) {
+                ready.push_back(successor);
+            }
+        }
+    }
+    for (TaskId successor : ready) {
+        schedule(successor);
+    }
+    // 在锁内通知：run() 可能随即返回并析构本对象
+    std::lock_guard<std::mutex> lock(mutex_);
+    --outstanding_;
+    progress_.notify_all();
+}
+
+double TaskGraph::criticalPathMs() const {
+    double longest = 0.0;
+    std::vector<double> path(tasks_.size(), 0.0);
+    for (size_t i = 0; i < tasks_.size(); ++i) {
+        double before = 0.0;
+        for (TaskId dependency : tasks_[i].dependencies) {
+            before = std::max(before, path[dependency]);
+        }
+        path[i] = before + (timings_[i].end_ms - timings_[i].start_ms);
+        longest = std::max(longest, path[i]);
+    }
+    return longest;
+}
+
+void TaskGraph::printReport(std::ostream& out) const {
+    // 逐阶段回溯最长依赖链
+    std::vector<double> path(tasks_.size(), 0.0);
+    std::vector<int> previous(tasks_.size(), -1);
+    int last = -1;
+    double total_ms = 0.0;
+    for (size_t i = 0; i < tasks_.size(); ++i) {
+        for (TaskId dependency : tasks_[i].dependencies) {
+            if (path[dependency] > path[i]) {
+                path[i] = path[dependency];
+                previous[i] = dependency;
+            }
+        }
+        double duration = timings_[i].end_ms - timings_[i].start_ms;
+        path[i] += duration;
+        total_ms += duration;
+        if (last < 0 || path[i] > path[last]) {
+            last = (int)i;
+        }
+    }
+
+    out << "\n--- 阶段耗时 (工作线程 " << pool_->size() << " 个) ---" << std::endl;
+    char line[160];
+    for (const StageTiming& timing : timings_) {
+        std::snprintf(line, sizeof(line), "  %-24s %9.1f ms -> %9.1f ms  耗时 %9.1f ms  %s",
+            timing.name.c_str(), timing.start_ms, timing.end_ms, timing.end_ms - timing.start_ms,
+            !timing.executed ? "(跳过)" : timing.worker < 0 ? "主线程" : ("线程 #" + std::to_string(timing.worker)).c_str());
+        out << line << std::endl;
+    }
+
+    std::string chain;
+    for (int i = last; i >= 0; i = previous[i]) {
+        chain = tasks_[i].name + (chain.empty() ? "" : " -> ") + chain;
+    }
+    std::snprintf(line, sizeof(line), "总耗时 %.1f ms，各阶段耗时之和 %.1f ms (并行度 %.2f)，关键路径 %.1f ms: ",
+        wall_ms_, total_ms, total_ms / std::max(wall_ms_, 1e-3), last >= 0 ? path[last] : 0.0);
+    out << line << chain << std::endl;
+}
@@ -0,0 +1,84 @@
+// TaskGraph.h
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include "ThreadPool.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 任务在哪个线程上执行
+enum class TaskAffinity {
+    Pool,       // 线程池中的任意工作线程
+    Caller      // 调用 run() 的线程（交互窗口等只能在主线程操作的阶段）
+};
+
+// 有向无环任务图：各阶段登记名称、工作函数与依赖，run() 时依赖全部完成的阶段立即提交到
+// 工作窃取线程池，互不依赖的阶段并行执行，端到端耗时由关键路径决定。每个阶段的起止时间与所在线程都会记录
+class TaskGraph {
+public:
+    typedef int TaskId;
+
+    struct StageTiming {
+        std::string name;
+        double start_ms;            // 相对 run() 开始
+        double end_ms;
+        int worker;                 // 工作线程编号，调用线程为 -1
+        bool executed;              // 前置阶段失败而跳过时为 false
+    };
+
+    explicit TaskGraph(size_t num_threads = 0);
+
+    // dependencies 中的编号必须是先前 add 返回的值
+    TaskId add(const std::string& name, std::function<void()> work,
+        const std::vector<TaskId>& dependencies = std::vector<TaskId>(),
+        TaskAffinity affinity = TaskAffinity::Pool);
+
+    // 执行全部已登记的阶段并等待结束。阶段抛出异常时其后继不再执行，返回 false 并输出错误；
+    // run() 之后可以继续 add 新阶段再次 run()，已执行的阶段不会重复执行；run() 期间不能 add
+    bool run();
+
+    const std::vector<StageTiming>& timings() const { return timings_; }
+    // 按实测耗时计算的最长依赖链（毫秒）
+    double criticalPathMs() const;
+    double wallMs() const { return wall_ms_; }
+    // 各阶段耗时、并行度与关键路径
+    void printReport(std::ostream& out) const;
+
+private:
+    struct Task {
+        std::string name;
+        std::function<void()> work;
+        std::vector<TaskId> dependencies;
+        std::vector<TaskId> successors;
+        TaskAffinity affinity;
+        int remaining;              // 尚未完成的依赖数
+        bool failed;                // 本阶段或其前置阶段失败
+        bool done;
+    };
+
+    void schedule(TaskId id);
+    void execute(TaskId id);
+    void finish(TaskId id, bool failed);
+
+    std::vector<Task> tasks_;
+    std::vector<StageTiming> timings_;
+    std::unique_ptr<ThreadPool> pool_;
+
+    std::mutex mutex_;
+    std::condition_variable progress_;
+    std::deque<TaskId> caller_queue_;   // 待调用线程执行的阶段
+    size_t outstanding_;
+    std::vector<std::string> errors_;
+    std::chrono::steady_clock::time_point origin_;
+    double wall_ms_;
+};
+
+#endif
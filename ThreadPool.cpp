@@ -0,0 +1,94 @@
+// ThreadPool.cpp（工作窃取线程池）
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+
+thread_local const ThreadPool* t_current_pool = nullptr;
+thread_local int t_worker_index = -1;
+
+}
+
+ThreadPool::ThreadPool(size_t num_threads) : pending_(0), next_queue_(0), stopping_(false) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < num_threads; ++i) {
+        queues_.emplace_back(new WorkerQueue());
+    }
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+int ThreadPool::currentWorker() const {
+    return t_current_pool == this ? t_worker_index : -1;
+}
+
+void ThreadPool::post(std::function<void()> task) {
+    int current = currentWorker();
+    size_t index = current >= 0 ? (size_t)current : next_queue_.fetch_add(1) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        ++pending_;
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::popLocal(size_t index, std::function<void()>& task) {
+    WorkerQueue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, std::function<void()>& task) {
+    for (size_t k = 1; k < queues_.size(); ++k) {
+        WorkerQueue& victim = *queues_[(thief + k) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    t_current_pool = this;
+    t_worker_index = (int)index;
+    for (;;) {
+        std::function<void()> task;
+        if (popLocal(index, task) || steal(index, task)) {
+            --pending_;
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stopping_ || pending_.load() > 0; });
+        // 退出前先把已提交的任务执行完
+        if (stopping_ && pending_.load() <= 0) {
+            return;
+        }
+    }
+}
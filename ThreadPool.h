@@ -0,0 +1,61 @@
+// ThreadPool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池：每个工作线程有自己的双端队列，从队尾取自己的任务，空闲时从其他线程的队首窃取
+// 工作线程内提交的任务放入本线程队列（后继任务通常使用刚产生的数据，留在同一线程缓存更热），
+// 外部提交的任务轮流分配到各队列。submit 返回 std::future 以获取结果或异常，post 不关心结果
+class ThreadPool {
+public:
+    // num_threads 为0时使用硬件并发数
+    explicit ThreadPool(size_t num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F>
+    auto submit(F&& task) -> std::future<decltype(task())> {
+        typedef decltype(task()) Result;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        post([packaged] { (*packaged)(); });
+        return result;
+    }
+    void post(std::function<void()> task);
+
+    size_t size() const { return workers_.size(); }
+    // 当前线程在本线程池中的编号，不是本池的工作线程时返回 -1
+    int currentWorker() const;
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool popLocal(size_t index, std::function<void()>& task);
+    bool steal(size_t thief, std::function<void()>& task);
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<long> pending_;         // 已提交未取走的任务数（取走先于计数时可能短暂为负）
+    std::atomic<size_t> next_queue_;
+    bool stopping_;
+};
+
+#endif
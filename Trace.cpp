@@ -0,0 +1,207 @@
+// Trace.cpp（阶段跟踪与 Chrome trace 导出）
+#include "Trace.h"
+
+#ifdef ALGAE_ENABLE_TRACING
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+
+// 每线程的分配计数，平凡类型的 thread_local 可以在 operator new 中安全使用。
+// cv::Mat 的像素缓冲区经 cv::fastMalloc 分配，不计入
+static thread_local uint64_t t_allocations = 0;
+static thread_local uint64_t t_allocated_bytes = 0;
+
+void* operator new(std::size_t size) {
+    ++t_allocations;
+    t_allocated_bytes += size;
+    void* p = std::malloc(size ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+uint64_t Tracer::threadAllocations() {
+    return t_allocations;
+}
+
+uint64_t Tracer::threadAllocatedBytes() {
+    return t_allocated_bytes;
+}
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer() : enabled_(false), origin_(std::chrono::steady_clock::now()) {}
+
+void Tracer::start() {
+    origin_ = std::chrono::steady_clock::now();
+    enabled_.store(true);
+}
+
+void Tracer::stop() {
+    enabled_.store(false);
+}
+
+int64_t Tracer::nowMicroseconds() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin_).count();
+}
+
+Tracer::ThreadBuffer& Tracer::threadBuffer() {
+    // 缓冲区归 Tracer 所有，线程退出后记录仍然保留
+    static thread_local ThreadBuffer* buffer = NULL;
+    if (buffer == NULL) {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.emplace_back(new ThreadBuffer());
+        buffer = buffers_.back().get();
+        buffer->thread_index = (int)buffers_.size();
+    }
+    return *buffer;
+}
+
+void Tracer::record(ThreadBuffer& buffer, const TraceEvent& event) {
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events.push_back(event);
+}
+
+void Tracer::counter(const char* name, double value) {
+    if (!enabled()) return;
+    TraceEvent event = {};
+    event.name = name;
+    event.phase = 'C';
+    event.start_us = nowMicroseconds();
+    event.num_args = 1;
+    event.args[0].key = "value";
+    event.args[0].value = value;
+    record(threadBuffer(), event);
+}
+
+void Tracer::annotate(const char* key, double value) {
+    if (!enabled()) return;
+    ThreadBuffer& buffer = threadBuffer();
+    if (!buffer.open_scopes.empty()) {
+        buffer.open_scopes.back()->annotate(key, value);
+    }
+}
+
+TraceScope::TraceScope(const char* name) : buffer_(NULL) {
+    Tracer& tracer = Tracer::instance();
+    if (!tracer.enabled()) return;
+    buffer_ = &tracer.threadBuffer();
+    buffer_->open_scopes.push_back(this);
+    event_ = TraceEvent();
+    event_.name = name;
+    event_.phase = 'X';
+    event_.allocations = t_allocations;
+    event_.allocated_bytes = t_allocated_bytes;
+    event_.start_us = tracer.nowMicroseconds();
+}
+
+TraceScope::~TraceScope() {
+    if (buffer_ == NULL) return;
+    Tracer& tracer = Tracer::instance();
+    event_.duration_us = tracer.nowMicroseconds() - event_.start_us;
+    event_.allocations = t_allocations - event_.allocations;
+    event_.allocated_bytes = t_allocated_bytes - event_.allocated_bytes;
+    buffer_->open_scopes.pop_back();
+    tracer.record(*buffer_, event_);
+}
+
+void TraceScope::annotate(const char* key, double value) {
+    if (buffer_ == NULL) return;
+    for (int i = 0; i < event_.num_args; ++i) {
+        if (event_.args[i].key == key) {
+            event_.args[i].value += value;
+            return;
+        }
+    }
+    if (event_.num_args < 4) {
+        event_.args[event_.num_args].key = key;
+        event_.args[event_.num_args].value = value;
+        ++event_.num_args;
+    }
+}
+
+bool Tracer::writeChromeTrace(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "错误：无法写入跟踪文件: " << path << std::endl;
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (const auto& buffer : buffers_) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->thread_index
+            << ", \"args\": {\"name\": \"" << (buffer->thread_index == 1 ? "main" : "worker") << " " << buffer->thread_index << "\"}}";
+        first = false;
+        for (const TraceEvent& event : buffer->events) {
+            out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"algae\", \"ph\": \"" << event.phase
+                << "\", \"pid\": 1, \"tid\": " << buffer->thread_index << ", \"ts\": " << event.start_us;
+            if (event.phase == 'X') {
+                out << ", \"dur\": " << event.duration_us;
+            }
+            out << ", \"args\": {";
+            for (int i = 0; i < event.num_args; ++i) {
+                out << (i ? ", " : "") << "\"" << event.args[i].key << "\": " << event.args[i].value;
+            }
+            if (event.phase == 'X') {
+                out << (event.num_args ? ", " : "") << "\"allocations\": " << event.allocations
+                    << ", \"allocated_bytes\": " << event.allocated_bytes;
+            }
+            out << "}}";
+        }
+    }
+    out << "\n]}\n";
+    return (bool)out;
+}
+
+void Tracer::printSummary() const {
+    struct Summary {
+        int count = 0;
+        int64_t total_us = 0;
+        int64_t max_us = 0;
+        uint64_t allocations = 0;
+    };
+    // 嵌套的同名作用域会被重复累计，汇总只作粗略参考
+    std::map<std::string, Summary> summaries;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            for (const TraceEvent& event : buffer->events) {
+                if (event.phase != 'X') continue;
+                Summary& summary = summaries[event.name];
+                ++summary.count;
+                summary.total_us += event.duration_us;
+                summary.max_us = std::max(summary.max_us, event.duration_us);
+                summary.allocations += event.allocations;
+            }
+        }
+    }
+
+    std::cout << "\n--- 阶段耗时汇总 (所有线程累计) ---" << std::endl;
+    for (const auto& entry : summaries) {
+        const Summary& s = entry.second;
+        std::cout << "  " << entry.first << ": " << s.count << " 次, 总计 " << s.total_us / 1000.0 << " ms, 最长 "
+            << s.max_us / 1000.0 << " ms, 分配 " << s.allocations << " 次" << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,111 @@
+// Trace.h
+#ifndef TRACE_H
+#define TRACE_H
+
+// 阶段跟踪：作用域计时、计数器与每线程内存分配统计，可导出为 Chrome trace-event JSON
+// （chrome://tracing 或 Perfetto 打开）。
+// 只有定义了 ALGAE_ENABLE_TRACING 才会编译进来，否则下面的宏全部展开为空语句；
+// 编译进来后默认仍关闭，需调用 Tracer::instance().start() 开始记录。
+
+#ifdef ALGAE_ENABLE_TRACING
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceArg {
+    const char* key;
+    double value;
+};
+
+struct TraceEvent {
+    const char* name;
+    char phase;                     // 'X' 完整事件，'C' 计数器
+    int64_t start_us;
+    int64_t duration_us;
+    uint64_t allocations;           // 作用域内本线程 operator new 的次数与字节数
+    uint64_t allocated_bytes;
+    int num_args;
+    TraceArg args[4];
+};
+
+class TraceScope;
+
+class Tracer {
+public:
+    static Tracer& instance();
+
+    void start();
+    void stop();
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // 计数器事件（如读取字节数、粒子数随时间的变化）
+    void counter(const char* name, double value);
+    // 为本线程最内层的作用域附加一个数值参数，最多4个
+    void annotate(const char* key, double value);
+
+    // 导出前应确保工作线程已结束本轮记录
+    bool writeChromeTrace(const std::string& path) const;
+    // 按事件名汇总总耗时、次数与分配量，输出到标准输出
+    void printSummary() const;
+
+    int64_t nowMicroseconds() const;
+
+    // 本线程自启动以来 operator new 的累计次数与字节数
+    static uint64_t threadAllocations();
+    static uint64_t threadAllocatedBytes();
+
+private:
+    friend class TraceScope;
+
+    struct ThreadBuffer {
+        int thread_index;
+        std::mutex mutex;
+        std::vector<TraceEvent> events;
+        std::vector<TraceScope*> open_scopes;
+    };
+
+    Tracer();
+    ThreadBuffer& threadBuffer();
+    void record(ThreadBuffer& buffer, const TraceEvent& event);
+
+    std::atomic<bool> enabled_;
+    std::chrono::steady_clock::time_point origin_;
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    void annotate(const char* key, double value);
+
+private:
+    Tracer::ThreadBuffer* buffer_;  // 未启用时为空
+    TraceEvent event_;
+};
+
+#define ALGAE_TRACE_CONCAT_INNER(a, b) a##b
+#define ALGAE_TRACE_CONCAT(a, b) ALGAE_TRACE_CONCAT_INNER(a, b)
+#define ALGAE_TRACE_SCOPE(name) TraceScope ALGAE_TRACE_CONCAT(algae_trace_scope_, __LINE__)(name)
+#define ALGAE_TRACE_ANNOTATE(key, value) Tracer::instance().annotate(key, (double)(value))
+#define ALGAE_TRACE_COUNTER(name, value) Tracer::instance().counter(name, (double)(value))
+
+#else
+
+#define ALGAE_TRACE_SCOPE(name) ((void)0)
+#define ALGAE_TRACE_ANNOTATE(key, value) ((void)0)
+#define ALGAE_TRACE_COUNTER(name, value) ((void)0)
+
+#endif
+
+#endif
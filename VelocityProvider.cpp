@@ -0,0 +1,243 @@
+// VelocityProvider.cpp（随时间变化的流速场与关键帧插值）
+#include "VelocityProvider.h"
+#include <opencv2/core/utils/filesystem.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+cv::Vec2f sampleBilinear(const cv::Mat& field, float x, float y) {
+    const int cols = field.cols;
+    const int rows = field.rows;
+
+    x = std::max(0.0f, std::min((float)(cols - 1), x));
+    y = std::max(0.0f, std::min((float)(rows - 1), y));
+
+    int x0 = (int)x;
+    int y0 = (int)y;
+    int x1 = std::min(x0 + 1, cols - 1);
+    int y1 = std::min(y0 + 1, rows - 1);
+    float fx = x - x0;
+    float fy = y - y0;
+
+    const cv::Vec2f* row0 = field.ptr<cv::Vec2f>(y0);
+    const cv::Vec2f* row1 = field.ptr<cv::Vec2f>(y1);
+
+    cv::Vec2f top = row0[x0] * (1.0f - fx) + row0[x1] * fx;
+    cv::Vec2f bottom = row1[x0] * (1.0f - fx) + row1[x1] * fx;
+    return top * (1.0f - fy) + bottom * fy;
+}
+
+float maxFieldSpeed(const cv::Mat& field) {
+    float max_speed_sq = 0.0f;
+    for (int y = 0; y < field.rows; ++y) {
+        const cv::Vec2f* row = field.ptr<cv::Vec2f>(y);
+        for (int x = 0; x < field.cols; ++x) {
+            max_speed_sq = std::max(max_speed_sq, row[x][0] * row[x][0] + row[x][1] * row[x][1]);
+        }
+    }
+    return std::sqrt(max_speed_sq);
+}
+
+}
+
+SteadyVelocityProvider::SteadyVelocityProvider(const cv::Mat& velocity_field_mps)
+    : velocity_field_mps_(velocity_field_mps), max_speed_(0.0f) {
+    CV_Assert(velocity_field_mps.type() == CV_32FC2);
+    max_speed_ = maxFieldSpeed(velocity_field_mps);
+}
+
+cv::Vec2f SteadyVelocityProvider::sample(float x, float y, double) const {
+    return sampleBilinear(velocity_field_mps_, x, y);
+}
+
+VelocityFieldSeries::VelocityFieldSeries(const std::vector<VelocityKeyframe>& keyframes, TemporalInterpolation interpolation)
+    : interpolation_(interpolation), max_speed_(0.0f) {
+    std::vector<VelocityKeyframe> sorted = keyframes;
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [](const VelocityKeyframe& a, const VelocityKeyframe& b) { return a.seconds < b.seconds; });
+    // 同一时刻只保留第一幅，避免插值区间长度为0
+    for (const auto& keyframe : sorted) {
+        if (keyframes_.empty() || keyframe.seconds > keyframes_.back().seconds) {
+            keyframes_.push_back(keyframe);
+        }
+    }
+    resident_.resize(keyframes_.size());
+    keyframe_max_speed_.assign(keyframes_.size(), -1.0f);
+    unreadable_.assign(keyframes_.size(), false);
+    source_.assign(keyframes_.size(), -1);
+
+    // 尺寸取自第一幅流场，映射保留到第一次 prepare
+    if (!keyframes_.empty()) {
+        resident_[0] = MappedMatFile::open(keyframes_[0].path);
+        if (resident_[0] && resident_[0]->mat().type() == CV_32FC2) {
+            size_ = resident_[0]->mat().size();
+            source_[0] = 0;
+            keyframe_max_speed_[0] = maxFieldSpeed(resident_[0]->mat());
+        }
+        else {
+            std::cerr << "错误：无法读取流速场: " << keyframes_[0].path << std::endl;
+            resident_[0].reset();
+            unreadable_[0] = true;
+        }
+    }
+}
+
+std::shared_ptr<VelocityFieldSeries> VelocityFieldSeries::fromDirectory(const std::string& directory, double origin_seconds,
+    TemporalInterpolation interpolation) {
+    std::vector<std::string> paths;
+    cv::glob(cv::utils::fs::join(directory, "velocity_*.mat"), paths, false);
+
+    std::vector<VelocityKeyframe> keyframes;
+    for (const auto& path : paths) {
+        size_t slash = path.find_last_of("/\\");
+        std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        double from_seconds = 0.0, to_seconds = 0.0;
+        if (std::sscanf(name.c_str(), "velocity_%lf_%lf.mat", &from_seconds, &to_seconds) != 2 || to_seconds <= from_seconds) {
+            continue;
+        }
+        // 场景对的光流是区间内的平均流速，代表区间中点时刻
+        keyframes.push_back(VelocityKeyframe{ 0.5 * (from_seconds + to_seconds) - origin_seconds, path });
+    }
+    if (keyframes.empty()) {
+        std::cerr << "错误：目录中没有 velocity_<起始秒>_<结束秒>.mat 流速场: " << directory << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<VelocityFieldSeries> series(new VelocityFieldSeries(keyframes, interpolation));
+    if (series->size().area() == 0) {
+        return nullptr;
+    }
+    return series;
+}
+
+int VelocityFieldSeries::intervalIndex(double seconds) const {
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), seconds,
+        [](double value, const VelocityKeyframe& keyframe) { return value < keyframe.seconds; });
+    return (int)(it - keyframes_.begin()) - 1;
+}
+
+void VelocityFieldSeries::prepare(double begin_seconds, double end_seconds) {
+    if (keyframes_.empty()) {
+        return;
+    }
+    const int last = (int)keyframes_.size() - 1;
+    const int margin = interpolation_ == TemporalInterpolation::CubicSpline ? 1 : 0;
+    int first_needed = intervalIndex(std::min(begin_seconds, end_seconds)) - margin;
+    int last_needed = intervalIndex(std::max(begin_seconds, end_seconds)) + 1 + margin;
+    first_needed = std::max(0, std::min(last, first_needed));
+    last_needed = std::max(0, std::min(last, last_needed));
+
+    for (int k = 0; k <= last; ++k) {
+        source_[k] = -1;
+        if (k < first_needed || k > last_needed) {
+            resident_[k].reset();
+        }
+    }
+
+    // 窗口内无法读取的关键帧改用时间上最近的可读关键帧（可能在窗口外，映射保留到下次 prepare）
+    for (int k = first_needed; k <= last_needed; ++k) {
+        if (mapKeyframe(k)) {
+            source_[k] = k;
+            continue;
+        }
+        source_[k] = -2;
+        for (int distance = 1; distance <= last && source_[k] == -2; ++distance) {
+            int candidates[2] = { k - distance, k + distance };
+            if (candidates[1] <= last && candidates[0] >= 0 &&
+                keyframes_[candidates[1]].seconds - keyframes_[k].seconds < keyframes_[k].seconds - keyframes_[candidates[0]].seconds) {
+                std::swap(candidates[0], candidates[1]);
+            }
+            for (int candidate : candidates) {
+                if (candidate >= 0 && candidate <= last && mapKeyframe(candidate)) {
+                    source_[k] = candidate;
+                    break;
+                }
+            }
+        }
+        if (source_[k] == -2 && zero_field_.empty()) {
+            std::cerr << "错误：没有可读取的流速场关键帧，流速按0处理。" << std::endl;
+            zero_field_ = cv::Mat::zeros(size_, CV_32FC2);
+        }
+    }
+
+    float max_speed = 0.0f;
+    for (int k = 0; k <= last; ++k) {
+        if (resident_[k]) {
+            max_speed = std::max(max_speed, keyframe_max_speed_[k]);
+        }
+    }
+    // Catmull-Rom 基函数绝对值之和最大为 1.25，插值结果可能略超过关键帧本身的最大值
+    max_speed_ = interpolation_ == TemporalInterpolation::CubicSpline ? 1.25f * max_speed : max_speed;
+}
+
+bool VelocityFieldSeries::mapKeyframe(int index) {
+    if (resident_[index]) {
+        return true;
+    }
+    if (unreadable_[index]) {
+        return false;
+    }
+    resident_[index] = MappedMatFile::open(keyframes_[index].path);
+    if (!resident_[index] || resident_[index]->mat().type() != CV_32FC2 || resident_[index]->mat().size() != size_) {
+        std::cerr << "错误：流速场无法读取或尺寸不一致，改用时间上最近的关键帧: " << keyframes_[index].path << std::endl;
+        resident_[index].reset();
+        unreadable_[index] = true;
+        return false;
+    }
+    if (keyframe_max_speed_[index] < 0.0f) {
+        keyframe_max_speed_[index] = maxFieldSpeed(resident_[index]->mat());
+    }
+    return true;
+}
+
+const cv::Mat& VelocityFieldSeries::field(int index) const {
+    const int source = source_[index];
+    CV_Assert(source != -1 && "采样时刻不在 prepare 的时间窗口内");
+    return source >= 0 ? resident_[source]->mat() : zero_field_;
+}
+
+cv::Vec2f VelocityFieldSeries::sample(float x, float y, double seconds) const {
+    const int last = (int)keyframes_.size() - 1;
+    const int i = intervalIndex(seconds);
+    if (i < 0) {
+        return sampleBilinear(field(0), x, y);
+    }
+    if (i >= last) {
+        return sampleBilinear(field(last), x, y);
+    }
+
+    const double t0 = keyframes_[i].seconds;
+    const double t1 = keyframes_[i + 1].seconds;
+    const float u = (float)((seconds - t0) / (t1 - t0));
+    const cv::Vec2f p0 = sampleBilinear(field(i), x, y);
+    const cv::Vec2f p1 = sampleBilinear(field(i + 1), x, y);
+    if (interpolation_ == TemporalInterpolation::Linear) {
+        return p0 * (1.0f - u) + p1 * u;
+    }
+
+    // 非均匀间隔的 Catmull-Rom：切线取相邻关键帧的中心差分，端点退化为单侧差分
+    const float span = (float)(t1 - t0);
+    cv::Vec2f m0 = (p1 - p0) * (1.0f / span);
+    cv::Vec2f m1 = m0;
+    if (i > 0) {
+        m0 = (p1 - sampleBilinear(field(i - 1), x, y)) * (float)(1.0 / (t1 - keyframes_[i - 1].seconds));
+    }
+    if (i + 2 <= last) {
+        m1 = (sampleBilinear(field(i + 2), x, y) - p0) * (float)(1.0 / (keyframes_[i + 2].seconds - t0));
+    }
+    const float u2 = u * u;
+    const float u3 = u2 * u;
+    return p0 * (2.0f * u3 - 3.0f * u2 + 1.0f) + m0 * (span * (u3 - 2.0f * u2 + u))
+        + p1 * (-2.0f * u3 + 3.0f * u2) + m1 * (span * (u3 - u2));
+}
+
+size_t VelocityFieldSeries::residentCount() const {
+    size_t count = 0;
+    for (const auto& file : resident_) {
+        if (file) ++count;
+    }
+    return count;
+}
@@ -0,0 +1,95 @@
+// VelocityProvider.h
+#ifndef VELOCITY_PROVIDER_H
+#define VELOCITY_PROVIDER_H
+
+#include "SceneCache.h"
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 相邻关键帧之间的时间插值方式
+enum class TemporalInterpolation {
+    Linear,
+    CubicSpline     // Catmull-Rom 三次样条，经过各关键帧且一阶导数连续
+};
+
+// 随时间变化的表面流速场（米/秒）
+// 只在请求的位置与时刻求值：先以 prepare 声明接下来要采样的时间窗口（可能映射文件），
+// 之后 sample 只读，可在多个线程中并发调用。时间以秒计，相对预报起点
+class VelocityProvider {
+public:
+    virtual ~VelocityProvider() {}
+
+    virtual cv::Size size() const = 0;
+    virtual void prepare(double begin_seconds, double end_seconds) = 0;
+    // 在像素坐标 (x, y) 处双线性采样，坐标限制在场内
+    virtual cv::Vec2f sample(float x, float y, double seconds) const = 0;
+    // 最近一次 prepare 的时间窗口内的流速上界（米/秒），用于估计子步数
+    virtual float maxSpeed() const = 0;
+};
+
+// 不随时间变化的流速场，与原先整个预报期使用同一个流场等价
+class SteadyVelocityProvider : public VelocityProvider {
+public:
+    explicit SteadyVelocityProvider(const cv::Mat& velocity_field_mps);
+
+    cv::Size size() const override { return velocity_field_mps_.size(); }
+    void prepare(double, double) override {}
+    cv::Vec2f sample(float x, float y, double seconds) const override;
+    float maxSpeed() const override { return max_speed_; }
+
+private:
+    cv::Mat velocity_field_mps_;
+    float max_speed_;
+};
+
+// 一个关键帧：流速场文件（writeMatFile 格式）及其代表的时刻
+struct VelocityKeyframe {
+    double seconds;
+    std::string path;
+};
+
+// 由多景场景对的流速场组成的时间序列，在相邻关键帧之间插值
+// 流速场以内存映射方式打开，只保留当前时间窗口用到的关键帧（线性插值为前后两幅，
+// 样条另加两侧各一幅），窗口推进后其余关键帧随即解除映射，多日预报也不必把全部流场读入内存。
+// 早于第一帧或晚于最后一帧时保持端点流场不变。无法读取的关键帧在 prepare 时报告一次，
+// 之后由时间上最近的可读关键帧代替；全部不可读时流速取0
+class VelocityFieldSeries : public VelocityProvider {
+public:
+    VelocityFieldSeries(const std::vector<VelocityKeyframe>& keyframes,
+        TemporalInterpolation interpolation = TemporalInterpolation::Linear);
+
+    // 读取目录下多景模式写出的 velocity_<起始秒>_<结束秒>.mat，每个流场取所在区间的中点时刻，
+    // 时间换算为相对 origin_seconds（与文件名相同的绝对秒数）
+    static std::shared_ptr<VelocityFieldSeries> fromDirectory(const std::string& directory, double origin_seconds,
+        TemporalInterpolation interpolation = TemporalInterpolation::Linear);
+
+    cv::Size size() const override { return size_; }
+    void prepare(double begin_seconds, double end_seconds) override;
+    cv::Vec2f sample(float x, float y, double seconds) const override;
+    float maxSpeed() const override { return max_speed_; }
+
+    size_t keyframeCount() const { return keyframes_.size(); }
+    // 当前映射中的关键帧数
+    size_t residentCount() const;
+
+private:
+    // 第一个时刻大于 seconds 的关键帧之前的那一帧，seconds 早于第一帧时为 -1
+    int intervalIndex(double seconds) const;
+    // 映射第 index 帧，已映射时直接返回；读取失败时记为不可读并返回 false
+    bool mapKeyframe(int index);
+    const cv::Mat& field(int index) const;
+
+    std::vector<VelocityKeyframe> keyframes_;
+    TemporalInterpolation interpolation_;
+    cv::Size size_;
+    std::vector<std::shared_ptr<MappedMatFile>> resident_;  // 与 keyframes_ 一一对应，未映射为空
+    std::vector<float> keyframe_max_speed_;                 // 首次映射时统计，未统计为负
+    std::vector<bool> unreadable_;                          // 映射失败过的关键帧，不再重试
+    std::vector<int> source_;                               // 采样第 k 帧时实际使用的关键帧；窗口外为 -1，无可读关键帧为 -2
+    cv::Mat zero_field_;                                    // 无可读关键帧时的替代流场
+    float max_speed_;
+};
+
+#endif
@@ -7,20 +7,37 @@
 #include "ImageProcessor.h"
 #include "AlgaeTracker.h"
 #include "AlgaeSimulator.h"
+#include "AlgaeParticleEngine.h"
 #include "AlgaeSalvageSim.h"
+#include "Benchmark.h"
+#include "FrameWriter.h"
+#include "SceneCache.h"
+#include "ScenePipeline.h"
+#include "Locations.h"
+#include "EnsembleForecast.h"
+#include "ArrivalTime.h"
+#include "Trace.h"
+#include "ForecastServer.h"
+#include "ConcentrationAdvector.h"
+#include "SparseTileMask.h"
+#include "ForecastSeriesWriter.h"
+#include "SimulationWorkspace.h"
+#include "FrameRenderer.h"
+#include "TaskGraph.h"
+#include "VelocityProvider.h"
+#include "BloomPatches.h"
 
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <string>
-#include <set>
 #include <limits>
+#include <algorithm>
 #include <cctype>
-
-// 关键地点
-struct Location {
-    std::string name;
-    cv::Point coordinate;
-};
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <opencv2/core/utils/filesystem.hpp>
 
 // 创建带有白色背景的最终图像
 cv::Mat createFinalImageWithWhiteBackground(const cv::Mat& content_image, const cv::Mat& data_mask) {
@@ -30,30 +47,93 @@ cv::Mat createFinalImageWithWhiteBackground(const cv::Mat& content_image, const
 }
 
 
+// 动态模拟的推演方式
+enum class ForecastModel {
+    Particles,      // 拉格朗日粒子
+    Eulerian        // 以 NDVI 为初值的浓度场半拉格朗日平流
+};
+
+// 按面积列出前若干个藻华斑块及由其引发的预警
+// 预警的来源编号与斑块标号同为8连通域编号，首帧斑块的跟踪编号与之相同
+static void printBloomPatchSummary(const BloomPatchTracker& patch_tracker, const std::vector<ArrivalEstimate>& arrivals,
+    const std::vector<Location>& locations, float spatial_resolution_meters, size_t max_listed = 10) {
+    std::vector<const BloomPatch*> order;
+    for (const auto& patch : patch_tracker.patches()) {
+        order.push_back(&patch);
+    }
+    std::sort(order.begin(), order.end(), [](const BloomPatch* a, const BloomPatch* b) { return a->area > b->area; });
+
+    const double km2_per_pixel = (double)spatial_resolution_meters * spatial_resolution_meters / 1e6;
+    const size_t listed = std::min(max_listed, order.size());
+    std::cout << cv::format("藻华分解为 %d 个斑块，按面积列出前 %d 个：", (int)order.size(), (int)listed) << std::endl;
+    for (size_t i = 0; i < listed; ++i) {
+        const BloomPatch& patch = *order[i];
+        std::cout << cv::format("  斑块 #%d: 面积 %.3f km², 质心 (%.0f, %.0f), 平均漂移 (%.3f, %.3f) m/s",
+            patch.id, patch.area * km2_per_pixel, patch.centroid.x, patch.centroid.y,
+            patch.mean_velocity_mps[0], patch.mean_velocity_mps[1]);
+        for (size_t k = 0; k < locations.size(); ++k) {
+            if (arrivals[k].reached && arrivals[k].source_region == patch.label) {
+                std::cout << cv::format("，%.2f 小时后到达 [", arrivals[k].arrival_hours) << locations[k].name << "]";
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+// 在 seconds 时刻把时变流场采样到 field 的 region 范围内（斑块跟踪只读取藻华所在范围），其余位置为0
+static void sampleVelocityField(const VelocityProvider& velocity, double seconds, cv::Rect region, cv::Mat& field) {
+    field.create(velocity.size(), CV_32FC2);
+    field.setTo(cv::Scalar::all(0));
+    cv::parallel_for_(cv::Range(region.y, region.y + region.height), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            cv::Vec2f* row = field.ptr<cv::Vec2f>(y);
+            for (int x = region.x; x < region.x + region.width; ++x) {
+                row[x] = velocity.sample((float)x, (float)y, seconds);
+            }
+        }
+    });
+}
+
 // 动态模拟与入侵预警
 void runOriginalDynamicSimulation(
     const cv::Mat& initial_algae_mask_t1,   
     const cv::Mat& velocity_field_mps,     
     const cv::Mat& colormap_t1,            
-    float spatial_resolution_meters        
+    float spatial_resolution_meters,
+    FrameSink& frame_sink,
+    ForecastModel model = ForecastModel::Particles,
+    const cv::Mat& ndvi_t1 = cv::Mat(),
+    float diffusion_m2_per_s = 0.0f,
+    ForecastSeriesWriter* series_writer = nullptr,
+    std::shared_ptr<VelocityProvider> time_varying_velocity = nullptr,
+    bool flow_overlay = false,
+    int patch_tracking_steps = 3
 ) {
     std::cout << "\n--- 正在启动藻华入侵动态模拟 (未来8小时) ---" << std::endl;
 
-    const int WARNING_RADIUS = 30;
-    std::vector<Location> water_intakes = {
-        {"沙渚水源地", cv::Point(655, 334)},
-        {"太湖镇水源地", cv::Point(758, 498)},
-        {"渔洋山水源地", cv::Point(875, 741)}
-    };
-    std::vector<Location> scenic_spots = {
-        {"七里风光堤", cv::Point(361, 350)},
-        {"静山夕阳观景处", cv::Point(651, 919)},
-        {"香山景区", cv::Point(77, 878)},
-        {"太湖旅游度假区", cv::Point(390, 1290)}
-    };
-
-    AlgaeSimulator simulator;
-    std::set<std::string> triggered_warnings;
+    std::vector<Location> water_intakes = defaultWaterIntakes();
+    std::vector<Location> scenic_spots = defaultScenicSpots();
+
+    // 粒子（或浓度场）跨时间步持续推进，每步只积分20分钟；给出时变流场时粒子按当前时刻采样
+    AlgaeParticleEngine particle_engine = time_varying_velocity
+        ? AlgaeParticleEngine(time_varying_velocity, spatial_resolution_meters)
+        : AlgaeParticleEngine(velocity_field_mps, spatial_resolution_meters);
+    std::unique_ptr<ConcentrationAdvector> concentration;
+    const bool eulerian = model == ForecastModel::Eulerian;
+    // 浓度场模式只支持定常流场，parseOptions 已拒绝二者同时给出
+    CV_Assert(!(eulerian && time_varying_velocity));
+    if (eulerian) {
+        concentration.reset(new ConcentrationAdvector(velocity_field_mps, spatial_resolution_meters));
+        if (ndvi_t1.empty()) {
+            concentration->seedFromMask(initial_algae_mask_t1);
+        }
+        else {
+            concentration->seedFromNDVI(ndvi_t1);
+        }
+    }
+    else {
+        particle_engine.seedFromMask(initial_algae_mask_t1);
+    }
 
     cv::Mat simulation_background = colormap_t1.clone();
     for (const auto& loc : water_intakes) {
@@ -65,124 +145,859 @@ void runOriginalDynamicSimulation(
 
     const float SIMULATION_HOURS = 8.0f;
     const float TIME_STEP_MINUTES = 20.0f;
+
+    // 预警时间由逆向轨迹一次算出，不受20分钟步长限制；动画推进到该时刻时再输出。
+    // 逆向轨迹要求流场恒定，时变流场下改为逐步检查监测点像素是否被预测藻华覆盖
+    std::vector<Location> warning_locations = water_intakes;
+    warning_locations.insert(warning_locations.end(), scenic_spots.begin(), scenic_spots.end());
+    std::vector<ArrivalEstimate> arrivals(warning_locations.size(), ArrivalEstimate{ false, -1.0f, cv::Point2f(-1.0f, -1.0f), 0 });
+    if (!time_varying_velocity) {
+        ArrivalOptions arrival_options;
+        arrival_options.horizon_hours = SIMULATION_HOURS;
+        ArrivalTimeEstimator arrival_estimator(initial_algae_mask_t1, velocity_field_mps, spatial_resolution_meters, arrival_options);
+        arrivals = arrival_estimator.query(warning_locations);
+    }
+    std::vector<bool> warned(warning_locations.size(), false);
+
+    // 斑块汇总与跟踪：推演中每 patch_tracking_steps 步把各斑块按平均漂移平移后与当前斑块匹配，为0时不跟踪；
+    // 时变流场下斑块的平均漂移取当前时刻的流场
+    BloomPatchTracker patch_tracker;
+    cv::Mat tracking_velocity;
+    if (time_varying_velocity) {
+        time_varying_velocity->prepare(0.0, 0.0);
+        sampleVelocityField(*time_varying_velocity, 0.0, cv::boundingRect(initial_algae_mask_t1), tracking_velocity);
+    }
+    patch_tracker.update(initial_algae_mask_t1, time_varying_velocity ? tracking_velocity : velocity_field_mps,
+        0.0f, spatial_resolution_meters);
+    printBloomPatchSummary(patch_tracker, arrivals, warning_locations, spatial_resolution_meters);
+    int patch_splits = 0;
+    int patches_ended = 0;
+
     const int num_steps = static_cast<int>(SIMULATION_HOURS * 60 / TIME_STEP_MINUTES);
+    const float step_seconds = TIME_STEP_MINUTES * 60.0f;
+    int substeps = eulerian ? concentration->suggestSubsteps(step_seconds) : particle_engine.suggestSubsteps(step_seconds);
 
     double sim_scale_factor = 0.7;
+    const std::string window_title = "Dynamic Simulation (Press ESC to exit)";
+
+    // 掩膜与画面跨步复用：掩膜只分配含藻华的瓦片，画面在显示分辨率上只重绘与上一步不同的瓦片
+    SimulationWorkspace workspace;
+    SparseTileMask& predicted_mask = workspace.sparseMask(initial_algae_mask_t1.size());
+    cv::Mat& dense_mask = workspace.denseMask();
+    FrameRenderer& renderer = workspace.renderer(simulation_background, sim_scale_factor);
+    if (flow_overlay) {
+        renderer.setFlowArrows(velocity_field_mps * (step_seconds / spatial_resolution_meters), 25);
+    }
 
     for (int i = 0; i <= num_steps; ++i) {
         float current_hours = i * TIME_STEP_MINUTES / 60.0f;
 
-        cv::Mat predicted_mask = simulator.predictAlgaePosition(
-            initial_algae_mask_t1, 
-            velocity_field_mps,
-            current_hours,         
-            spatial_resolution_meters
-        );
-
-        cv::Mat frame = createColorMapFromMask(predicted_mask, simulation_background);
-        cv::putText(frame, cv::format("Time: +%.1f hours", current_hours), cv::Point(30, 30),
-            cv::FONT_HERSHEY_SIMPLEX, 1, cv::Scalar(255, 255, 255), 2);
-
-        auto check_warnings = [&](const std::vector<Location>& locations) {
-            for (const auto& loc : locations) {
-                if (triggered_warnings.count(loc.name)) continue;
-
-                if (loc.coordinate.y >= 0 && loc.coordinate.y < predicted_mask.rows &&
-                    loc.coordinate.x >= 0 && loc.coordinate.x < predicted_mask.cols) {
-                    if (predicted_mask.at<uchar>(loc.coordinate.y, loc.coordinate.x) == 255) {
-                        std::cout << "[!] 预警: " << cv::format("藻华预计在 %.1f 小时后", current_hours)
-                            << "到达 [" << loc.name << "]！坐标: (" << loc.coordinate.x << ", " << loc.coordinate.y << ")" << std::endl;
-                        triggered_warnings.insert(loc.name);
-                    }
+        if (eulerian) {
+            if (i > 0) {
+                concentration->step(step_seconds, substeps, diffusion_m2_per_s);
+            }
+            // 只在显示时阈值化为掩膜
+            concentration->toSparseMask(predicted_mask);
+        }
+        else {
+            if (i > 0) {
+                // 时变流场的流速上界随时间窗口变化，每步按本步用到的关键帧重新估计子步数
+                if (time_varying_velocity) {
+                    substeps = particle_engine.suggestSubsteps(step_seconds);
                 }
+                particle_engine.step(step_seconds, substeps, Integrator::RK2);
             }
-            };
+            particle_engine.rasterizeSparse(predicted_mask);
+        }
+        if (i > 0 && patch_tracking_steps > 0 && i % patch_tracking_steps == 0) {
+            if (time_varying_velocity) {
+                sampleVelocityField(*time_varying_velocity, particle_engine.time(), predicted_mask.activeBounds(), tracking_velocity);
+            }
+            patch_tracker.update(predicted_mask, time_varying_velocity ? tracking_velocity : velocity_field_mps,
+                step_seconds * patch_tracking_steps, spatial_resolution_meters);
+            patch_splits += patch_tracker.splitCount();
+            patches_ended += patch_tracker.endedCount();
+        }
 
-        check_warnings(water_intakes);
-        check_warnings(scenic_spots);
+        // 时间序列输出：定常流场只写一次；时变流场只在粒子处求值，不输出整幅流场
+        if (series_writer != nullptr) {
+            const float minutes = i * TIME_STEP_MINUTES;
+            if (i == 0 && !time_varying_velocity) {
+                series_writer->writeStep("velocity", minutes, velocity_field_mps);
+            }
+            predicted_mask.toMat(dense_mask);
+            series_writer->writeStep("forecast_mask", minutes, dense_mask);
+            if (eulerian) {
+                series_writer->writeStep("concentration", minutes, concentration->concentration());
+            }
+        }
 
-        cv::Mat frame_display;
-        cv::resize(frame, frame_display, cv::Size(), sim_scale_factor, sim_scale_factor, cv::INTER_AREA);
+        renderer.update(predicted_mask);
+        renderer.drawText(cv::format("Time: +%.1f hours", current_hours), cv::Point(30, 30), 1, cv::Scalar(255, 255, 255), 2);
+
+        if (time_varying_velocity) {
+            for (size_t k = 0; k < warning_locations.size(); ++k) {
+                const cv::Point& c = warning_locations[k].coordinate;
+                if (arrivals[k].reached || c.x < 0 || c.y < 0 || c.x >= predicted_mask.cols() || c.y >= predicted_mask.rows()) continue;
+                if (predicted_mask.test(c.x, c.y)) {
+                    arrivals[k].reached = true;
+                    arrivals[k].arrival_hours = current_hours;
+                }
+            }
+        }
+        for (size_t k = 0; k < warning_locations.size(); ++k) {
+            const ArrivalEstimate& arrival = arrivals[k];
+            if (warned[k] || !arrival.reached || arrival.arrival_hours > current_hours) continue;
+            const Location& loc = warning_locations[k];
+            std::cout << "[!] 预警: " << cv::format("藻华预计在 %.2f 小时后", arrival.arrival_hours)
+                << "到达 [" << loc.name << "]！坐标: (" << loc.coordinate.x << ", " << loc.coordinate.y << ")";
+            if (arrival.source_region > 0) {
+                std::cout << cv::format("，来源藻华斑块 #%d", arrival.source_region);
+            }
+            std::cout << std::endl;
+            warned[k] = true;
+        }
 
-        cv::imshow("Dynamic Simulation (Press ESC to exit)", frame_display);
-        if (cv::waitKey(100) == 27) {
+        bool keep_running = frame_sink.submit(window_title, renderer.frame());
+        workspace.endStep();
+        if (!keep_running) {
             break;
         }
     }
 
     std::cout << "\n--- 原始动态模拟结束 ---" << std::endl;
-    cv::waitKey(0);
+    if (renderer.frames() > 0) {
+        std::cout << cv::format("画面平均每步重绘 %.1f / %d 个显示块",
+            (double)renderer.recompositedBlocks() / renderer.frames(), renderer.blockCount()) << std::endl;
+    }
+    int initial_patches_alive = 0;
+    for (const auto& patch : patch_tracker.patches()) {
+        if (patch.age == patch_tracker.frames()) ++initial_patches_alive;
+    }
+    std::cout << cv::format("斑块跟踪：共 %d 次分裂、%d 个斑块合并或消失，结束时 %d 个斑块（%d 个自初始时刻延续）",
+        patch_splits, patches_ended, (int)patch_tracker.patches().size(), initial_patches_alive) << std::endl;
+    if (workspace.bufferReallocations() > 0) {
+        std::cout << cv::format("推演缓冲区在 %d 步中重新分配了 %d 次（藻华范围扩大）",
+            (int)workspace.steps(), (int)workspace.bufferReallocations()) << std::endl;
+    }
+    if (SimulationWorkspace::allocationsCounted()) {
+        std::cout << cv::format("首步之后推演线程共 %llu 次堆分配（含画面输出与时间序列拷贝）",
+            (unsigned long long)workspace.steadyStateAllocations()) << std::endl;
+    }
+    frame_sink.endStream(window_title, true);
+}
+
+// 命令行选项
+struct RunOptions {
+    bool headless = false;          // 无界面批处理：不弹窗口、不等待按键、不读取标准输入
+    bool stages_given = false;      // 是否通过 --stages 指定了运行阶段
+    bool run_maps = true;           // 阶段1/2静态分析图
+    bool run_forecast = true;       // 未来8小时动态模拟
+    bool run_salvage = false;       // 打捞模拟
+    bool run_ensemble = false;      // 集合预报到达概率
+    int ensemble_members = 200;
+    std::string monitor_points_path;        // 监测点CSV，给出时输出各点到达时间
+    std::string trace_path;                 // 阶段跟踪输出（Chrome trace JSON）
+    std::string serve_target;               // 常驻服务："stdin" 或 Unix 套接字路径
+    ForecastModel forecast_model = ForecastModel::Particles;
+    float diffusion_m2_per_s = 0.0f;        // 浓度场模式的扩散系数
+    int progressive_factor = 1;             // >1 时先以 1/factor 分辨率给出预览，再以全分辨率细化
+    std::string series_output_dir;          // 非空时把各时间步的掩膜、浓度与流速写为 GeoTIFF 时间序列
+    std::string velocity_series_dir;        // 多景模式写出的流速场目录，给出时动态模拟使用时变流场
+    TemporalInterpolation velocity_interpolation = TemporalInterpolation::Linear;
+    bool video = false;             // 无界面模式下写视频而非PNG序列
+    bool flow_report = false;       // 输出光流精度/耗时对比报告
+    bool flow_overlay = false;      // 动态模拟画面叠加流场箭头
+    int patch_tracking_steps = 3;   // 动态模拟每隔多少步跟踪一次藻华斑块（20分钟一步），0 表示不跟踪
+    FlowOptions flow_options;
+    SegmentationOptions segmentation;       // 藻华掩膜的阈值方式，默认分块大津法
+    bool use_cache = true;          // 输入未变化时直接映射缓存的 NDVI 与流场
+    std::string cache_dir = "cache";
+    std::vector<std::string> scene_paths;  // 多景时间序列模式的输入
+    std::string output_dir = "output";
+    std::string path_t0 = "data/2021_05_30_10_38_06_GF1.tif";
+    std::string path_t1 = "data/2021_05_30_11_13_47_GF4.tif";
+};
+
+// 渐进式预览：低分辨率的藻华分布、流场与到达时间，在全分辨率结果出来之前先行输出
+static void emitForecastPreview(
+    const SceneProducts& preview_t1,
+    const cv::Mat& preview_flow,
+    int factor,
+    float spatial_resolution_meters,
+    float interval_seconds,
+    double elapsed_seconds,
+    FrameSink& frame_sink
+) {
+    AlgaeTracker tracker;
+    const float coarse_resolution = spatial_resolution_meters * factor;
+    cv::Mat velocity = tracker.extendFlowBeyondMask(tracker.filterFlowByMask(preview_flow, preview_t1.algae_mask),
+        preview_t1.algae_mask, preview_t1.data_mask, 25.0f / factor) * (coarse_resolution / interval_seconds);
+    cv::Vec2f drift = tracker.calculateAverageDrift(velocity, preview_t1.algae_mask);
+    std::cout << cv::format("\n--- 预览 (1/%d 分辨率, %.2f 秒) ---", factor, elapsed_seconds) << std::endl;
+    std::cout << cv::format("平均漂移速度 (%.3f, %.3f) m/s", drift[0], drift[1]) << std::endl;
+
+    std::vector<Location> locations = defaultWaterIntakes();
+    std::vector<Location> scenic_spots = defaultScenicSpots();
+    locations.insert(locations.end(), scenic_spots.begin(), scenic_spots.end());
+    std::vector<cv::Point2f> coarse_points;
+    for (const auto& location : locations) {
+        coarse_points.push_back(cv::Point2f((float)location.coordinate.x / factor, (float)location.coordinate.y / factor));
+    }
+    ArrivalTimeEstimator estimator(preview_t1.algae_mask, velocity, coarse_resolution);
+    std::vector<ArrivalEstimate> arrivals = estimator.query(coarse_points);
+    for (size_t k = 0; k < locations.size(); ++k) {
+        if (arrivals[k].reached) {
+            std::cout << "[预览] " << cv::format("藻华预计在 %.1f 小时后", arrivals[k].arrival_hours)
+                << "到达 [" << locations[k].name << "]" << std::endl;
+        }
+    }
+
+    cv::Mat preview = preview_t1.colormap.clone();
+    for (size_t k = 0; k < locations.size(); ++k) {
+        cv::circle(preview, cv::Point(cvRound(coarse_points[k].x), cvRound(coarse_points[k].y)),
+            std::max(2, WARNING_RADIUS / factor), cv::Scalar(0, 0, 255), 1);
+    }
+    frame_sink.writeStill(cv::format("Preview (1-%d resolution)", factor), preview);
+}
+
+// 集合预报：输出各水厂/景点的到达概率与首次到达时间分位数，并生成经过概率热力图
+static void runEnsembleStage(
+    const cv::Mat& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    const cv::Mat& background,
+    float spatial_resolution_meters,
+    int members,
+    FrameSink& frame_sink
+) {
+    std::vector<Location> locations = defaultWaterIntakes();
+    std::vector<Location> scenic_spots = defaultScenicSpots();
+    locations.insert(locations.end(), scenic_spots.begin(), scenic_spots.end());
+
+    EnsembleOptions ensemble_options;
+    ensemble_options.members = members;
+    int64 start = cv::getTickCount();
+    EnsembleResult result = runEnsembleForecast(initial_algae_mask, velocity_field_mps, spatial_resolution_meters, locations, ensemble_options);
+    double elapsed = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+    std::cout << "\n--- 集合预报（" << result.members << " 个成员，" << ensemble_options.hours << " 小时，耗时 "
+        << cv::format("%.2f", elapsed) << " 秒）---" << std::endl;
+    for (const auto& arrival : result.locations) {
+        std::cout << "  " << arrival.name << ": 到达概率 " << cv::format("%.1f%%", arrival.probability * 100);
+        if (arrival.probability > 0) {
+            std::cout << cv::format("，首次到达 P10/P50/P90 = %.1f / %.1f / %.1f 小时",
+                arrival.p10_hours, arrival.p50_hours, arrival.p90_hours);
+        }
+        std::cout << std::endl;
+    }
+
+    cv::Mat probability_u8, heatmap;
+    result.arrival_probability.convertTo(probability_u8, CV_8U, 255.0);
+    cv::applyColorMap(probability_u8, heatmap, cv::COLORMAP_JET);
+    cv::Mat overlay = background.clone();
+    heatmap.copyTo(overlay, probability_u8);
+    for (const auto& location : locations) {
+        cv::circle(overlay, location.coordinate, WARNING_RADIUS, cv::Scalar(255, 255, 255), 2);
+    }
+    cv::Mat display;
+    cv::resize(overlay, display, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+    frame_sink.writeStill("Ensemble Arrival Probability", display);
+}
+
+// 监测点到达时间查询：结果写入 <output_dir>/arrival_times.csv，并生成到达时间图
+static void runMonitorPointQuery(
+    const std::string& monitor_points_path,
+    const cv::Mat& initial_algae_mask,
+    const cv::Mat& velocity_field_mps,
+    const cv::Mat& background,
+    float spatial_resolution_meters,
+    const std::string& output_dir,
+    FrameSink& frame_sink
+) {
+    std::vector<Location> points = loadLocationsCsv(monitor_points_path);
+    if (points.empty()) {
+        std::cerr << "错误：监测点列表为空: " << monitor_points_path << std::endl;
+        return;
+    }
+
+    int64 start = cv::getTickCount();
+    ArrivalTimeEstimator estimator(initial_algae_mask, velocity_field_mps, spatial_resolution_meters);
+    std::vector<ArrivalEstimate> arrivals = estimator.query(points);
+    double elapsed = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+    int reached = 0;
+    cv::utils::fs::createDirectories(output_dir);
+    std::string csv_path = output_dir + "/arrival_times.csv";
+    std::ofstream csv(csv_path);
+    csv << "name,x,y,reached,arrival_hours,source_x,source_y,source_region\n";
+    for (size_t i = 0; i < points.size(); ++i) {
+        const ArrivalEstimate& arrival = arrivals[i];
+        reached += arrival.reached ? 1 : 0;
+        csv << points[i].name << ',' << points[i].coordinate.x << ',' << points[i].coordinate.y << ','
+            << (arrival.reached ? 1 : 0) << ',' << arrival.arrival_hours << ','
+            << arrival.source.x << ',' << arrival.source.y << ',' << arrival.source_region << '\n';
+    }
+    std::cout << "\n--- 监测点到达时间 ---" << std::endl;
+    std::cout << "  " << points.size() << " 个监测点中 " << reached << " 个将在 8 小时内被藻华到达，耗时 "
+        << cv::format("%.3f", elapsed) << " 秒，结果已写入 " << csv_path << std::endl;
+
+    // 到达时间图：越早到达越红，未到达处保留背景
+    cv::Mat arrival_map = estimator.arrivalTimeMap(4);
+    cv::Mat reached_mask = arrival_map >= 0;
+    cv::Mat urgency_u8, heatmap;
+    arrival_map.convertTo(urgency_u8, CV_8U, -255.0 / 8.0, 255.0);
+    cv::applyColorMap(urgency_u8, heatmap, cv::COLORMAP_JET);
+    cv::Mat overlay = background.clone();
+    heatmap.copyTo(overlay, reached_mask);
+    cv::Mat display;
+    cv::resize(overlay, display, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+    frame_sink.writeStill("Arrival Time Map", display);
 }
 
+static void printUsage() {
+    std::cout << "用法: main [--headless] [--stages maps,forecast,salvage,ensemble] [--output 目录] [--video]\n"
+        << "            [--t0 影像路径] [--t1 影像路径]\n"
+        << "            [--flow-backend farneback|dis] [--flow-tiled] [--flow-report] [--flow-overlay]\n"
+        << "            [--cache-dir 目录] [--no-cache] [--ensemble-members 成员数]\n"
+        << "            [--monitor-points 监测点.csv] [--trace 跟踪.json] [--serve stdin|套接字路径]\n"
+        << "            [--forecast-model particles|eulerian] [--diffusion 扩散系数] [--progressive 2|4]\n"
+        << "            [--series-output 目录] [--velocity-series 流速场目录] [--velocity-interp linear|spline]\n"
+        << "            [--segmentation fixed|otsu|tile-otsu] [--segmentation-tile 瓦片边长] [--patch-tracking 步数]\n"
+        << "      main --scenes <影像1> <影像2> ... [--output 目录]   (多景时间序列流速场)\n"
+        << "      main --bench-kernels <影像路径> [重复次数]\n"
+        << "      main --benchmark [--sizes 1024,2048] [--coverages 0.05,0.2] [--flows uniform,vortex,shear]\n"
+        << "                       [--repeats 次数] [--json 结果路径]   (合成场景基准测试)" << std::endl;
+}
 
-int main() {
+static bool parseOptions(int argc, char** argv, RunOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--headless") {
+            options.headless = true;
+        }
+        else if (arg == "--video") {
+            options.video = true;
+        }
+        else if (arg == "--flow-backend" && has_value) {
+            std::string backend = argv[++i];
+            options.flow_options.backend = backend == "dis" ? FlowBackend::DIS : FlowBackend::Farneback;
+        }
+        else if (arg == "--flow-tiled") {
+            options.flow_options.tiled = true;
+        }
+        else if (arg == "--flow-report") {
+            options.flow_report = true;
+        }
+        else if (arg == "--flow-overlay") {
+            options.flow_overlay = true;
+        }
+        else if (arg == "--no-cache") {
+            options.use_cache = false;
+        }
+        else if (arg == "--cache-dir" && has_value) {
+            options.cache_dir = argv[++i];
+        }
+        else if (arg == "--scenes") {
+            while (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0) {
+                options.scene_paths.push_back(argv[++i]);
+            }
+        }
+        else if (arg == "--stages" && has_value) {
+            std::string stages = argv[++i];
+            options.stages_given = true;
+            options.run_maps = stages.find("maps") != std::string::npos;
+            options.run_forecast = stages.find("forecast") != std::string::npos;
+            options.run_salvage = stages.find("salvage") != std::string::npos;
+            options.run_ensemble = stages.find("ensemble") != std::string::npos;
+        }
+        else if (arg == "--ensemble-members" && has_value) {
+            options.ensemble_members = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--forecast-model" && has_value) {
+            std::string model = argv[++i];
+            options.forecast_model = model == "eulerian" ? ForecastModel::Eulerian : ForecastModel::Particles;
+        }
+        else if (arg == "--diffusion" && has_value) {
+            options.diffusion_m2_per_s = std::max(0.0f, (float)atof(argv[++i]));
+        }
+        else if (arg == "--progressive") {
+            bool has_factor = has_value && std::string(argv[i + 1]).compare(0, 2, "--") != 0;
+            options.progressive_factor = has_factor ? std::max(1, atoi(argv[++i])) : 4;
+        }
+        else if (arg == "--serve") {
+            options.serve_target = (has_value && std::string(argv[i + 1]).compare(0, 2, "--") != 0) ? argv[++i] : "stdin";
+        }
+        else if (arg == "--trace" && has_value) {
+            options.trace_path = argv[++i];
+        }
+        else if (arg == "--monitor-points" && has_value) {
+            options.monitor_points_path = argv[++i];
+        }
+        else if (arg == "--series-output" && has_value) {
+            options.series_output_dir = argv[++i];
+        }
+        else if (arg == "--segmentation" && has_value) {
+            std::string mode = argv[++i];
+            options.segmentation.mode = mode == "fixed" ? ThresholdMode::Fixed
+                : mode == "otsu" ? ThresholdMode::GlobalOtsu : ThresholdMode::TileOtsu;
+        }
+        else if (arg == "--segmentation-tile" && has_value) {
+            options.segmentation.tile_size = std::max(16, std::atoi(argv[++i]));
+        }
+        else if (arg == "--patch-tracking" && has_value) {
+            options.patch_tracking_steps = std::max(0, atoi(argv[++i]));
+        }
+        else if (arg == "--velocity-series" && has_value) {
+            options.velocity_series_dir = argv[++i];
+        }
+        else if (arg == "--velocity-interp" && has_value) {
+            std::string interpolation = argv[++i];
+            options.velocity_interpolation = interpolation == "spline" ? TemporalInterpolation::CubicSpline : TemporalInterpolation::Linear;
+        }
+        else if (arg == "--output" && has_value) {
+            options.output_dir = argv[++i];
+        }
+        else if (arg == "--t0" && has_value) {
+            options.path_t0 = argv[++i];
+        }
+        else if (arg == "--t1" && has_value) {
+            options.path_t1 = argv[++i];
+        }
+        else {
+            std::cerr << "错误：无法识别的参数: " << arg << std::endl;
+            printUsage();
+            return false;
+        }
+    }
+    // 浓度场平流只支持定常流场
+    if (options.forecast_model == ForecastModel::Eulerian && !options.velocity_series_dir.empty()) {
+        std::cerr << "错误：--forecast-model eulerian 不支持 --velocity-series。" << std::endl;
+        return false;
+    }
+    // 无界面模式下未指定阶段时全部运行
+    if (options.headless && !options.stages_given) {
+        options.run_salvage = true;
+        options.run_ensemble = true;
+    }
+    return true;
+}
+
+// --trace：跟踪默认关闭，且只有以 ALGAE_ENABLE_TRACING 编译时才可用
+static void startTracing(const std::string& trace_path) {
+    if (trace_path.empty()) return;
+#ifdef ALGAE_ENABLE_TRACING
+    Tracer::instance().start();
+#else
+    std::cerr << "警告：程序未以 ALGAE_ENABLE_TRACING 编译，--trace 不会输出任何内容。" << std::endl;
+#endif
+}
+
+static void finishTracing(const std::string& trace_path) {
+#ifdef ALGAE_ENABLE_TRACING
+    if (trace_path.empty()) return;
+    Tracer& tracer = Tracer::instance();
+    tracer.stop();
+    tracer.printSummary();
+    if (tracer.writeChromeTrace(trace_path)) {
+        std::cout << "跟踪已写入 " << trace_path << "（可用 chrome://tracing 或 Perfetto 打开）" << std::endl;
+    }
+#else
+    (void)trace_path;
+#endif
+}
+
+// 逗号分隔的列表
+static std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos) end = text.size();
+        if (end > begin) items.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+static bool parseBenchmarkOptions(int argc, char** argv, BenchmarkSuiteOptions& options) {
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--sizes" && has_value) {
+            options.sizes.clear();
+            for (const auto& item : splitList(argv[++i])) options.sizes.push_back(std::max(64, atoi(item.c_str())));
+        }
+        else if (arg == "--coverages" && has_value) {
+            options.coverages.clear();
+            for (const auto& item : splitList(argv[++i])) options.coverages.push_back(atof(item.c_str()));
+        }
+        else if (arg == "--flows" && has_value) {
+            options.flows.clear();
+            for (const auto& item : splitList(argv[++i])) {
+                FlowPattern pattern;
+                if (!parseFlowPattern(item, pattern)) {
+                    std::cerr << "错误：未知的流场形态: " << item << std::endl;
+                    return false;
+                }
+                options.flows.push_back(pattern);
+            }
+        }
+        else if (arg == "--repeats" && has_value) {
+            options.repeats = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--json" && has_value) {
+            options.json_path = argv[++i];
+        }
+        else {
+            std::cerr << "错误：无法识别的参数: " << arg << std::endl;
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
     system("chcp 65001 > nul");
+#endif
     setlocale(LC_ALL, "zh-CN.UTF-8");
 
-    // --- 第1阶段：加载数据与核心计算 ---
-    std::string path_t0 = "data/2021_05_30_10_38_06_GF1.tif";
-    std::string path_t1 = "data/2021_05_30_11_13_47_GF4.tif";
+    // 基准测试模式：main --bench-kernels <影像路径> [重复次数]
+    if (argc >= 3 && std::string(argv[1]) == "--bench-kernels") {
+        ImageProcessor bench_processor(argv[2]);
+        runSceneKernelBenchmark(bench_processor, argc >= 4 ? std::atoi(argv[3]) : 5);
+        return 0;
+    }
 
-    ImageProcessor processor_t0(path_t0);
-    ImageProcessor processor_t1(path_t1);
-    if (!processor_t0.isLoaded() || !processor_t1.isLoaded()) {
-        std::cerr << "错误：图像加载失败，请检查路径和文件。" << std::endl;
-        return -1;
+    // 合成场景基准测试：不依赖 data/ 下的真实影像，结果写成JSON便于跟踪回归
+    if (argc >= 2 && std::string(argv[1]) == "--benchmark") {
+        BenchmarkSuiteOptions bench_options;
+        if (!parseBenchmarkOptions(argc, argv, bench_options)) {
+            return -1;
+        }
+        return runBenchmarkSuite(bench_options) ? 0 : -1;
     }
 
-    cv::Mat ndvi_t0 = processor_t0.calculateNDVI();
-    cv::Mat ndvi_t1 = processor_t1.calculateNDVI();
-    cv::Mat mask_t1 = processor_t1.extractAlgaeMask(ndvi_t1); 
-    if (ndvi_t0.empty() || ndvi_t1.empty() || mask_t1.empty()) {
-        std::cerr << "错误：NDVI 或藻华掩膜计算失败。" << std::endl;
+    RunOptions options;
+    if (!parseOptions(argc, argv, options)) {
         return -1;
     }
 
-    AlgaeTracker tracker;
-    cv::Mat raw_flow = tracker.calculateOpticalFlow(ndvi_t0, ndvi_t1);
-    cv::Mat filtered_flow = tracker.filterFlowByMask(raw_flow, mask_t1);
-
-    const float TIME_INTERVAL_SECONDS = 2141.0f;
     const float SPATIAL_RESOLUTION_METERS = 50.0f;
-    cv::Mat velocity_field_mps = filtered_flow * (SPATIAL_RESOLUTION_METERS / TIME_INTERVAL_SECONDS);
+    startTracing(options.trace_path);
+
+    // 多景时间序列模式：为每对相邻场景输出一个流速场
+    if (!options.scene_paths.empty()) {
+        std::vector<SceneInfo> scenes = collectScenes(options.scene_paths);
+        cv::utils::fs::createDirectories(options.output_dir);
+        ScenePipeline pipeline(options.flow_options, SPATIAL_RESOLUTION_METERS);
+        pipeline.setSegmentationOptions(options.segmentation);
+        AlgaeTracker tracker;
+        BloomPatchTracker patch_tracker;
+        auto on_pair = [&](const PairVelocityField& pair) {
+            cv::Vec2f drift = tracker.calculateAverageDrift(pair.velocity_field_mps, pair.algae_mask_to);
+            patch_tracker.update(pair.algae_mask_to, pair.velocity_field_mps, pair.interval_seconds, SPATIAL_RESOLUTION_METERS);
+            std::string path = cv::utils::fs::join(options.output_dir,
+                cv::format("velocity_%.0f_%.0f.mat", pair.from.timestamp_seconds, pair.to.timestamp_seconds));
+            writeMatFile(path, pair.velocity_field_mps);
+            std::cout << cv::format("流速场 %s -> %s (间隔 %.0f 秒): 平均漂移 (%.3f, %.3f) m/s, 已写出 ",
+                pair.from.sensor.c_str(), pair.to.sensor.c_str(), pair.interval_seconds, drift[0], drift[1]) << path << std::endl;
+            std::cout << cv::format("  藻华斑块 %d 个：延续 %d、分裂 %d、新出现 %d、合并或消失 %d",
+                (int)patch_tracker.patches().size(), patch_tracker.continuedCount(), patch_tracker.splitCount(),
+                patch_tracker.newCount(), patch_tracker.endedCount()) << std::endl;
+        };
+        int pair_count = 0;
+        try {
+            pair_count = pipeline.run(scenes, on_pair);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "错误：多景流水线中止: " << e.what() << std::endl;
+            finishTracing(options.trace_path);
+            return -1;
+        }
+        std::cout << "多景流水线完成，共输出 " << pair_count << " 个流速场。" << std::endl;
+        finishTracing(options.trace_path);
+        return pair_count > 0 ? 0 : -1;
+    }
+
+    std::unique_ptr<FrameSink> frame_sink;
+    if (options.headless) {
+        frame_sink.reset(new AsyncFrameWriter(options.output_dir,
+            options.video ? FrameOutputFormat::Video : FrameOutputFormat::PngSequence));
+    }
+    else {
+        frame_sink.reset(new WindowFrameSink());
+    }
+
+    // --- 第1阶段：加载数据与核心计算 ---
+    // 两景的时间间隔由文件名中的成像时间得出，无法解析时沿用 2141 秒
+    float TIME_INTERVAL_SECONDS = 2141.0f;
+    SceneInfo info_t0, info_t1;
+    if (parseSceneInfo(options.path_t0, info_t0) && parseSceneInfo(options.path_t1, info_t1) &&
+        info_t1.timestamp_seconds > info_t0.timestamp_seconds) {
+        TIME_INTERVAL_SECONDS = (float)(info_t1.timestamp_seconds - info_t0.timestamp_seconds);
+    }
+
+    // 缓存键：两幅输入影像的内容 + 影响结果的全部参数
+    SceneCache scene_cache(options.cache_dir);
+    std::string cache_key;
+    if (options.use_cache) {
+        // 渐进模式的全图 Farneback 以粗分辨率光流为初值细化，结果与直接计算不同，单独缓存
+        std::string parameters = cv::format("v2|backend=%d|tiled=%d|tile=%d|pad=%d|dt=%.3f|res=%.3f|seg=%d|seg_tile=%d|prog=%d",
+            (int)options.flow_options.backend, options.flow_options.tiled ? 1 : 0,
+            options.flow_options.tile_size, options.flow_options.tile_padding,
+            TIME_INTERVAL_SECONDS, SPATIAL_RESOLUTION_METERS,
+            (int)options.segmentation.mode, options.segmentation.tile_size, options.progressive_factor);
+        cache_key = scene_cache.makeKey({ options.path_t0, options.path_t1 }, parameters);
+    }
+
+    CachedSceneFields fields;
+    cv::Mat colormap_t0, colormap_t1;
+
+    // 第1、2阶段登记到同一张任务图：两景的读取、融合内核、预览、光流与静态图绘制按依赖并行，
+    // 端到端耗时由关键路径决定。交互窗口只能在主线程操作，输出画面的阶段绑定到调用线程。
+    // 任务按引用读写的中间结果要活到 run() 结束，因此与任务图一起声明
+    TaskGraph stage_graph;
+    std::unique_ptr<ImageProcessor> processor_t0, processor_t1;
+    SceneProducts preview_t0, preview_t1, scene_t0, scene_t1;
+    cv::Mat preview_flow;
+    cv::Mat final_t0, final_t1, flow_viz;
+    const bool emit_maps = options.run_maps && options.serve_target.empty();
+    TaskGraph::TaskId fields_ready = -1;
+
+    if (options.use_cache && scene_cache.load(cache_key, fields)) {
+        std::cout << "命中缓存 " << cache_key << "，跳过 NDVI 与光流计算。" << std::endl;
+        TaskGraph::TaskId colorize_t0 = stage_graph.add("colorize_t0", [&] {
+            colormap_t0 = ImageProcessor::colorizeNDVI(fields.ndvi_t0);
+        });
+        TaskGraph::TaskId colorize_t1 = stage_graph.add("colorize_t1", [&] {
+            colormap_t1 = ImageProcessor::colorizeNDVI(fields.ndvi_t1);
+        });
+        fields_ready = stage_graph.add("scene_fields", [] {}, { colorize_t0, colorize_t1 });
+    }
+    else {
+        TaskGraph::TaskId open_t0 = stage_graph.add("open_t0", [&] {
+            processor_t0.reset(new ImageProcessor(options.path_t0));
+            if (!processor_t0->isLoaded()) throw std::runtime_error("图像加载失败，请检查路径和文件: " + options.path_t0);
+            processor_t0->setSegmentationOptions(options.segmentation);
+        });
+        TaskGraph::TaskId open_t1 = stage_graph.add("open_t1", [&] {
+            processor_t1.reset(new ImageProcessor(options.path_t1));
+            if (!processor_t1->isLoaded()) throw std::runtime_error("图像加载失败，请检查路径和文件: " + options.path_t1);
+            processor_t1->setSegmentationOptions(options.segmentation);
+        });
+
+        // 渐进模式：先用降采样数据给出预览，粗分辨率光流随后作为全分辨率光流的初值
+        std::vector<TaskGraph::TaskId> flow_dependencies;
+        if (options.progressive_factor > 1) {
+            const int64 preview_start = cv::getTickCount();
+            TaskGraph::TaskId downsample_t0 = stage_graph.add("preview_t0", [&] {
+                preview_t0 = processor_t0->processSceneDownsampled(options.progressive_factor);
+            }, { open_t0 });
+            TaskGraph::TaskId downsample_t1 = stage_graph.add("preview_t1", [&] {
+                preview_t1 = processor_t1->processSceneDownsampled(options.progressive_factor);
+            }, { open_t1 });
+            TaskGraph::TaskId coarse_flow = stage_graph.add("preview_flow", [&] {
+                if (!preview_t0.ndvi.empty() && !preview_t1.ndvi.empty()) {
+                    preview_flow = AlgaeTracker().calculateOpticalFlow(preview_t0.ndvi, preview_t1.ndvi);
+                }
+            }, { downsample_t0, downsample_t1 });
+            stage_graph.add("emit_preview", [&, preview_start] {
+                if (!preview_flow.empty()) {
+                    emitForecastPreview(preview_t1, preview_flow, options.progressive_factor, SPATIAL_RESOLUTION_METERS,
+                        TIME_INTERVAL_SECONDS, (cv::getTickCount() - preview_start) / cv::getTickFrequency(), *frame_sink);
+                }
+            }, { coarse_flow }, TaskAffinity::Caller);
+            flow_dependencies.push_back(coarse_flow);
+        }
+
+        // 融合内核单次遍历得到 NDVI、掩膜与伪彩色图
+        TaskGraph::TaskId process_t0 = stage_graph.add("process_scene_t0", [&] {
+            scene_t0 = processor_t0->processScene();
+            if (scene_t0.ndvi.empty()) throw std::runtime_error("NDVI 或藻华掩膜计算失败。");
+        }, { open_t0 });
+        TaskGraph::TaskId process_t1 = stage_graph.add("process_scene_t1", [&] {
+            scene_t1 = processor_t1->processScene();
+            if (scene_t1.ndvi.empty() || scene_t1.algae_mask.empty()) throw std::runtime_error("NDVI 或藻华掩膜计算失败。");
+        }, { open_t1 });
+        flow_dependencies.push_back(process_t0);
+        flow_dependencies.push_back(process_t1);
+
+        // 粗分辨率光流作初值只用于全图 Farneback；DIS 与分块模式仍按原配置计算
+        TaskGraph::TaskId optical_flow = stage_graph.add("optical_flow", [&] {
+            AlgaeTracker flow_tracker;
+            cv::Mat raw_flow;
+            if (!preview_flow.empty() && options.flow_options.backend == FlowBackend::Farneback && !options.flow_options.tiled) {
+                raw_flow = flow_tracker.refineOpticalFlow(scene_t0.ndvi, scene_t1.ndvi,
+                    AlgaeTracker::upsampleFlow(preview_flow, scene_t0.ndvi.size()));
+            }
+            else {
+                raw_flow = flow_tracker.calculateOpticalFlow(scene_t0.ndvi, scene_t1.ndvi, scene_t1.algae_mask, options.flow_options);
+            }
+            // 藻华移出 t1 掩膜后仍需流速可循，掩膜外用延拓场
+            cv::Mat filtered_flow = flow_tracker.extendFlowBeyondMask(
+                flow_tracker.filterFlowByMask(raw_flow, scene_t1.algae_mask), scene_t1.algae_mask, scene_t1.data_mask);
+
+            fields.ndvi_t0 = scene_t0.ndvi;
+            fields.ndvi_t1 = scene_t1.ndvi;
+            fields.mask_t1 = scene_t1.algae_mask;
+            fields.data_mask_t0 = scene_t0.data_mask;
+            fields.velocity_field_mps = filtered_flow * (SPATIAL_RESOLUTION_METERS / TIME_INTERVAL_SECONDS);
+            colormap_t0 = scene_t0.colormap;
+            colormap_t1 = scene_t1.colormap;
+        }, flow_dependencies);
+
+        // 对比报告会重新计算两遍光流，与主光流并行
+        if (options.flow_report) {
+            stage_graph.add("flow_report", [&] {
+                FlowAccuracyReport report = AlgaeTracker().compareWithReference(scene_t0.ndvi, scene_t1.ndvi, scene_t1.algae_mask, options.flow_options);
+                std::cout << cv::format("光流对比: 全图Farneback %.1f ms, 当前配置 %.1f ms (加速比 %.2fx)",
+                    report.reference_ms, report.candidate_ms, report.reference_ms / std::max(report.candidate_ms, 1e-3)) << std::endl;
+                std::cout << cv::format("端点误差 (像素, %d 个藻华像素): 平均 %.3f, RMS %.3f, P95 %.3f, 最大 %.3f",
+                    report.evaluated_pixels, report.mean_endpoint_error, report.rms_endpoint_error,
+                    report.p95_endpoint_error, report.max_endpoint_error) << std::endl;
+            }, { process_t0, process_t1 });
+        }
+        if (options.use_cache) {
+            stage_graph.add("cache_store", [&] {
+                if (scene_cache.store(cache_key, fields)) {
+                    std::cout << "已写入缓存 " << cache_key << std::endl;
+                }
+            }, { optical_flow });
+        }
+        fields_ready = optical_flow;
+    }
 
     // --- 第2阶段：生成静态的可视化成果图 ---
-    std::cout << "--- 正在生成静态分析图 ---" << std::endl;
-    cv::Mat data_mask = processor_t0.createDataMask();
-    cv::Mat colormap_t0 = processor_t0.createNDVIColorMap(ndvi_t0);
-    cv::Mat colormap_t1 = processor_t1.createNDVIColorMap(ndvi_t1);
-
-    cv::Mat final_t0 = createFinalImageWithWhiteBackground(colormap_t0, data_mask);
-    cv::Mat final_t1 = createFinalImageWithWhiteBackground(colormap_t1, data_mask);
-
-    cv::Mat stage1_result;
-    cv::hconcat(final_t0, final_t1, stage1_result);
-
-    cv::Mat flow_viz = tracker.visualizeFlow(colormap_t0, filtered_flow, 25);
-    cv::arrowedLine(flow_viz, cv::Point(50, flow_viz.rows - 80), cv::Point(150, flow_viz.rows - 80), cv::Scalar(0, 0, 255), 2, cv::LINE_AA);
-    cv::putText(flow_viz, "Drift Velocity", cv::Point(50, flow_viz.rows - 55), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 255), 2);
-    cv::putText(flow_viz, "0.3 m/s", cv::Point(50, flow_viz.rows - 35), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 255), 2);
-    cv::Mat stage2_result = createFinalImageWithWhiteBackground(flow_viz, data_mask);
-
-    double static_scale_factor = 0.5;
-    cv::Mat stage1_display, stage2_display;
-    cv::resize(stage1_result, stage1_display, cv::Size(), static_scale_factor, static_scale_factor, cv::INTER_AREA);
-    cv::resize(stage2_result, stage2_display, cv::Size(), static_scale_factor, static_scale_factor, cv::INTER_AREA);
-
-    cv::imshow("Stage 1 - Algae Distribution (Scaled)", stage1_display);
-    cv::imshow("Stage 2 - Algae Drift Velocity (Scaled)", stage2_display);
-    std::cout << "已生成分析图。正在运行动态模拟" << std::endl;
-    runOriginalDynamicSimulation(mask_t1, velocity_field_mps, colormap_t1, SPATIAL_RESOLUTION_METERS);
-
-    // 加分项
-    char choice;
-    std::cout << "\n是否要运行藻华打捞模拟 (加分项)? (Y/N): ";
-    std::cin >> choice;
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-    if (toupper(choice) == 'Y') {
-        runAlgaeSalvageSimulation(mask_t1, velocity_field_mps, colormap_t1, SPATIAL_RESOLUTION_METERS);
+    // 两幅底图与流场箭头图互不依赖，各自在场景产品就绪后立即绘制
+    if (emit_maps) {
+        TaskGraph::TaskId draw_t0 = stage_graph.add("final_t0", [&] {
+            final_t0 = createFinalImageWithWhiteBackground(colormap_t0, fields.data_mask_t0);
+        }, { fields_ready });
+        TaskGraph::TaskId draw_t1 = stage_graph.add("final_t1", [&] {
+            final_t1 = createFinalImageWithWhiteBackground(colormap_t1, fields.data_mask_t0);
+        }, { fields_ready });
+        TaskGraph::TaskId draw_flow = stage_graph.add("flow_viz", [&] {
+            // 箭头只画藻华上实测的流速，不画延拓部分
+            cv::Mat filtered_flow = cv::Mat::zeros(fields.velocity_field_mps.size(), CV_32FC2);
+            fields.velocity_field_mps.copyTo(filtered_flow, fields.mask_t1);
+            filtered_flow *= TIME_INTERVAL_SECONDS / SPATIAL_RESOLUTION_METERS;
+            cv::Mat arrows = AlgaeTracker().visualizeFlow(colormap_t0, filtered_flow, 25);
+            cv::arrowedLine(arrows, cv::Point(50, arrows.rows - 80), cv::Point(150, arrows.rows - 80), cv::Scalar(0, 0, 255), 2, cv::LINE_AA);
+            cv::putText(arrows, "Drift Velocity", cv::Point(50, arrows.rows - 55), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 255), 2);
+            cv::putText(arrows, "0.3 m/s", cv::Point(50, arrows.rows - 35), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 255), 2);
+            flow_viz = createFinalImageWithWhiteBackground(arrows, fields.data_mask_t0);
+        }, { fields_ready });
+        stage_graph.add("emit_maps", [&] {
+            std::cout << "--- 正在生成静态分析图 ---" << std::endl;
+            cv::Mat stage1_result;
+            cv::hconcat(final_t0, final_t1, stage1_result);
+
+            double static_scale_factor = 0.5;
+            cv::Mat stage1_display, stage2_display;
+            cv::resize(stage1_result, stage1_display, cv::Size(), static_scale_factor, static_scale_factor, cv::INTER_AREA);
+            cv::resize(flow_viz, stage2_display, cv::Size(), static_scale_factor, static_scale_factor, cv::INTER_AREA);
+
+            frame_sink->writeStill("Stage 1 - Algae Distribution (Scaled)", stage1_display);
+            frame_sink->writeStill("Stage 2 - Algae Drift Velocity (Scaled)", stage2_display);
+            std::cout << "已生成分析图。" << std::endl;
+        }, { draw_t0, draw_t1, draw_flow }, TaskAffinity::Caller);
     }
+
+    {
+        ALGAE_TRACE_SCOPE("stage_scene_fields");
+        if (!stage_graph.run()) {
+            return -1;
+        }
+    }
+    stage_graph.printReport(std::cout);
+
+    cv::Mat mask_t1 = fields.mask_t1;
+    cv::Mat velocity_field_mps = fields.velocity_field_mps;
+
+    // 常驻服务模式：场景产品与流场留在内存中，逐行应答 JSON 查询
+    if (!options.serve_target.empty()) {
+        ForecastServer server(mask_t1, velocity_field_mps, colormap_t1, SPATIAL_RESOLUTION_METERS);
+        cv::utils::fs::createDirectories(options.output_dir);
+        server.setOutputDirectory(options.output_dir);
+        bool served = true;
+        if (options.serve_target == "stdin") {
+            std::cerr << "预报服务就绪，从标准输入读取请求（每行一个 JSON 对象）" << std::endl;
+            server.serveStream(std::cin, std::cout);
+        }
+        else {
+            served = server.serveUnixSocket(options.serve_target);
+        }
+        finishTracing(options.trace_path);
+        return served ? 0 : -1;
+    }
+
+    // 时变流场：多景模式写出的各场景对流速场，时刻相对 t1 成像时间（预报起点）
+    std::shared_ptr<VelocityProvider> time_varying_velocity;
+    if (!options.velocity_series_dir.empty()) {
+        SceneInfo origin_info;
+        double origin_seconds = parseSceneInfo(options.path_t1, origin_info) ? origin_info.timestamp_seconds : 0.0;
+        std::shared_ptr<VelocityFieldSeries> series = VelocityFieldSeries::fromDirectory(
+            options.velocity_series_dir, origin_seconds, options.velocity_interpolation);
+        if (series && series->size() == mask_t1.size()) {
+            std::cout << "已载入时变流场，共 " << series->keyframeCount() << " 个关键帧。" << std::endl;
+            time_varying_velocity = series;
+        }
+        else if (series) {
+            std::cerr << "错误：时变流场尺寸与影像不一致，改用 t0/t1 流场。" << std::endl;
+        }
+    }
+
+    // 时间序列沿用 t1 影像的地理参考（只读取元数据）
+    std::unique_ptr<ForecastSeriesWriter> series_writer;
+    if (!options.series_output_dir.empty()) {
+        ImageProcessor georeference_source(options.path_t1);
+        series_writer.reset(new ForecastSeriesWriter(options.series_output_dir, georeference_source.geoReference()));
+    }
+
+    if (options.run_forecast) {
+        ALGAE_TRACE_SCOPE("stage_forecast");
+        std::cout << "正在运行动态模拟" << std::endl;
+        runOriginalDynamicSimulation(mask_t1, velocity_field_mps, colormap_t1, SPATIAL_RESOLUTION_METERS, *frame_sink,
+            options.forecast_model, fields.ndvi_t1, options.diffusion_m2_per_s, series_writer.get(), time_varying_velocity,
+            options.flow_overlay, options.patch_tracking_steps);
+    }
+
+    // 加分项：交互模式下未指定阶段时询问是否运行
+    bool run_salvage = options.run_salvage;
+    if (!options.headless && !options.stages_given) {
+        char choice;
+        std::cout << "\n是否要运行藻华打捞模拟 (加分项)? (Y/N): ";
+        std::cin >> choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        run_salvage = toupper(choice) == 'Y';
+    }
+
+    if (!options.monitor_points_path.empty()) {
+        ALGAE_TRACE_SCOPE("stage_monitor_points");
+        runMonitorPointQuery(options.monitor_points_path, mask_t1, velocity_field_mps, colormap_t1,
+            SPATIAL_RESOLUTION_METERS, options.output_dir, *frame_sink);
+    }
+
+    if (options.run_ensemble) {
+        ALGAE_TRACE_SCOPE("stage_ensemble");
+        std::cout << "正在运行集合预报" << std::endl;
+        runEnsembleStage(mask_t1, velocity_field_mps, colormap_t1, SPATIAL_RESOLUTION_METERS, options.ensemble_members, *frame_sink);
+    }
+
+    if (run_salvage) {
+        ALGAE_TRACE_SCOPE("stage_salvage");
+        runAlgaeSalvageSimulation(mask_t1, velocity_field_mps, colormap_t1, SPATIAL_RESOLUTION_METERS, *frame_sink,
+            series_writer.get());
+    }
+
+    // 等待后台编码线程写完所有帧与时间序列
+    frame_sink.reset();
+    series_writer.reset();
+    finishTracing(options.trace_path);
     std::cout << "\n所有模拟任务结束。" << std::endl;
     return 0;
 }
\ No newline at end of file